@@ -1,6 +1,8 @@
 #ifndef CAFFE_BLOB_HPP_
 #define CAFFE_BLOB_HPP_
 
+#include <stdint.h>
+
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -25,7 +27,8 @@ template <typename Dtype>
 class Blob {
  public:
   Blob()
-       : data_(), diff_(), count_(0), capacity_(0) {}
+       : data_(), diff_(), keep_half_(false), keep_int8_rows_(0), count_(0),
+         capacity_(0) {}
 
   /// @brief Deprecated; use <code>Blob(const vector<int>& shape)</code>.
   explicit Blob(const int num, const int channels, const int height,
@@ -209,6 +212,7 @@ class Blob {
 
   inline const shared_ptr<SyncedMemory>& data() const {
     CHECK(data_);
+    CheckWide();
     return data_;
   }
 
@@ -218,6 +222,15 @@ class Blob {
   }
 
   const Dtype* cpu_data() const;
+  /**
+   * @brief The version of the data (see SyncedMemory::version), which
+   *        changes whenever the data may change, for caches of what is
+   *        computed from it.
+   */
+  inline size_t data_version() const {
+    CHECK(data_);
+    return data_->version();
+  }
   void set_cpu_data(Dtype* data);
   const Dtype* gpu_data() const;
   const Dtype* cpu_diff() const;
@@ -262,12 +275,75 @@ class Blob {
    * shared_ptr calls its destructor when reset with the "=" operator.
    */
   void ShareDiff(const Blob& other);
+  /**
+   * @brief Set the data_ shared_ptr to point to memory, which must be large
+   *        enough to hold count() elements -- lets a Net place Blob%s whose
+   *        contents are never needed at the same time in a single buffer.
+   *
+   * Reshaping beyond the current count gives the Blob private memory again.
+   */
+  void ShareDataMemory(const shared_ptr<SyncedMemory>& memory);
+
+  /**
+   * @brief Keep the data in fp16 only, in half the memory, until Widen.
+   *
+   * Meant for the weights of TEST nets, which layers read through
+   * cpu_half_data. Reading the data as Dtype fails until Widen is called,
+   * so that concurrent readers never change the blob. Data that replaces it
+   * (FromProto, CopyFrom, set_cpu_data, ShareData, ShareDataMemory) is
+   * narrowed to fp16 as well, so a blob kept narrow does not share Dtype
+   * memory with other blobs.
+   */
+  void ToHalf();
+  /// @brief The fp16 data after ToHalf, or NULL when the data is Dtype.
+  const uint16_t* cpu_half_data() const;
+  /**
+   * @brief Keep the data quantized to int8 only, each of rows rows with a
+   *        scale of its own, until Widen.
+   *
+   * Like ToHalf, meant for the weights of TEST nets, which quantized
+   * layers read through cpu_int8_data and cpu_int8_scales. A no-op when
+   * the data is already int8 in rows rows.
+   */
+  void ToInt8(const int rows);
+  /// @brief The int8 data after ToInt8, or NULL when the data is Dtype.
+  const int8_t* cpu_int8_data() const;
+  /// @brief The scale of every row of the int8 data.
+  const Dtype* cpu_int8_scales() const;
+  /// @brief Turns fp16 or int8 data back into Dtype data, kept as Dtype.
+  void Widen();
+  /// @brief Whether the data is kept in fp16 or int8 rather than Dtype.
+  inline bool narrowed() const { return half_data_ || int8_data_; }
 
   bool ShapeEquals(const BlobProto& other);
 
  protected:
+  inline void CheckWide() const {
+    CHECK(!narrowed()) << "The data is kept in fp16 or int8; Widen it "
+        "before accessing it as Dtype.";
+  }
+  // Converts the fp16 or int8 data into data_ and forgets it.
+  void WidenData();
+  // Narrows the Dtype data that replaced the data to what the blob keeps.
+  void Narrow();
+  // Forgets the fp16 or int8 data, once the Dtype data replaces it.
+  inline void DropNarrowed() {
+    half_data_.reset();
+    int8_data_.reset();
+    int8_scales_.reset();
+  }
+
   shared_ptr<SyncedMemory> data_;
   shared_ptr<SyncedMemory> diff_;
+  // The fp16 data while the data is kept in fp16; see ToHalf.
+  shared_ptr<SyncedMemory> half_data_;
+  // The int8 data and the Dtype scales of its rows while the data is kept
+  // in int8; see ToInt8.
+  shared_ptr<SyncedMemory> int8_data_;
+  shared_ptr<SyncedMemory> int8_scales_;
+  // What the blob narrows new data to, until Widen.
+  bool keep_half_;
+  int keep_int8_rows_;
   vector<int> shape_;
   int count_;
   int capacity_;
@@ -95,17 +95,35 @@ void GlobalInit(int* pargc, char*** pargv);
 
 // A singleton class to hold common caffe stuff, such as the handler that
 // caffe is going to use for cublas, curand, etc.
+//
+// Besides the process-wide singleton there may be contexts, each with its own
+// mode, RNG and handles: while a context is current on a thread, Get and so
+// the static accessors below refer to it on that thread. A Net can carry a
+// context that is current while it runs (see Net::set_context), so that nets
+// on different threads do not share or contend for the RNG.
 class Caffe {
  public:
   ~Caffe();
-  inline static Caffe& Get() {
-    if (!singleton_.get()) {
-      singleton_.reset(new Caffe());
-    }
-    return *singleton_;
-  }
+  // The current context of the calling thread, or else the singleton.
+  static Caffe& Get();
   enum Brew { CPU, GPU };
 
+  // Creates a context in the mode of the current one, with an unseeded RNG.
+  static shared_ptr<Caffe> CreateContext();
+
+  // Makes context current on the calling thread until the scope ends, when
+  // the previous one is current again. A NULL context changes nothing.
+  class ContextScope {
+   public:
+    explicit ContextScope(Caffe* context);
+    ~ContextScope();
+   private:
+    Caffe* context_;
+    Caffe* previous_;
+
+    DISABLE_COPY_AND_ASSIGN(ContextScope);
+  };
+
   // This random number generator facade hides boost and CUDA rng
   // implementation from one another (for cross-platform compatibility).
   class RNG {
@@ -12,6 +12,7 @@
 #include "caffe/loss_layers.hpp"
 #include "caffe/neuron_layers.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -35,6 +36,8 @@ class ArgMaxLayer : public Layer<Dtype> {
    *     the number @f$ K @f$ of maximal items to output.
    *   - out_max_val (\b optional bool, default false).
    *     if set, output a vector of pairs (max_ind, max_val) for each image.
+   *   - num_threads (\b optional uint, default 1).
+   *     the number of threads that the batch is split over in CPU mode.
    */
   explicit ArgMaxLayer(const LayerParameter& param)
       : Layer<Dtype>(param) {}
@@ -66,8 +69,17 @@ class ArgMaxLayer : public Layer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
     NOT_IMPLEMENTED;
   }
+  /// Computes the outputs of the range thread_id of the num_threads_ ranges
+  /// of the batch.
+  void forward_cpu_range(const Dtype* bottom_data, Dtype* top_data, int num,
+      int dim, int thread_id);
+
   bool out_max_val_;
   size_t top_k_;
+  int num_threads_;
+  shared_ptr<ThreadPool> thread_pool_;
+  /// The top_k best inputs of each thread.
+  vector<std::pair<Dtype, int> > top_k_buffer_;
 };
 
 /**
@@ -264,6 +276,7 @@ class FlattenLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Flatten"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool TopsShareBottomData() const { return true; }
 
  protected:
   /**
@@ -325,6 +338,17 @@ class InnerProductLayer : public Layer<Dtype> {
   int N_;
   bool bias_term_;
   Blob<Dtype> bias_multiplier_;
+
+  // Whether Forward_cpu runs quantized to int8 (see QuantizationParameter).
+  bool quantized_;
+  // Whether Forward_cpu keeps the weights in fp16 (see half_weights).
+  bool half_weights_;
+  // Where caffe_cpu_gemm_half widens the fp16 weights.
+  vector<Dtype> half_panel_;
+  // The weights are kept in int8 in blobs_[0] (see Blob::ToInt8).
+  Dtype input_scale_;
+  vector<int8_t> int8_input_;
+  vector<int32_t> int32_output_;
 };
 
 /**
@@ -380,6 +404,7 @@ class ReshapeLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Reshape"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool TopsShareBottomData() const { return true; }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -483,6 +508,8 @@ class SoftmaxLayer : public Layer<Dtype> {
  public:
   explicit SoftmaxLayer(const LayerParameter& param)
       : Layer<Dtype>(param) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
   virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
 
@@ -507,6 +534,8 @@ class SoftmaxLayer : public Layer<Dtype> {
   Blob<Dtype> sum_multiplier_;
   /// scale is an intermediate Blob to hold temporary results.
   Blob<Dtype> scale_;
+  /// Splits the softmaxes over softmax_param.num_threads threads in CPU mode.
+  shared_ptr<ThreadPool> thread_pool_;
 };
 
 #ifdef USE_CUDNN
@@ -555,6 +584,7 @@ class SplitLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "Split"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int MinTopBlobs() const { return 1; }
+  virtual inline bool TopsShareBottomData() const { return true; }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
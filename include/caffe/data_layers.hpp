@@ -15,7 +15,10 @@
 #include "caffe/internal_thread.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/blocking_queue.hpp"
 #include "caffe/util/db.hpp"
+#include "caffe/util/raw_dataset.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -50,12 +53,27 @@ class BaseDataLayer : public Layer<Dtype> {
   bool output_labels_;
 };
 
+template <typename Dtype>
+class Batch {
+ public:
+  Blob<Dtype> data_, label_;
+};
+
+/**
+ * @brief Provides base for data layers that load their batches in a
+ *        background thread.
+ *
+ * A single long-lived thread keeps filling a ring of PREFETCH_COUNT
+ * pre-allocated batches. Batches travel from prefetch_free_ to prefetch_full_
+ * as they are loaded; Forward hands the next full batch to the top blobs by
+ * sharing its memory instead of copying it, and recycles the batch it handed
+ * out on the previous call.
+ */
 template <typename Dtype>
 class BasePrefetchingDataLayer :
     public BaseDataLayer<Dtype>, public InternalThread {
  public:
-  explicit BasePrefetchingDataLayer(const LayerParameter& param)
-      : BaseDataLayer<Dtype>(param) {}
+  explicit BasePrefetchingDataLayer(const LayerParameter& param);
   // LayerSetUp: implements common data layer setup functionality, and calls
   // DataLayerSetUp to do special data layer setup for individual layer types.
   // This method may not be overridden.
@@ -64,17 +82,25 @@ class BasePrefetchingDataLayer :
 
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
-  virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
-      const vector<Blob<Dtype>*>& top);
 
   virtual void CreatePrefetchThread();
   virtual void JoinPrefetchThread();
-  // The thread's function
-  virtual void InternalThreadEntry() {}
+
+  // Number of batches in the prefetch ring.
+  static const int PREFETCH_COUNT = 3;
 
  protected:
-  Blob<Dtype> prefetch_data_;
-  Blob<Dtype> prefetch_label_;
+  // The thread's function: loads batches until asked to stop.
+  virtual void InternalThreadEntry();
+  // Fills one batch; called in the prefetch thread.
+  virtual void load_batch(Batch<Dtype>* batch) = 0;
+
+  Batch<Dtype> prefetch_[PREFETCH_COUNT];
+  BlockingQueue<Batch<Dtype>*> prefetch_free_;
+  BlockingQueue<Batch<Dtype>*> prefetch_full_;
+  // The batch whose memory the top blobs currently share.
+  Batch<Dtype>* prefetch_current_;
+
   Blob<Dtype> transformed_data_;
 };
 
@@ -92,11 +118,30 @@ class DataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual inline int MinTopBlobs() const { return 1; }
   virtual inline int MaxTopBlobs() const { return 2; }
 
+  virtual void CreatePrefetchThread();
+
  protected:
-  virtual void InternalThreadEntry();
+  virtual void load_batch(Batch<Dtype>* batch);
+  // Parses, decodes and transforms the records of one slice of the batch
+  // into the matching items of top_data and top_label.
+  void DecodeSlice(int slice, Dtype* top_data, Dtype* top_label);
 
   shared_ptr<db::DB> db_;
   shared_ptr<db::Cursor> cursor_;
+
+  // The batch is split into one contiguous slice per decode thread; each
+  // slice has its own transformer (and thus its own random stream) and its
+  // own view into the batch being loaded. Slice 0 uses data_transformer_.
+  shared_ptr<ThreadPool> decode_pool_;
+  vector<shared_ptr<DataTransformer<Dtype> > > slice_transformers_;
+  vector<shared_ptr<Blob<Dtype> > > slice_data_;
+  // The records of the batch being loaded: views into the database when its
+  // cursor keeps them valid, or else into batch_copies_. Each slice parses
+  // its own records into batch_datums_, which are reused between batches.
+  vector<const char*> batch_values_;
+  vector<size_t> batch_sizes_;
+  vector<string> batch_copies_;
+  vector<Datum> batch_datums_;
 };
 
 /**
@@ -235,7 +280,7 @@ class ImageDataLayer : public BasePrefetchingDataLayer<Dtype> {
  protected:
   shared_ptr<Caffe::RNG> prefetch_rng_;
   virtual void ShuffleImages();
-  virtual void InternalThreadEntry();
+  virtual void load_batch(Batch<Dtype>* batch);
 
   vector<std::pair<std::string, int> > lines_;
   int lines_id_;
@@ -286,6 +331,42 @@ class MemoryDataLayer : public BaseDataLayer<Dtype> {
   bool has_new_data_;
 };
 
+/**
+ * @brief Provides data to the Net from a memory mapped raw dataset
+ *    (see RawDatasetHeader), as written by convert_imageset_raw.
+ *
+ * Samples are copied straight out of the mapping into the prefetch batches,
+ * with no decoding or protobuf parsing. Of the transformation parameters
+ * only scale and mean_value are supported: fixed-size samples are expected
+ * to be stored already cropped.
+ */
+template <typename Dtype>
+class RawDataLayer : public BasePrefetchingDataLayer<Dtype> {
+ public:
+  explicit RawDataLayer(const LayerParameter& param)
+      : BasePrefetchingDataLayer<Dtype>(param) {}
+  virtual ~RawDataLayer();
+  virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+  virtual inline const char* type() const { return "RawData"; }
+  virtual inline int ExactNumBottomBlobs() const { return 0; }
+  virtual inline int MinTopBlobs() const { return 1; }
+  virtual inline int MaxTopBlobs() const { return 2; }
+
+ protected:
+  virtual void ShuffleSamples();
+  virtual void load_batch(Batch<Dtype>* batch);
+
+  RawDataset dataset_;
+  shared_ptr<Caffe::RNG> prefetch_rng_;
+  // The order in which samples are visited, and the position in it.
+  vector<int> order_;
+  int order_id_;
+  // Per-channel mean, subtracted before scaling.
+  vector<Dtype> mean_values_;
+};
+
 /**
  * @brief Provides data to the Net from windows of images files, specified
  *        by a window data file.
@@ -307,7 +388,7 @@ class WindowDataLayer : public BasePrefetchingDataLayer<Dtype> {
 
  protected:
   virtual unsigned int PrefetchRand();
-  virtual void InternalThreadEntry();
+  virtual void load_batch(Batch<Dtype>* batch);
 
   shared_ptr<Caffe::RNG> prefetch_rng_;
   vector<std::pair<std::string, vector<int> > > image_database_;
@@ -138,6 +138,11 @@ class DataTransformer {
    */
   virtual int Rand(int n);
   virtual float Uniform(const float min, const float max);
+  /**
+   * @brief Draws a PCA relighting offset per channel into relight_, using
+   *    the transformer's own random stream.
+   */
+  void RandRelight(const int channels);
   void Transform(const Datum& datum, Dtype* transformed_data);
   // Tranformation parameters
   TransformationParameter param_;
@@ -152,7 +157,6 @@ class DataTransformer {
   // Cutomized variable for relighting
   vector<Dtype> eigen_values_;
   Blob<Dtype> eigen_vectors_;
-  shared_ptr<Filler<Dtype> > relight_filler_;
   Blob<Dtype> relight_;
 };
 
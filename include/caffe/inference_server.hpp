@@ -0,0 +1,126 @@
+#ifndef CAFFE_INFERENCE_SERVER_HPP_
+#define CAFFE_INFERENCE_SERVER_HPP_
+
+#include <boost/chrono.hpp>
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/internal_thread.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class InferenceServer;
+
+/**
+ * @brief The pending outputs of one request to an InferenceServer, which
+ *        become available once the batch that holds the request has run.
+ */
+template <typename Dtype>
+class InferenceFuture {
+ public:
+  /// @brief Blocks until the outputs are available.
+  void Wait() const;
+  bool ready() const;
+  /**
+   * @brief The outputs of the request, one vector per output blob of the net
+   *        with that blob's values for the request's item; Wait first.
+   */
+  const vector<vector<Dtype> >& outputs() const;
+  /// @brief The time from submission to completion, once ready.
+  float latency_ms() const { return latency_ms_; }
+
+ protected:
+  friend class InferenceServer<Dtype>;
+  explicit InferenceFuture(const Dtype* input, int input_count);
+  void set_done(float latency_ms);
+
+  /// Synchronization fields, kept out of the header as in BlockingQueue.
+  class sync;
+
+  vector<Dtype> input_;
+  vector<vector<Dtype> > outputs_;
+  boost::chrono::steady_clock::time_point submit_time_;
+  bool done_;
+  float latency_ms_;
+  shared_ptr<sync> sync_;
+
+  DISABLE_COPY_AND_ASSIGN(InferenceFuture);
+};
+
+/// @brief What an InferenceServer has served, for monitoring.
+struct InferenceServerStats {
+  /// The requests waiting to be batched
+  int queue_depth;
+  int requests;
+  int batches;
+  float mean_batch_size;
+  /// Submission to completion latencies: the mean, and the percentiles over
+  /// the most recent requests
+  float mean_latency_ms;
+  float p50_latency_ms;
+  float p99_latency_ms;
+  float max_latency_ms;
+};
+
+/**
+ * @brief Serves single-item inference requests from many threads by
+ *        batching them into the Forward passes of one TEST Net.
+ *
+ * A request is one item of the net's first input blob, whose num is the
+ * largest batch. The server thread takes the oldest waiting request and
+ * coalesces those that arrive until the batch is full or max_delay_us has
+ * passed since that request was submitted, then runs Forward on the batch
+ * and completes the futures. To serve from several threads, run a server on
+ * each of nets made by CreateSharedWeightsNets.
+ */
+template <typename Dtype>
+class InferenceServer : public InternalThread {
+ public:
+  InferenceServer(const shared_ptr<Net<Dtype> >& net, int max_delay_us);
+  /// Serves the requests still queued before returning.
+  virtual ~InferenceServer();
+
+  /**
+   * @brief Queues a request; input holds one item of the first input blob,
+   *        input_count() values, which are copied.
+   */
+  shared_ptr<InferenceFuture<Dtype> > Submit(const Dtype* input);
+
+  int max_batch_size() const { return max_batch_size_; }
+  int input_count() const { return input_count_; }
+  InferenceServerStats stats() const;
+
+ protected:
+  virtual void InternalThreadEntry();
+  void ForwardBatch(const vector<shared_ptr<InferenceFuture<Dtype> > >& batch);
+
+  /// The number of most recent latencies that the percentiles cover
+  static const int kLatencyWindow = 4096;
+
+  /// Guards the stats, kept out of the header as in BlockingQueue.
+  class sync;
+
+  shared_ptr<Net<Dtype> > net_;
+  int max_delay_us_;
+  int max_batch_size_;
+  int input_count_;
+  BlockingQueue<shared_ptr<InferenceFuture<Dtype> > > requests_;
+
+  int requests_served_;
+  int batches_served_;
+  double total_latency_ms_;
+  float max_latency_ms_;
+  vector<float> recent_latencies_ms_;
+  shared_ptr<sync> sync_;
+
+  DISABLE_COPY_AND_ASSIGN(InferenceServer);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_INFERENCE_SERVER_HPP_
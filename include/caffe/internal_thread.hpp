@@ -27,6 +27,13 @@ class InternalThread {
   /** Will not return until the internal thread has exited. */
   bool WaitForInternalThreadToExit();
 
+  /**
+   * Asks a long-running thread to stop, then waits for it to exit. The
+   * request is delivered by interrupting the thread: blocking waits throw
+   * boost::thread_interrupted, and loops should poll must_stop().
+   */
+  bool StopInternalThread();
+
   bool is_started() const;
 
  protected:
@@ -34,6 +41,9 @@ class InternalThread {
       with the code you want your thread to run. */
   virtual void InternalThreadEntry() {}
 
+  /* Should be tested when running loops to exit when requested. */
+  bool must_stop() const;
+
   shared_ptr<boost::thread> thread_;
 };
 
@@ -10,6 +10,7 @@
 #include "caffe/layer_factory.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/device_alternate.hpp"
+#include "caffe/util/param_cache.hpp"
 
 namespace caffe {
 
@@ -152,6 +153,22 @@ class Layer {
     return blobs_;
   }
 
+  /**
+   * @brief Returns the cache of what the layer computes from its parameters.
+   *
+   * A cache of its own unless set_param_cache shares one, as Net does for
+   * the layers of nets sharing their parameters.
+   */
+  ParamCache<Dtype>* param_cache() {
+    if (!param_cache_) {
+      param_cache_.reset(new ParamCache<Dtype>());
+    }
+    return param_cache_.get();
+  }
+  void set_param_cache(const shared_ptr<ParamCache<Dtype> >& param_cache) {
+    param_cache_ = param_cache;
+  }
+
   /**
    * @brief Returns the layer parameter.
    */
@@ -263,6 +280,29 @@ class Layer {
     return true;
   }
 
+  /**
+   * @brief Return whether the tops share the data of the bottoms (by
+   *        Blob::ShareData) rather than hold results of their own.
+   *
+   * The Net needs to know this to tell when the memory behind a blob is
+   * still in use.
+   */
+  virtual inline bool TopsShareBottomData() const { return false; }
+
+  /**
+   * @brief Returns the bytes of scratch memory the layer needs, at its
+   *        current shape, within a single Forward or Backward call.
+   *
+   * Nothing in the scratch memory outlives the call, so a Net lends all of
+   * its layers the same workspace through SetWorkspace.
+   */
+  virtual inline size_t workspace_size() const { return 0; }
+  /**
+   * @brief Use workspace, of at least workspace_size() bytes, as the layer's
+   *        scratch memory until it is reshaped to need more.
+   */
+  virtual void SetWorkspace(const shared_ptr<SyncedMemory>& workspace) {}
+
   /**
    * @brief Specifies whether the layer should compute gradients w.r.t. a
    *        parameter at a particular index given by param_id.
@@ -295,6 +335,8 @@ class Layer {
   vector<shared_ptr<Blob<Dtype> > > blobs_;
   /** Vector indicating whether to compute the diff of each param blob. */
   vector<bool> param_propagate_down_;
+  /** What the layer computes from its parameters; see param_cache(). */
+  shared_ptr<ParamCache<Dtype> > param_cache_;
 
   /** The vector that indicates whether each top blob has a non-zero weight in
    *  the objective function. */
@@ -376,6 +418,28 @@ class Layer {
     }
   }
 
+  /**
+   * Called by LayerSetUp when the learnable parameters were given rather than
+   * created (loaded or shared), to check that blobs_[i] has the shape that
+   * the layer would create, or its legacy 4D shape padded with leading 1s
+   * (e.g. 1 x 1 x M x N for an M x N weight) from older models.
+   */
+  void CheckParamShape(const int i, const vector<int>& shape) const {
+    const Blob<Dtype>& blob = *blobs_[i];
+    bool equal = blob.shape() == shape;
+    if (!equal && blob.num_axes() <= 4 && shape.size() <= 4) {
+      equal = true;
+      for (int axis = 1; axis <= 4; ++axis) {
+        const int dim = axis <= shape.size() ? shape[shape.size() - axis] : 1;
+        equal = equal && blob.LegacyShape(-axis) == dim;
+      }
+    }
+    CHECK(equal) << type() << " layer " << layer_param_.name()
+        << " expects parameter " << i << " of shape "
+        << Blob<Dtype>(shape).shape_string() << ", not "
+        << blob.shape_string();
+  }
+
   /**
    * Called by SetUp to initialize the weights associated with any top blobs in
    * the loss function. Store non-zero loss weights in the diff blob.
@@ -10,6 +10,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/neuron_layers.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -29,6 +30,8 @@ class AccuracyLayer : public Layer<Dtype> {
    *     Sets the maximum rank @f$ k @f$ at which a prediction is considered
    *     correct.  For example, if @f$ k = 5 @f$, a prediction is counted
    *     correct if the correct label is among the top 5 predicted labels.
+   *   - num_threads (\b optional, default 1). The number of threads that
+   *     the predictions are split over in CPU mode.
    */
   explicit AccuracyLayer(const LayerParameter& param)
       : Layer<Dtype>(param) {}
@@ -78,6 +81,11 @@ class AccuracyLayer : public Layer<Dtype> {
     }
   }
 
+  /// Counts the correct and the counted predictions of the range thread_id
+  /// of the num_threads_ ranges of positions.
+  void forward_cpu_range(const Dtype* bottom_data, const Dtype* bottom_label,
+      int num_labels, int thread_id);
+
   int label_axis_, outer_num_, inner_num_;
 
   int top_k_;
@@ -86,6 +94,14 @@ class AccuracyLayer : public Layer<Dtype> {
   bool has_ignore_label_;
   /// The label indicating that an instance should be ignored.
   int ignore_label_;
+
+  int num_threads_;
+  shared_ptr<ThreadPool> thread_pool_;
+  /// The top_k best predictions of each thread.
+  vector<std::pair<Dtype, int> > top_k_buffer_;
+  /// The counts of each thread.
+  vector<int> correct_;
+  vector<int> counted_;
 };
 
 /**
@@ -791,6 +807,11 @@ class SoftmaxWithLossLayer : public LossLayer<Dtype> {
   /// Whether to normalize the loss by the total number of values present
   /// (otherwise just by the batch size).
   bool normalize_;
+  /// log_norm stores the log of the softmax normalizer of every prediction in
+  /// CPU mode, from which the loss takes the log-probabilities.
+  Blob<Dtype> log_norm_;
+  /// Splits the softmaxes over softmax_param.num_threads threads in CPU mode.
+  shared_ptr<ThreadPool> thread_pool_;
 
   int softmax_axis_, outer_num_, inner_num_;
 };
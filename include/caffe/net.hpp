@@ -11,9 +11,44 @@
 #include "caffe/common.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/mapped_weights.hpp"
+#include "caffe/util/param_cache.hpp"
 
 namespace caffe {
 
+/**
+ * @brief The learnable parameters of the layers of a trained net by layer
+ *        name, which Net%s can share read-only (see CreateSharedWeightsNets).
+ */
+template <typename Dtype>
+class NetWeights {
+ public:
+  /// @brief Loads a NetParameter file, or maps mapped weights.
+  explicit NetWeights(const string& trained_filename);
+  explicit NetWeights(const NetParameter& param);
+
+  /// @brief The blobs of the named layer, or NULL if it has none.
+  const vector<shared_ptr<Blob<Dtype> > >* layer_blobs(
+      const string& layer_name) const;
+  /**
+   * @brief The cache of what the named layer computes from its blobs, which
+   *        the layers sharing them share too; NULL if it has no blobs.
+   */
+  shared_ptr<ParamCache<Dtype> > layer_param_cache(
+      const string& layer_name) const;
+
+ protected:
+  void FromProto(const NetParameter& param);
+  void CreateParamCaches();
+
+  map<string, vector<shared_ptr<Blob<Dtype> > > > layer_blobs_;
+  map<string, shared_ptr<ParamCache<Dtype> > > layer_param_caches_;
+  /// The mapped weights that the blobs point into, if any
+  shared_ptr<MappedWeights> mapped_weights_;
+
+  DISABLE_COPY_AND_ASSIGN(NetWeights);
+};
+
 /**
  * @brief Connects Layer%s together into a directed acyclic graph (DAG)
  *        specified by a NetParameter.
@@ -25,6 +60,12 @@ class Net {
  public:
   explicit Net(const NetParameter& param);
   explicit Net(const string& param_file, Phase phase);
+  /**
+   * @brief Initialize a network whose layers take their learnable parameters
+   *        from weights, sharing the blobs, rather than creating them.
+   */
+  Net(const NetParameter& param,
+      const shared_ptr<const NetWeights<Dtype> >& weights);
   virtual ~Net() {}
 
   /// @brief Initialize a network with a NetParameter.
@@ -75,6 +116,23 @@ class Net {
    */
   void Reshape();
 
+  /**
+   * @brief Allocates for the given largest shapes of the input blobs, so that
+   *        reshaping to any shapes within them and running Forward allocates
+   *        nothing.
+   *
+   * Blobs keep their largest allocation across reshapes, so this reshapes the
+   * net to max_input_shapes, plans shared activation memory again if the net
+   * shares it, and runs Forward once on zeroed inputs so that layers allocate
+   * their buffers too. Then it restores the shapes of the inputs, whose data
+   * is lost.
+   *
+   * The net must take its inputs through input blobs. A net without any
+   * fails the call, as its Forward would consume a batch of its data
+   * layers.
+   */
+  void Reserve(const vector<vector<int> >& max_input_shapes);
+
   Dtype ForwardBackward(const vector<Blob<Dtype>* > & bottom) {
     Dtype loss;
     Forward(bottom, &loss);
@@ -97,7 +155,17 @@ class Net {
    *        another Net.
    */
   void CopyTrainedLayersFrom(const NetParameter& param);
+  /// @brief Copies from a NetParameter file, or maps mapped weights.
   void CopyTrainedLayersFrom(const string trained_filename);
+  /**
+   * @brief For an already initialized net, points the pre-trained layers at
+   *        a copy-on-write mapping of mapped weights (see WriteMappedWeights)
+   *        instead of copying them, for Net<float>; other types copy them.
+   *
+   * The mapping lives as long as the net, or until the next call, after
+   * which the parameters it does not map again are copied out of it.
+   */
+  void MapTrainedLayersFrom(const string& filename);
   /// @brief Writes the net to a proto.
   void ToProto(NetParameter* param, bool write_diff = false) const;
 
@@ -175,6 +243,14 @@ class Net {
 
   void set_debug_info(const bool value) { debug_info_ = value; }
 
+  /**
+   * @brief Sets the Caffe context that is current while the net runs Forward,
+   *        Backward and Reshape, for its mode and RNG; NULL for the calling
+   *        thread's.
+   */
+  void set_context(const shared_ptr<Caffe>& context) { context_ = context; }
+  const shared_ptr<Caffe>& context() const { return context_; }
+
   // Helpers for Init.
   /**
    * @brief Remove layers that the user specified should be excluded given the current
@@ -211,6 +287,20 @@ class Net {
 
   /// @brief Get misc parameters, e.g. the LR multiplier and weight decay.
   void GetLearningRateAndWeightDecay();
+  /**
+   * @brief Let blobs whose lifetimes in Forward do not overlap share memory.
+   *
+   * Only for nets that never run Backward. Blobs that alias each other (as
+   * the tops of Split or Reshape alias their bottom) are planned as one.
+   * Net inputs, net outputs and the tops of layers without bottoms keep
+   * their own memory. Returns the bytes then required for data.
+   */
+  size_t ShareActivationMemory();
+  /**
+   * @brief Lend every layer the net's workspace, grown to the largest
+   *        Layer::workspace_size(). Returns the size of the workspace.
+   */
+  size_t SetUpWorkspace();
 
   /// @brief The network name
   string name_;
@@ -256,12 +346,43 @@ class Net {
   vector<float> params_weight_decay_;
   /// The bytes of memory used by this net
   size_t memory_used_;
+  /// The scratch memory shared by all layers
+  shared_ptr<SyncedMemory> workspace_;
+  /// The mapped weights that the parameters point into, from the last call
+  /// to MapTrainedLayersFrom
+  shared_ptr<MappedWeights> mapped_weights_;
+  /// The weights that the layers share the parameters of, if any
+  shared_ptr<const NetWeights<Dtype> > shared_weights_;
+  /// Whether the activations share memory (see ShareActivationMemory)
+  bool activation_memory_shared_;
+  /// The context that the net runs in, if not the caller's
+  shared_ptr<Caffe> context_;
   /// Whether to compute and display debug info for the net.
   bool debug_info_;
 
   DISABLE_COPY_AND_ASSIGN(Net);
 };
 
+/**
+ * @brief Creates num_nets TEST Net%s from param whose learnable parameters
+ *        are all the blobs of weights, so that the weights are in memory once
+ *        and each net owns only its activations.
+ *
+ * The nets may run Forward concurrently, one thread each. Each has its own
+ * context in the current mode, with an RNG seeded from the current one.
+ *
+ * Weights that layers keep in int8 or fp16 are narrowed once, in the shared
+ * blobs, and what layers compute from the weights, such as the filter
+ * spectra of the FFT convolution engine and the transformed filters of
+ * WinogradConvolutionLayer, is computed once too, in the ParamCache that
+ * the weights hand to every net. (The weight gradient buffers are only
+ * allocated by Backward, which TEST nets skip.)
+ */
+template <typename Dtype>
+void CreateSharedWeightsNets(const NetParameter& param,
+    const shared_ptr<const NetWeights<Dtype> >& weights, int num_nets,
+    vector<shared_ptr<Net<Dtype> > >* nets);
+
 
 }  // namespace caffe
 
@@ -4,6 +4,7 @@
 #include <cstdlib>
 
 #include "caffe/common.hpp"
+#include "caffe/util/host_allocator.hpp"
 #include "caffe/util/math_functions.hpp"
 
 namespace caffe {
@@ -21,14 +22,17 @@ namespace caffe {
 // are constantly accessing them the memory pages almost always stays in
 // the physical memory (assuming we have large enough memory installed), and
 // does not seem to create a memory bottleneck here.
+//
+// The memory comes from the caching allocator of util/host_allocator.hpp, so
+// that transient blobs reuse freed memory instead of calling malloc, and is
+// aligned to kHostAlignment for vectorized kernels.
 
 inline void CaffeMallocHost(void** ptr, size_t size) {
-  *ptr = malloc(size);
-  CHECK(*ptr) << "host allocation of size " << size << " failed";
+  *ptr = HostAllocate(size);
 }
 
 inline void CaffeFreeHost(void* ptr) {
-  free(ptr);
+  HostFree(ptr);
 }
 
 
@@ -42,10 +46,10 @@ class SyncedMemory {
  public:
   SyncedMemory()
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(0), head_(UNINITIALIZED),
-        own_cpu_data_(false) {}
+        own_cpu_data_(false), version_(NewVersion()) {}
   explicit SyncedMemory(size_t size)
       : cpu_ptr_(NULL), gpu_ptr_(NULL), size_(size), head_(UNINITIALIZED),
-        own_cpu_data_(false) {}
+        own_cpu_data_(false), version_(NewVersion()) {}
   ~SyncedMemory();
   const void* cpu_data();
   void set_cpu_data(void* data);
@@ -55,8 +59,16 @@ class SyncedMemory {
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
   SyncedHead head() { return head_; }
   size_t size() { return size_; }
+  /**
+   * @brief A stamp, unique in the process, that changes whenever the memory
+   *        may be written: on construction and on every mutable access or
+   *        set_cpu_data. While the stamp stays the same, the memory was not
+   *        handed out for writing.
+   */
+  size_t version() const { return version_; }
 
  private:
+  static size_t NewVersion();
   void to_cpu();
   void to_gpu();
   void* cpu_ptr_;
@@ -64,6 +76,7 @@ class SyncedMemory {
   size_t size_;
   SyncedHead head_;
   bool own_cpu_data_;
+  size_t version_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
@@ -0,0 +1,52 @@
+#ifndef CAFFE_UTIL_BLOCKING_QUEUE_HPP_
+#define CAFFE_UTIL_BLOCKING_QUEUE_HPP_
+
+#include <queue>
+#include <string>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A thread-safe FIFO queue whose pop() blocks until an element is
+ *        available. Used to hand prefetched batches between threads.
+ *
+ * A blocked pop() is a boost interruption point, so a thread waiting on the
+ * queue can be stopped with InternalThread::StopInternalThread().
+ */
+template <typename T>
+class BlockingQueue {
+ public:
+  BlockingQueue();
+
+  void push(const T& t);
+
+  bool try_pop(T* t);
+
+  // Waits up to timeout_us microseconds for an element.
+  bool try_pop_for(T* t, int timeout_us);
+
+  // Logs log_on_wait once if the caller has to block, which helps to tell
+  // when e.g. data feeding is too slow.
+  T pop(const string& log_on_wait = "");
+
+  size_t size() const;
+
+ protected:
+  /**
+   Move synchronization fields out instead of including boost/thread.hpp
+   to avoid a boost/NVCC issues (#1009, #1010) on OSX. Also fails on
+   Linux CUDA 7.0.18.
+   */
+  class sync;
+
+  std::queue<T> queue_;
+  shared_ptr<sync> sync_;
+
+  DISABLE_COPY_AND_ASSIGN(BlockingQueue);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_BLOCKING_QUEUE_HPP_
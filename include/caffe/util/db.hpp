@@ -18,6 +18,14 @@ class Cursor {
   virtual void Next() = 0;
   virtual string key() = 0;
   virtual string value() = 0;
+  // Non-owning view of the current value, avoiding the copy made by value().
+  // The bytes belong to the database and are only valid until the cursor is
+  // moved or destroyed.
+  virtual const char* value_data() = 0;
+  virtual size_t value_size() = 0;
+  // Whether the views stay valid after the cursor moves on, for as long as
+  // the cursor lives, so that several records can be held at once.
+  virtual bool stable_values() { return false; }
   virtual bool valid() = 0;
 
   DISABLE_COPY_AND_ASSIGN(Cursor);
@@ -32,6 +32,13 @@ class LMDBCursor : public Cursor {
     return string(static_cast<const char*>(mdb_value_.mv_data),
         mdb_value_.mv_size);
   }
+  virtual const char* value_data() {
+    return static_cast<const char*>(mdb_value_.mv_data);
+  }
+  virtual size_t value_size() { return mdb_value_.mv_size; }
+  // The values are in the memory map, which the read-only transaction keeps
+  // in place until it is aborted by the destructor.
+  virtual bool stable_values() { return true; }
   virtual bool valid() { return valid_; }
 
  private:
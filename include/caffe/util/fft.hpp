@@ -0,0 +1,63 @@
+#ifndef CAFFE_UTIL_FFT_HPP_
+#define CAFFE_UTIL_FFT_HPP_
+
+#include <complex>
+#include <vector>
+
+namespace caffe {
+
+/** The smallest power of two that is at least n. */
+int fft_size(const int n);
+
+/**
+ * @brief Radix-2 fast Fourier transforms of height x width complex arrays,
+ *        where height and width are powers of two.
+ *
+ * The twiddle factors and bit reversal permutations are computed by the
+ * constructor, and the transforms are const so that several threads can
+ * share one FFT2D. Real arrays are transformed two at a time, as the real
+ * and imaginary parts of one complex array, and their spectra are kept as
+ * the height x (width / 2 + 1) halves that determine them.
+ */
+template <typename Dtype>
+class FFT2D {
+ public:
+  typedef std::complex<Dtype> Complex;
+
+  FFT2D(const int height, const int width);
+
+  inline int height() const { return height_; }
+  inline int width() const { return width_; }
+  /** The number of elements of a half spectrum. */
+  inline int half_count() const { return height_ * (width_ / 2 + 1); }
+
+  /** Transforms data in place. */
+  void Forward(Complex* data) const;
+  /** Transforms data in place, scaling by 1 / (height * width). */
+  void Inverse(Complex* data) const;
+  /**
+   * @brief Transforms the real arrays a and b, held in data as a + i b, in
+   *    place and writes their half spectra. half_b may be NULL.
+   */
+  void ForwardReal(Complex* data, Complex* half_a, Complex* half_b) const;
+  /**
+   * @brief Fills data with a + i b, for the real arrays a and b of the given
+   *    half spectra. half_b may be NULL, for b = 0.
+   */
+  void InverseReal(const Complex* half_a, const Complex* half_b,
+      Complex* data) const;
+
+ private:
+  void Transform(Complex* data, const bool inverse) const;
+  void Transform1D(Complex* data, const int n, const int stride,
+      const std::vector<Complex>& twiddles, const std::vector<int>& reversal,
+      const bool inverse) const;
+
+  int height_, width_;
+  std::vector<Complex> row_twiddles_, col_twiddles_;
+  std::vector<int> row_reversal_, col_reversal_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FFT_HPP_
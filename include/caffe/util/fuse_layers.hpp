@@ -0,0 +1,30 @@
+#ifndef CAFFE_UTIL_FUSE_LAYERS_HPP_
+#define CAFFE_UTIL_FUSE_LAYERS_HPP_
+
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+// Copy NetParameters with every in-place ReLU, TanH or Sigmoid layer that
+// directly follows a Convolution or InnerProduct layer (no other layer reads
+// the output in between) folded into that layer as its fused_activation.
+// The blobs keep their names, and the fused layers are logged.
+void FuseLayers(const NetParameter& param, NetParameter* param_fused);
+
+// Adds bias[c] (unless bias is NULL) to the data of channel c and applies
+// the activation, in one pass over the outer x channels x inner data.
+template <typename Dtype>
+void bias_activation_cpu(const FusedActivationParameter& activation,
+    const int outer, const int channels, const int inner, const Dtype* bias,
+    Dtype* data);
+
+#ifndef CPU_ONLY
+template <typename Dtype>
+void bias_activation_gpu(const FusedActivationParameter& activation,
+    const int outer, const int channels, const int inner, const Dtype* bias,
+    Dtype* data);
+#endif
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_FUSE_LAYERS_HPP_
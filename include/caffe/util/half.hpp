@@ -0,0 +1,41 @@
+#ifndef CAFFE_UTIL_HALF_HPP_
+#define CAFFE_UTIL_HALF_HPP_
+
+#include <stdint.h>
+
+namespace caffe {
+
+/**
+ * IEEE 754 half precision (fp16) storage: the conversions round to nearest
+ * even, saturate to infinity beyond 65504 and keep subnormals, infinities
+ * and NaNs.
+ */
+uint16_t float_to_half(const float value);
+float half_to_float(const uint16_t value);
+
+template <typename Dtype>
+void caffe_cpu_float2half(const int n, const Dtype* x, uint16_t* y);
+
+template <typename Dtype>
+void caffe_cpu_half2float(const int n, const uint16_t* x, Dtype* y);
+
+/**
+ * @brief The number of Dtype elements of the panel that caffe_cpu_gemm_half
+ *    widens the N x K B into.
+ */
+int caffe_cpu_gemm_half_panel_count(const int N, const int K);
+
+/**
+ * @brief C = alpha A B^T + beta C for the M x K A and the N x K fp16 B, as
+ *    caffe_cpu_gemm: B is widened to Dtype a panel of rows at a time as the
+ *    product reads it, in panel, of caffe_cpu_gemm_half_panel_count(N, K)
+ *    elements.
+ */
+template <typename Dtype>
+void caffe_cpu_gemm_half(const int M, const int N, const int K,
+    const Dtype alpha, const Dtype* A, const uint16_t* B, const Dtype beta,
+    Dtype* C, Dtype* panel);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HALF_HPP_
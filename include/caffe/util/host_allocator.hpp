@@ -0,0 +1,58 @@
+#ifndef CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+#define CAFFE_UTIL_HOST_ALLOCATOR_HPP_
+
+#include <cstddef>
+
+namespace caffe {
+
+/// The alignment of every host allocation, a cache line and the widest SIMD
+/// register.
+const size_t kHostAlignment = 64;
+
+/**
+ * @brief Allocates size bytes of host memory aligned to kHostAlignment.
+ *
+ * Sizes are rounded up to size classes, four to each power of two, and freed
+ * blocks are cached in free lists of the freeing thread by class, so that
+ * allocating what was freed takes no call to the system allocator. Blocks
+ * larger than the largest class go straight back to the system.
+ *
+ * What all threads cache together is capped by host_cache_limit(). A free
+ * that would pass the cap first returns the largest blocks that the freeing
+ * thread caches to the system, and if that does not make room, the freed
+ * block too; so a large free replaces older blocks rather than piling up.
+ */
+void* HostAllocate(size_t size);
+/// @brief Frees memory from HostAllocate, from any thread.
+void HostFree(void* ptr);
+/// @brief Returns the blocks that the calling thread caches to the system.
+void HostReleaseCache();
+
+/// @brief The most bytes that all threads cache together, 256 MB by default.
+size_t host_cache_limit();
+/**
+ * @brief Sets the cap on the cached bytes; 0 turns caching off.
+ *
+ * The calling thread trims its cache to the new cap at once; other threads
+ * hold on to what they cache until their next free.
+ */
+void SetHostCacheLimit(size_t bytes);
+
+struct HostAllocatorStats {
+  /// The bytes of the allocated blocks, by their classes, and the most
+  /// that have been allocated at once
+  size_t bytes_live;
+  size_t peak_bytes_live;
+  /// The bytes of the blocks that threads cache for reuse
+  size_t cached_bytes;
+  /// The blocks allocated, and how many of those the system allocated
+  size_t allocations;
+  size_t system_allocations;
+};
+
+/// @brief The totals of all threads since the process started.
+HostAllocatorStats host_allocator_stats();
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_HOST_ALLOCATOR_HPP_
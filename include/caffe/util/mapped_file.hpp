@@ -0,0 +1,46 @@
+#ifndef CAFFE_UTIL_MAPPED_FILE_HPP_
+#define CAFFE_UTIL_MAPPED_FILE_HPP_
+
+#include <string>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The pages are shared with the OS page cache: mapping a file costs no reads
+ * up front, and several processes mapping the same file share its memory.
+ * A copy-on-write mapping can also be written, in which case the written
+ * pages become private copies and the file is left as it is.
+ */
+class MappedFile {
+ public:
+  MappedFile() : data_(NULL), size_(0), copy_on_write_(false) {}
+  ~MappedFile() { Close(); }
+
+  /** Maps filename, dying with a message if that is not possible. */
+  void Open(const string& filename, bool copy_on_write = false);
+  void Close();
+
+  inline bool is_open() const { return data_ != NULL; }
+  inline const char* data() const { return data_; }
+  /** The data of a copy-on-write mapping. */
+  inline char* mutable_data() const {
+    CHECK(copy_on_write_) << "The mapping is read-only";
+    return const_cast<char*>(data_);
+  }
+  inline size_t size() const { return size_; }
+
+ protected:
+  const char* data_;
+  size_t size_;
+  bool copy_on_write_;
+
+  DISABLE_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_MAPPED_FILE_HPP_
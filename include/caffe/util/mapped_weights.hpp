@@ -0,0 +1,90 @@
+#ifndef CAFFE_UTIL_MAPPED_WEIGHTS_HPP_
+#define CAFFE_UTIL_MAPPED_WEIGHTS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief On-disk layout of mapped weights: the parameters of a trained net
+ *    as float32 arrays that can be used straight out of a memory mapping.
+ *
+ * The file holds this header, then the index: a serialized NetParameter
+ * naming every layer and giving the shapes of its blobs, without their data,
+ * in the legacy num, channels, height and width for blobs that had them.
+ * The data starts at data_offset, a multiple of kMappedWeightsDataAlignment,
+ * with the blobs in index order and each one starting on the next multiple
+ * of kMappedWeightsBlobAlignment. All fields are little-endian.
+ */
+struct MappedWeightsHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t index_offset;
+  uint64_t index_size;
+  uint64_t data_offset;
+};
+
+const char kMappedWeightsMagic[8] = {'C', 'A', 'F', 'F', 'E', 'W', 'T', 'S'};
+const uint32_t kMappedWeightsVersion = 1;
+const uint64_t kMappedWeightsDataAlignment = 4096;
+const uint64_t kMappedWeightsBlobAlignment = 64;
+
+/**
+ * @brief The shape that Blob::FromProto gives the blob of proto: the legacy
+ *    num, channels, height and width if it has any of them, or its shape.
+ */
+void BlobProtoShape(const BlobProto& proto, vector<int>* shape);
+
+/** Whether filename starts like mapped weights rather than a NetParameter. */
+bool IsMappedWeightsFile(const string& filename);
+
+/**
+ * @brief Writes the blobs of the layers of param, which may be stored in any
+ *    of the encodings that Blob::FromProto reads, as mapped weights.
+ */
+void WriteMappedWeights(const NetParameter& param, const string& filename);
+
+/**
+ * @brief Copy-on-write memory mapping of mapped weights.
+ *
+ * The data can be written, but what is written stays private to the process
+ * and never reaches the file.
+ */
+class MappedWeights {
+ public:
+  MappedWeights() {}
+
+  /** Maps filename and validates it, dying if it is malformed. */
+  void Open(const string& filename);
+
+  /** The layer names and blob shapes, without data. */
+  inline const NetParameter& index() const { return index_; }
+  /** Whether data points into the mapping. */
+  inline bool contains(const void* data) const {
+    const char* p = static_cast<const char*>(data);
+    return p >= file_.data() && p < file_.data() + file_.size();
+  }
+  /** The count() floats of blob j of layer i of the index. */
+  inline float* data(int i, int j) const {
+    return reinterpret_cast<float*>(file_.mutable_data() + offsets_[i][j]);
+  }
+
+ protected:
+  MappedFile file_;
+  NetParameter index_;
+  vector<vector<uint64_t> > offsets_;
+
+  DISABLE_COPY_AND_ASSIGN(MappedWeights);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_MAPPED_WEIGHTS_HPP_
@@ -32,28 +32,35 @@ extern "C" {
   }
 
 DEFINE_VSL_UNARY_FUNC(Sqr, y[i] = a[i] * a[i]);
-DEFINE_VSL_UNARY_FUNC(Exp, y[i] = exp(a[i]));
-DEFINE_VSL_UNARY_FUNC(Ln, y[i] = log(a[i]));
 DEFINE_VSL_UNARY_FUNC(Abs, y[i] = fabs(a[i]));
 
-// A simple way to define the vsl unary functions with singular parameter b.
-// The operation should be in the form e.g. y[i] = pow(a[i], b)
-#define DEFINE_VSL_UNARY_FUNC_WITH_PARAM(name, operation) \
-  template<typename Dtype> \
-  void v##name(const int n, const Dtype* a, const Dtype b, Dtype* y) { \
+// The single precision transcendental functions are vectorized polynomial
+// approximations, defined in mkl_alternate.cpp along with their accuracy:
+// within 2 ulp of the exact result, except powx with a general exponent b,
+// whose error grows with |b log a|.
+void vsExp(const int n, const float* a, float* y);
+void vsLn(const int n, const float* a, float* y);
+void vsLog1p(const int n, const float* a, float* y);
+void vsTanh(const int n, const float* a, float* y);
+void vsPowx(const int n, const float* a, const float b, float* y);
+
+// The double precision ones are those of the math library.
+#define DEFINE_VSL_DOUBLE_UNARY_FUNC(name, operation) \
+  inline void vd##name( \
+      const int n, const double* a, double* y) { \
     CHECK_GT(n, 0); CHECK(a); CHECK(y); \
     for (int i = 0; i < n; ++i) { operation; } \
-  } \
-  inline void vs##name( \
-    const int n, const float* a, const float b, float* y) { \
-    v##name<float>(n, a, b, y); \
-  } \
-  inline void vd##name( \
-      const int n, const double* a, const float b, double* y) { \
-    v##name<double>(n, a, b, y); \
   }
 
-DEFINE_VSL_UNARY_FUNC_WITH_PARAM(Powx, y[i] = pow(a[i], b));
+DEFINE_VSL_DOUBLE_UNARY_FUNC(Exp, y[i] = exp(a[i]));
+DEFINE_VSL_DOUBLE_UNARY_FUNC(Ln, y[i] = log(a[i]));
+DEFINE_VSL_DOUBLE_UNARY_FUNC(Log1p, y[i] = log1p(a[i]));
+DEFINE_VSL_DOUBLE_UNARY_FUNC(Tanh, y[i] = tanh(a[i]));
+
+inline void vdPowx(const int n, const double* a, const float b, double* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  for (int i = 0; i < n; ++i) { y[i] = pow(a[i], b); }
+}
 
 // A simple way to define the vsl binary functions. The operation should
 // be in the form e.g. y[i] = a[i] + b[i]
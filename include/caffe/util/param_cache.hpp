@@ -0,0 +1,54 @@
+#ifndef CAFFE_UTIL_PARAM_CACHE_HPP_
+#define CAFFE_UTIL_PARAM_CACHE_HPP_
+
+#include <boost/function.hpp>
+
+#include <map>
+#include <string>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Blobs that a layer computes from its parameters, such as transformed
+ *        filters, kept for as long as the parameters do not change.
+ *
+ * The layers of nets that share their parameters share their cache as well
+ * (see NetWeights), so a blob is computed once, by whichever layer asks
+ * first, and held in memory once. A cached blob is never written again:
+ * parameters at a new version get a new blob, so layers may keep reading the
+ * blob they have while another layer replaces it.
+ */
+template <typename Dtype>
+class ParamCache {
+ public:
+  /// Reshapes and fills the blob.
+  typedef boost::function<void(Blob<Dtype>*)> ComputeFn;
+
+  ParamCache();
+
+  /**
+   * @brief The blob cached under key, first computed by compute unless it
+   *        was computed from the parameters at version.
+   *
+   * Safe to call from several threads; the others wait while one computes.
+   * version is what the parameters were at, such as Blob::data_version.
+   */
+  shared_ptr<const Blob<Dtype> > Get(const string& key, size_t version,
+      const ComputeFn& compute);
+
+ protected:
+  /// Guards the entries, kept out of the header as in BlockingQueue.
+  class sync;
+
+  map<string, pair<size_t, shared_ptr<const Blob<Dtype> > > > entries_;
+  shared_ptr<sync> sync_;
+
+  DISABLE_COPY_AND_ASSIGN(ParamCache);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_PARAM_CACHE_HPP_
@@ -0,0 +1,54 @@
+#ifndef CAFFE_UTIL_QUANTIZE_HPP_
+#define CAFFE_UTIL_QUANTIZE_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+/**
+ * Symmetric linear int8 quantization: x is represented by
+ * round(x / scale), clamped to [-127, 127].
+ */
+
+/** The scale that represents magnitudes up to max_abs; 1 for max_abs 0. */
+template <typename Dtype>
+Dtype int8_scale(const Dtype max_abs);
+
+template <typename Dtype>
+void quantize_int8_cpu(const int count, const Dtype* x, const Dtype scale,
+    int8_t* q);
+
+/** Quantizes every row of the rows x cols x with a scale of its own. */
+template <typename Dtype>
+void quantize_rows_int8_cpu(const int rows, const int cols, const Dtype* x,
+    int8_t* q, Dtype* scales);
+
+/**
+ * @brief C = A B^T for the M x K A and the N x K B, with int32 accumulation:
+ *    every output is the dot product of a row of A and a row of B.
+ *
+ * Portable code, without int8 instructions: it beats a tuned sgemm only
+ * when reading B dominates, as for an inner product on one image (4x on
+ * 1x4096x9216), and is 2-7x slower than sgemm once M reaches 10 or more.
+ */
+void int8_gemm_cpu(const int M, const int N, const int K, const int8_t* A,
+    const int8_t* B, int32_t* C);
+
+/**
+ * @brief Writes the blob to proto with its rows (along the first axis)
+ *    quantized to int8_data, which Blob::FromProto reads back as int8 (see
+ *    Blob::ToInt8).
+ */
+template <typename Dtype>
+void QuantizeBlobProto(const Blob<Dtype>& blob, BlobProto* proto);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_QUANTIZE_HPP_
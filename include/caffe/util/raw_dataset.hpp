@@ -0,0 +1,116 @@
+#ifndef CAFFE_UTIL_RAW_DATASET_HPP_
+#define CAFFE_UTIL_RAW_DATASET_HPP_
+
+#include <stdint.h>
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief On-disk layout of a raw dataset: fixed-size samples stored as
+ *    plain CHW arrays that can be used straight out of a memory mapping.
+ *
+ * The file holds this header, padded to kRawDatasetDataAlignment bytes, then
+ * num records of record_stride bytes each, then one int32 label per record.
+ * record_stride is the sample size rounded up to kRawDatasetRecordAlignment,
+ * so every record starts on a cache line. All fields are little-endian.
+ */
+struct RawDatasetHeader {
+  enum DataType { UINT8 = 0, FLOAT32 = 1 };
+
+  char magic[8];
+  uint32_t version;
+  uint32_t data_type;
+  uint32_t channels;
+  uint32_t height;
+  uint32_t width;
+  uint32_t reserved;
+  uint64_t num;
+  uint64_t record_stride;
+  uint64_t data_offset;
+  uint64_t label_offset;
+};
+
+const char kRawDatasetMagic[8] = {'C', 'A', 'F', 'F', 'E', 'R', 'A', 'W'};
+const uint32_t kRawDatasetVersion = 1;
+const uint64_t kRawDatasetDataAlignment = 4096;
+const uint64_t kRawDatasetRecordAlignment = 64;
+
+/** Size in bytes of one element of the given RawDatasetHeader::DataType. */
+size_t RawDatasetElementSize(uint32_t data_type);
+
+/**
+ * @brief Writes a raw dataset record by record.
+ *
+ * The header is only complete once Close() has been called.
+ */
+class RawDatasetWriter {
+ public:
+  RawDatasetWriter(const string& filename,
+      RawDatasetHeader::DataType data_type, int channels, int height,
+      int width);
+  ~RawDatasetWriter() { Close(); }
+
+  /**
+   * @brief Appends one sample of channels x height x width elements of the
+   *    writer's data type, in CHW order.
+   */
+  void Write(const void* data, int label);
+  void Close();
+
+  inline uint64_t num() const { return header_.num; }
+
+ protected:
+  std::ofstream file_;
+  RawDatasetHeader header_;
+  vector<int32_t> labels_;
+  vector<char> padding_;
+
+  DISABLE_COPY_AND_ASSIGN(RawDatasetWriter);
+};
+
+/** @brief Read-only, memory mapped view of a raw dataset. */
+class RawDataset {
+ public:
+  RawDataset() {}
+
+  /** Maps filename and validates its header, dying if it is malformed. */
+  void Open(const string& filename);
+  void Close() { file_.Close(); }
+
+  inline const RawDatasetHeader& header() const { return header_; }
+  inline int num() const { return header_.num; }
+  inline int channels() const { return header_.channels; }
+  inline int height() const { return header_.height; }
+  inline int width() const { return header_.width; }
+  inline uint32_t data_type() const { return header_.data_type; }
+  /** Number of elements in one sample. */
+  inline int sample_count() const {
+    return header_.channels * header_.height * header_.width;
+  }
+
+  /** Start of the elements of sample i, valid while the dataset is open. */
+  inline const void* record(int i) const {
+    return file_.data() + header_.data_offset + i * header_.record_stride;
+  }
+  inline int label(int i) const {
+    return reinterpret_cast<const int32_t*>(
+        file_.data() + header_.label_offset)[i];
+  }
+
+ protected:
+  MappedFile file_;
+  RawDatasetHeader header_;
+
+  DISABLE_COPY_AND_ASSIGN(RawDataset);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_RAW_DATASET_HPP_
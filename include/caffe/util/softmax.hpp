@@ -0,0 +1,38 @@
+#ifndef CAFFE_UTIL_SOFTMAX_HPP_
+#define CAFFE_UTIL_SOFTMAX_HPP_
+
+#include <cstddef>
+
+namespace caffe {
+
+class ThreadPool;
+
+/**
+ * @brief Computes the softmax over the channels of input, laid out as
+ *        outer_num x channels x inner_num, into output.
+ *
+ * Each of the outer_num * inner_num distributions is done in one sweep that
+ * finds the maximum and one that exponentiates and sums, with the
+ * normalization applied while the results are still in cache. Positions that
+ * are contiguous (inner_num > 1) are processed in blocks, so the loops run
+ * over contiguous memory either way. output may be input.
+ *
+ * If log_norm is not NULL it receives, for every position, the log of the
+ * normalizer: max + log(sum(exp(x - max))), so that the log-probability of
+ * channel c is input[c] - log_norm. If pool is not NULL the positions are
+ * split over its threads.
+ */
+template <typename Dtype>
+void caffe_cpu_softmax(const int outer_num, const int channels,
+    const int inner_num, const Dtype* input, Dtype* output,
+    Dtype* log_norm = NULL, ThreadPool* pool = NULL);
+
+/// @brief As caffe_cpu_softmax, but output receives the log-probabilities.
+template <typename Dtype>
+void caffe_cpu_log_softmax(const int outer_num, const int channels,
+    const int inner_num, const Dtype* input, Dtype* output,
+    ThreadPool* pool = NULL);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SOFTMAX_HPP_
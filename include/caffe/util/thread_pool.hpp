@@ -0,0 +1,65 @@
+#ifndef CAFFE_UTIL_THREAD_POOL_HPP_
+#define CAFFE_UTIL_THREAD_POOL_HPP_
+
+#include <boost/function.hpp>
+
+#include <vector>
+
+#include "caffe/common.hpp"
+
+/**
+ Forward declare boost::thread and friends instead of including
+ boost/thread.hpp to avoid boost/NVCC issues (#1009, #1010) on OSX.
+ */
+namespace boost {
+class thread;
+class mutex;
+class condition_variable;
+}
+
+namespace caffe {
+
+/**
+ * @brief A fixed set of persistent worker threads that run indexed tasks.
+ *
+ * Run(num_tasks, task) calls task(i) once for every i in [0, num_tasks) and
+ * blocks until all of them have returned. The calling thread takes part in
+ * the work, so a pool of size 1 owns no extra thread and runs everything
+ * inline. Which thread runs which index is unspecified: tasks that need
+ * reproducible results should derive all their state from the index.
+ *
+ * Run is not re-entrant; a pool serves one caller at a time.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  void Run(int num_tasks, const boost::function<void(int)>& task);
+
+  /** Total number of threads doing work, including the caller. */
+  inline int size() const { return workers_.size() + 1; }
+
+ protected:
+  void WorkerEntry();
+  // Claims and runs tasks of the current job until none are left.
+  void RunPendingTasks(boost::function<void(int)> task, int generation);
+
+  vector<shared_ptr<boost::thread> > workers_;
+  shared_ptr<boost::mutex> mutex_;
+  shared_ptr<boost::condition_variable> job_ready_;
+  shared_ptr<boost::condition_variable> job_done_;
+
+  boost::function<void(int)> task_;
+  int num_tasks_;
+  int next_task_;
+  int unfinished_tasks_;
+  int generation_;
+  bool stop_;
+
+  DISABLE_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_THREAD_POOL_HPP_
@@ -0,0 +1,33 @@
+#ifndef CAFFE_UTIL_TOP_K_HPP_
+#define CAFFE_UTIL_TOP_K_HPP_
+
+#include <utility>
+
+namespace caffe {
+
+/**
+ * @brief Finds the largest of the channels scores of each of n positions.
+ *
+ * Channel c of position k is x[c * inner_num + k], so the positions are
+ * contiguous and are all scanned together. index receives the n argmaxes and
+ * value, if not NULL, the maxima. Ties go to the larger channel, as when
+ * (score, channel) pairs are sorted in decreasing order.
+ */
+template <typename Dtype>
+void caffe_cpu_argmax(const int channels, const int inner_num, const int n,
+    const Dtype* x, int* index, Dtype* value);
+
+/**
+ * @brief Finds the top_k largest of the channels scores x[0], x[inner_num],
+ *        ..., into top as (score, channel) pairs in decreasing order.
+ *
+ * The candidates are kept in a heap in top itself, so nothing is allocated;
+ * top_k == 1 is caffe_cpu_argmax. Ties are broken as by caffe_cpu_argmax.
+ */
+template <typename Dtype>
+void caffe_cpu_top_k(const int channels, const int inner_num, const Dtype* x,
+    const int top_k, std::pair<Dtype, int>* top);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_TOP_K_HPP_
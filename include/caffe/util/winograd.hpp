@@ -0,0 +1,50 @@
+#ifndef CAFFE_UTIL_WINOGRAD_HPP_
+#define CAFFE_UTIL_WINOGRAD_HPP_
+
+namespace caffe {
+
+/**
+ * @brief Winograd minimal filtering F(tile x tile, 3x3) for stride 1
+ *        convolutions with 3x3 filters.
+ *
+ * Every tile x tile block of the output is computed from a
+ * (tile + 2) x (tile + 2) block of the input. Input blocks and filters are
+ * transformed so that the reduction over input channels becomes one gemm per
+ * element of the transformed block, taking 16 (tile 2) or 36 (tile 4)
+ * multiplications per output block instead of 36 or 144. tile 4 does less
+ * arithmetic but rounds more.
+ */
+
+/** The size (tile + 2) of the transformed blocks; tile must be 2 or 4. */
+int winograd_block_size(const int tile);
+
+/** The number of output tiles covering a height_out x width_out output. */
+int winograd_num_tiles(const int tile, const int height_out,
+    const int width_out);
+
+/**
+ * @brief Transforms num_output x channels_per_group x 3 x 3 filters into
+ *    block^2 x num_output x channels_per_group.
+ */
+template <typename Dtype>
+void winograd_transform_filters_cpu(const int tile, const int num_output,
+    const int channels_per_group, const Dtype* weights, Dtype* transformed);
+
+/**
+ * @brief Convolves one channels x height x width image with filters
+ *    transformed by winograd_transform_filters_cpu.
+ *
+ * input_blocks needs block^2 x channels x num_tiles elements and
+ * output_blocks block^2 x num_output x num_tiles, for the num_tiles of the
+ * height_out x width_out output, where height_out = height + 2 * pad_h - 2.
+ */
+template <typename Dtype>
+void winograd_conv_cpu(const int tile, const Dtype* data_im,
+    const int channels, const int height, const int width,
+    const int num_output, const int group, const int pad_h, const int pad_w,
+    const Dtype* transformed, Dtype* input_blocks, Dtype* output_blocks,
+    Dtype* data_out);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_WINOGRAD_HPP_
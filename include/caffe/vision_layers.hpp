@@ -13,6 +13,8 @@
 #include "caffe/loss_layers.hpp"
 #include "caffe/neuron_layers.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/fft.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -34,19 +36,48 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   virtual inline int MinTopBlobs() const { return 1; }
   virtual inline bool EqualNumBottomTopBlobs() const { return true; }
 
+  virtual size_t workspace_size() const;
+  virtual void SetWorkspace(const shared_ptr<SyncedMemory>& workspace);
+
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
-  // The last argument in forward_cpu_gemm is so that we can skip the im2col if
-  // we just called weight_cpu_gemm with the same input.
+  // The skip_im2col argument in forward_cpu_gemm is so that we can skip the
+  // im2col if we just called weight_cpu_gemm with the same input. The CPU
+  // helpers must be called from cpu_for_each_image with its thread_id, which
+  // picks the column buffer they use.
   void forward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output, bool skip_im2col = false);
+      Dtype* output, bool skip_im2col = false, int thread_id = 0);
   void forward_cpu_bias(Dtype* output, const Dtype* bias);
   void backward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output);
+      Dtype* output, int thread_id = 0);
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
-      weights);
+      weights, int thread_id = 0);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
 
+  // Calls image_fn(n, thread_id) for every image n of the batch. The batch is
+  // split into num_threads_ contiguous ranges that run in parallel; thread_id
+  // is the index of the range. Pass backward for the passes of Backward_cpu,
+  // which may read the column buffer when Forward_cpu does not.
+  void cpu_for_each_image(const boost::function<void(int, int)>& image_fn,
+      bool backward = false);
+  // Whether Forward_cpu reads the column buffer. When it does not, TEST nets
+  // lend the layer no workspace (see workspace_size).
+  virtual bool forward_cpu_uses_col_buffer() const {
+    return !is_1x1_ && !use_fft_ && !quantized_;
+  }
+  // Readies the weight gradient buffers of the other threads; to be called
+  // before cpu_for_each_image on a pass that uses cpu_weight_diff.
+  void prepare_weight_diff();
+  // Where thread_id accumulates the weight gradient: weight_diff itself for
+  // the first thread, a buffer of its own for the others.
+  Dtype* cpu_weight_diff(Dtype* weight_diff, int thread_id);
+  // Adds the weight gradients of the other threads to weight_diff.
+  void reduce_weight_diff(Dtype* weight_diff);
+  // forward_cpu_gemm with the input and weights quantized to int8, when
+  // quantized_.
+  void forward_cpu_gemm_int8(const Dtype* input, Dtype* output,
+      int thread_id = 0);
+
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
       Dtype* output, bool skip_im2col = false);
@@ -75,8 +106,34 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   int height_out_, width_out_;
   bool bias_term_;
   bool is_1x1_;
+  // The number of elements in one image of the bottoms and of the tops.
+  int bottom_dim_, top_dim_;
+  // Whether Forward runs quantized to int8 (see QuantizationParameter).
+  bool quantized_;
 
  private:
+  // Runs image_fn on the images of range thread_id (see cpu_for_each_image).
+  void cpu_image_range(const boost::function<void(int, int)>& image_fn,
+      int thread_id);
+  // The column buffer of thread_id. cpu_for_each_image makes the CPU copy
+  // current beforehand, so that the threads do not race to update the
+  // state of the SyncedMemory.
+  inline Dtype* cpu_col_buffer(int thread_id) {
+    return const_cast<Dtype*>(col_buffer_.cpu_data()) +
+        col_buffer_.offset(thread_id);
+  }
+  // The FFT engine: Reshape picks the size of the FFTs and whether they beat
+  // im2col and gemm, and then forward_cpu_gemm correlates and
+  // backward_cpu_gemm convolves through the spectra of tiles of the image
+  // instead. Weight gradients always go through im2col and gemm.
+  void fft_reshape();
+  // Gets the filter spectra, again if the weights changed since the last
+  // call.
+  void fft_update_filters();
+  // Computes the filter spectra, for the param_cache.
+  void fft_compute_filters(Blob<Dtype>* spectra);
+  void fft_correlate_cpu(const Dtype* input, Dtype* output, int thread_id);
+  void fft_convolve_cpu(const Dtype* input, Dtype* output, int thread_id);
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
   inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff) {
     im2col_cpu(data, conv_in_channels_, conv_in_height_, conv_in_width_,
@@ -100,6 +157,8 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   int conv_out_channels_;
   int conv_in_channels_;
   int conv_out_spatial_dim_;
+  int conv_out_height_;
+  int conv_out_width_;
   int conv_in_height_;
   int conv_in_width_;
   int kernel_dim_;
@@ -107,8 +166,39 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   int col_offset_;
   int output_offset_;
 
+  // One image worth of columns per thread in CPU mode.
   Blob<Dtype> col_buffer_;
   Blob<Dtype> bias_multiplier_;
+
+  int num_threads_;
+  shared_ptr<ThreadPool> thread_pool_;
+  // The weight gradients of all threads but the first, kept zeroed between
+  // calls to reduce_weight_diff. Empty until the first Backward.
+  Blob<Dtype> weight_diff_buffer_;
+
+  // Whether fft_reshape has run, and what it chose. The FFT plans and
+  // buffers below only exist while use_fft_ is true.
+  bool fft_decided_;
+  bool use_fft_;
+  shared_ptr<FFT2D<Dtype> > fft_;
+  // The output rows and columns, in the geometry of forward_cpu_gemm, that
+  // one FFT computes.
+  int fft_tile_h_, fft_tile_w_;
+  // The half spectra of the filters (see FFT2D) from the param_cache, and
+  // the version of the weights they were computed from.
+  shared_ptr<const Blob<Dtype> > fft_filters_;
+  size_t fft_filters_version_;
+  // Per thread: one FFT worth of complex data, the spectra of all channels
+  // of a tile and two accumulated output spectra.
+  shared_ptr<Blob<Dtype> > fft_buffer_;
+
+  // The weights are kept in int8 in blobs_[0] (see Blob::ToInt8).
+  Dtype input_scale_;
+  // Per thread: the quantized image, the patch rows of one group and the
+  // int32 output.
+  vector<int8_t> int8_input_;
+  vector<int8_t> int8_row_buffer_;
+  vector<int32_t> int32_output_;
 };
 
 /**
@@ -157,9 +247,21 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
    *  - bias_term (\b optional, default true). Whether to have a bias.
    *  - engine: convolution has CAFFE (matrix multiplication) and CUDNN (library
    *    kernels + stream parallelism) engines.
+   *  - num_threads (\b optional, default 1). The number of threads the CAFFE
+   *    engine splits the batch over in CPU mode.
+   *  - engine FFT convolves through FFTs in CPU mode where that takes fewer
+   *    operations than im2col and gemm, which is the case for large kernels.
+   *    fft_crossover (\b optional, default true) can be set to false to use
+   *    FFTs regardless.
+   *  - cpu_method (\b optional, default AUTO). Whether the CAFFE engine
+   *    convolves directly, without im2col, in CPU mode: AUTO does for the
+   *    depthwise-like shapes where that is faster, GEMM and DIRECT force
+   *    one or the other.
    */
   explicit ConvolutionLayer(const LayerParameter& param)
       : BaseConvolutionLayer<Dtype>(param) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
 
   virtual inline const char* type() const { return "Convolution"; }
 
@@ -173,7 +275,22 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return false; }
+  virtual bool forward_cpu_uses_col_buffer() const {
+    return BaseConvolutionLayer<Dtype>::forward_cpu_uses_col_buffer() &&
+        !use_direct_;
+  }
+  // Process image n of one bottom/top pair in CPU mode; bias, weight_diff and
+  // bottom_diff are NULL when not needed.
+  void forward_cpu_image(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int n, int thread_id);
+  void backward_cpu_image(const Dtype* top_diff, const Dtype* bottom_data,
+      const Dtype* weight, Dtype* weight_diff, Dtype* bottom_diff, int n,
+      int thread_id);
   virtual void compute_output_shape();
+
+  // Whether Forward_cpu convolves directly rather than through im2col.
+  bool use_direct_;
+  bool direct_logged_;
 };
 
 /**
@@ -208,6 +325,12 @@ class DeconvolutionLayer : public BaseConvolutionLayer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return true; }
+  // See ConvolutionLayer.
+  void forward_cpu_image(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int n, int thread_id);
+  void backward_cpu_image(const Dtype* top_diff, const Dtype* bottom_data,
+      const Dtype* weight, Dtype* weight_diff, Dtype* bottom_diff, int n,
+      int thread_id);
   virtual void compute_output_shape();
 };
 
@@ -237,6 +360,10 @@ class CuDNNConvolutionLayer : public ConvolutionLayer<Dtype> {
       const vector<Blob<Dtype>*>& top);
   virtual ~CuDNNConvolutionLayer();
 
+  // cuDNN manages its own workspace; the column buffer is never used.
+  virtual inline size_t workspace_size() const { return 0; }
+  virtual void SetWorkspace(const shared_ptr<SyncedMemory>& workspace) {}
+
  protected:
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
@@ -256,6 +383,51 @@ class CuDNNConvolutionLayer : public ConvolutionLayer<Dtype> {
 };
 #endif
 
+/**
+ * @brief Convolves 3x3 filters with stride 1 by Winograd minimal filtering
+ *        (see util/winograd.hpp) in CPU mode.
+ *        Fallback to ConvolutionLayer for GPU mode.
+ *
+ * The transformed filters are kept in the param_cache for as long as the
+ * weights do not change, which in the TEST phase is across iterations, and
+ * shared by the nets that share the weights. Backward computes the
+ * gradient w.r.t. the bottom by Winograd too, convolving the top diff with
+ * the flipped filters, and the gradient w.r.t. the weights by im2col + gemm.
+ */
+template <typename Dtype>
+class WinogradConvolutionLayer : public ConvolutionLayer<Dtype> {
+ public:
+  explicit WinogradConvolutionLayer(const LayerParameter& param)
+      : ConvolutionLayer<Dtype>(param) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+
+  // Gets the transformed filters for Forward, or for Backward, again if the
+  // weights have changed since they were computed.
+  void TransformFilters(bool backward);
+  // Transforms the weights into filters, for the param_cache.
+  void ComputeForwardFilters(Blob<Dtype>* filters);
+  void ComputeBackwardFilters(Blob<Dtype>* filters);
+
+  int tile_;
+  // The transformed filters, and the version of the weights they were
+  // computed from (see Blob::data_version).
+  shared_ptr<const Blob<Dtype> > forward_filters_;
+  shared_ptr<const Blob<Dtype> > backward_filters_;
+  size_t forward_filters_version_;
+  size_t backward_filters_version_;
+  Blob<Dtype> input_blocks_;
+  Blob<Dtype> output_blocks_;
+};
+
 /**
  * @brief A helper for image operations that rearranges image regions into
  *        column vectors.  Used by ConvolutionLayer to perform convolution
@@ -301,6 +473,10 @@ template <typename Dtype> class SplitLayer;
 /**
  * @brief Normalize the input in a local region across or within feature maps.
  *
+ * In CPU mode, normalization across channels slides the window sum of
+ * squares over the channels of tiles of positions, and splits the tiles of
+ * the batch over lrn_param.num_threads threads.
+ *
  * TODO(dox): thorough documentation for Forward, Backward, and proto params.
  */
 template <typename Dtype>
@@ -340,6 +516,14 @@ class LRNLayer : public Layer<Dtype> {
   virtual void WithinChannelBackward(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
 
+  // The tiles of positions of the batch are split into num_threads_
+  // contiguous ranges; these normalize the thread_id-th across channels.
+  void cross_channel_forward_cpu_range(const Dtype* bottom_data,
+      Dtype* top_data, int thread_id);
+  void cross_channel_backward_cpu_range(const Dtype* top_diff,
+      const Dtype* top_data, const Dtype* bottom_data, Dtype* bottom_diff,
+      int thread_id);
+
   int size_;
   int pre_pad_;
   Dtype alpha_;
@@ -351,8 +535,12 @@ class LRNLayer : public Layer<Dtype> {
   int width_;
 
   // Fields used for normalization ACROSS_CHANNELS
-  // scale_ stores the intermediate summing results
+  // scale_ stores the intermediate summing results of the GPU kernels
   Blob<Dtype> scale_;
+  int num_threads_;
+  shared_ptr<ThreadPool> thread_pool_;
+  // The per-thread ratios of the CPU backward pass: one tile per channel
+  Blob<Dtype> ratio_buffer_;
 
   // Fields used for normalization WITHIN_CHANNEL
   shared_ptr<SplitLayer<Dtype> > split_layer_;
@@ -377,6 +565,11 @@ class LRNLayer : public Layer<Dtype> {
 /**
  * @brief Pools the input image by taking the max, average, etc. within regions.
  *
+ * In CPU mode the planes of the batch are split over
+ * pooling_param.num_threads threads, and 2x2 and 3x3 windows with stride 2
+ * are pooled by specialized kernels. MAX pooling in the TEST phase with a
+ * single top keeps no argmax mask.
+ *
  * TODO(dox): thorough documentation for Forward, Backward, and proto params.
  */
 template <typename Dtype>
@@ -409,6 +602,22 @@ class PoolingLayer : public Layer<Dtype> {
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
 
+  // Calls plane_fn(p) for every plane p of the num * channels planes of the
+  // batch, split into num_threads_ contiguous ranges that run in parallel.
+  void cpu_for_each_plane(int num_planes,
+      const boost::function<void(int)>& plane_fn);
+  void cpu_plane_range(int num_planes,
+      const boost::function<void(int)>& plane_fn, int thread_id);
+  // Pools plane p. mask or top_mask receive the argmax of MAX pooling unless
+  // both are NULL.
+  void forward_cpu_plane(const Dtype* bottom_data, Dtype* top_data,
+      int* mask, Dtype* top_mask, int p);
+  // Propagates the top diff of plane p. MAX pooling without a mask finds the
+  // argmax again in bottom_data.
+  void backward_cpu_plane(const Dtype* top_diff, const int* mask,
+      const Dtype* top_mask, const Dtype* bottom_data, Dtype* bottom_diff,
+      int p);
+
   int kernel_h_, kernel_w_;
   int stride_h_, stride_w_;
   int pad_h_, pad_w_;
@@ -418,6 +627,16 @@ class PoolingLayer : public Layer<Dtype> {
   bool global_pooling_;
   Blob<Dtype> rand_idx_;
   Blob<int> max_idx_;
+  // MAX pooling in the TEST phase without a mask top neither writes nor
+  // needs max_idx_ in CPU mode.
+  bool mask_free_;
+  // The side of square kernels with stride 2 and no padding that have
+  // specialized CPU kernels, 2 or 3, else 0; they pool the outputs before
+  // full_height_ and full_width_, whose windows lie inside the input.
+  int fast_kernel_;
+  int full_height_, full_width_;
+  int num_threads_;
+  shared_ptr<ThreadPool> thread_pool_;
 };
 
 #ifdef USE_CUDNN
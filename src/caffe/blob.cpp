@@ -1,10 +1,13 @@
 #include <climits>
+#include <cstring>
 #include <vector>
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/syncedmem.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/quantize.hpp"
 
 namespace caffe {
 
@@ -22,14 +25,21 @@ void Blob<Dtype>::Reshape(const int num, const int channels, const int height,
 template <typename Dtype>
 void Blob<Dtype>::Reshape(const vector<int>& shape) {
   CHECK_LE(shape.size(), kMaxBlobAxes);
+  const int old_count = count_;
   count_ = 1;
   shape_.resize(shape.size());
   for (int i = 0; i < shape.size(); ++i) {
     CHECK_GE(shape[i], 0);
-    CHECK_LE(shape[i], INT_MAX / count_) << "blob size exceeds INT_MAX";
+    if (count_ != 0) {
+      CHECK_LE(shape[i], INT_MAX / count_) << "blob size exceeds INT_MAX";
+    }
     count_ *= shape[i];
     shape_[i] = shape[i];
   }
+  // Resized data is undefined, narrowed or not.
+  if (count_ != old_count) {
+    DropNarrowed();
+  }
   if (count_ > capacity_) {
     capacity_ = count_;
     data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
@@ -56,32 +66,36 @@ template <typename Dtype>
 Blob<Dtype>::Blob(const int num, const int channels, const int height,
     const int width)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : keep_half_(false), keep_int8_rows_(0), count_(0), capacity_(0) {
   Reshape(num, channels, height, width);
 }
 
 template <typename Dtype>
 Blob<Dtype>::Blob(const vector<int>& shape)
   // capacity_ must be initialized before calling Reshape
-  : capacity_(0) {
+  : keep_half_(false), keep_int8_rows_(0), count_(0), capacity_(0) {
   Reshape(shape);
 }
 
 template <typename Dtype>
 const Dtype* Blob<Dtype>::cpu_data() const {
   CHECK(data_);
+  CheckWide();
   return (const Dtype*)data_->cpu_data();
 }
 
 template <typename Dtype>
 void Blob<Dtype>::set_cpu_data(Dtype* data) {
   CHECK(data);
+  DropNarrowed();
   data_->set_cpu_data(data);
+  Narrow();
 }
 
 template <typename Dtype>
 const Dtype* Blob<Dtype>::gpu_data() const {
   CHECK(data_);
+  CheckWide();
   return (const Dtype*)data_->gpu_data();
 }
 
@@ -100,12 +114,14 @@ const Dtype* Blob<Dtype>::gpu_diff() const {
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_cpu_data() {
   CHECK(data_);
+  CheckWide();
   return static_cast<Dtype*>(data_->mutable_cpu_data());
 }
 
 template <typename Dtype>
 Dtype* Blob<Dtype>::mutable_gpu_data() {
   CHECK(data_);
+  CheckWide();
   return static_cast<Dtype*>(data_->mutable_gpu_data());
 }
 
@@ -124,7 +140,26 @@ Dtype* Blob<Dtype>::mutable_gpu_diff() {
 template <typename Dtype>
 void Blob<Dtype>::ShareData(const Blob& other) {
   CHECK_EQ(count_, other.count());
-  data_ = other.data();
+  data_ = other.data_;
+  // Narrowed data is shared as it is, and kept narrow.
+  half_data_ = other.half_data_;
+  int8_data_ = other.int8_data_;
+  int8_scales_ = other.int8_scales_;
+  if (!keep_half_ && !keep_int8_rows_) {
+    keep_half_ = other.keep_half_;
+    keep_int8_rows_ = other.keep_int8_rows_;
+  }
+  Narrow();
+}
+
+template <typename Dtype>
+void Blob<Dtype>::ShareDataMemory(const shared_ptr<SyncedMemory>& memory) {
+  CHECK_GE(memory->size(), count_ * sizeof(Dtype));
+  data_ = memory;
+  DropNarrowed();
+  // Any growth must reallocate rather than overrun the shared memory.
+  capacity_ = count_;
+  Narrow();
 }
 
 template <typename Dtype>
@@ -141,6 +176,7 @@ template <> void Blob<int>::Update() { NOT_IMPLEMENTED; }
 
 template <typename Dtype>
 void Blob<Dtype>::Update() {
+  CheckWide();
   // We will perform update based on where the data is located.
   switch (data_->head()) {
   case SyncedMemory::HEAD_AT_CPU:
@@ -178,6 +214,7 @@ template <> int Blob<int>::asum_data() const {
 template <typename Dtype>
 Dtype Blob<Dtype>::asum_data() const {
   if (!data_) { return 0; }
+  CheckWide();
   switch (data_->head()) {
   case SyncedMemory::HEAD_AT_CPU:
     return caffe_cpu_asum(count_, cpu_data());
@@ -250,6 +287,7 @@ Dtype Blob<Dtype>::sumsq_data() const {
   Dtype sumsq;
   const Dtype* data;
   if (!data_) { return 0; }
+  CheckWide();
   switch (data_->head()) {
   case SyncedMemory::HEAD_AT_CPU:
     data = cpu_data();
@@ -321,6 +359,7 @@ template <typename Dtype>
 void Blob<Dtype>::scale_data(Dtype scale_factor) {
   Dtype* data;
   if (!data_) { return; }
+  CheckWide();
   switch (data_->head()) {
   case SyncedMemory::HEAD_AT_CPU:
     data = mutable_cpu_data();
@@ -407,6 +446,9 @@ void Blob<Dtype>::CopyFrom(const Blob& source, bool copy_diff, bool reshape) {
       LOG(FATAL) << "Trying to copy blobs of different sizes.";
     }
   }
+  if (!copy_diff) {
+    DropNarrowed();
+  }
   switch (Caffe::mode()) {
   case Caffe::GPU:
     if (copy_diff) {
@@ -429,6 +471,9 @@ void Blob<Dtype>::CopyFrom(const Blob& source, bool copy_diff, bool reshape) {
   default:
     LOG(FATAL) << "Unknown caffe mode.";
   }
+  if (!copy_diff) {
+    Narrow();
+  }
 }
 
 template <typename Dtype>
@@ -455,10 +500,50 @@ void Blob<Dtype>::FromProto(const BlobProto& proto, bool reshape) {
     CHECK(ShapeEquals(proto)) << "shape mismatch (reshape not set)";
   }
   // copy data
-  Dtype* data_vec = mutable_cpu_data();
-  for (int i = 0; i < count_; ++i) {
-    data_vec[i] = proto.data(i);
+  if (proto.has_int8_data()) {
+    // Weights quantized to int8, row by row, which stay int8.
+    CHECK_EQ(count_, static_cast<int>(proto.int8_data().size()));
+    const int rows = proto.int8_scale_size();
+    CHECK_GT(rows, 0);
+    CHECK_EQ(0, count_ % rows);
+    shared_ptr<SyncedMemory> int8_data(new SyncedMemory(count_));
+    memcpy(int8_data->mutable_cpu_data(), proto.int8_data().data(), count_);
+    shared_ptr<SyncedMemory> int8_scales(
+        new SyncedMemory(rows * sizeof(Dtype)));
+    Dtype* scales = static_cast<Dtype*>(int8_scales->mutable_cpu_data());
+    for (int r = 0; r < rows; ++r) {
+      scales[r] = proto.int8_scale(r);
+    }
+    DropNarrowed();
+    data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    int8_data_ = int8_data;
+    int8_scales_ = int8_scales;
+    if (!keep_half_ && !keep_int8_rows_) {
+      keep_int8_rows_ = rows;
+    }
+  } else if (proto.has_half_data() && keep_half_) {
+    CHECK_EQ(count_ * sizeof(uint16_t), proto.half_data().size());
+    DropNarrowed();
+    half_data_.reset(new SyncedMemory(count_ * sizeof(uint16_t)));
+    memcpy(half_data_->mutable_cpu_data(), proto.half_data().data(),
+        count_ * sizeof(uint16_t));
+  } else if (proto.has_half_data()) {
+    CHECK_EQ(count_ * sizeof(uint16_t), proto.half_data().size());
+    const uint16_t* half_data =
+        reinterpret_cast<const uint16_t*>(proto.half_data().data());
+    DropNarrowed();
+    Dtype* data_vec = mutable_cpu_data();
+    for (int i = 0; i < count_; ++i) {
+      data_vec[i] = half_to_float(half_data[i]);
+    }
+  } else {
+    DropNarrowed();
+    Dtype* data_vec = mutable_cpu_data();
+    for (int i = 0; i < count_; ++i) {
+      data_vec[i] = proto.data(i);
+    }
   }
+  Narrow();
   if (proto.diff_size() > 0) {
     Dtype* diff_vec = mutable_cpu_diff();
     for (int i = 0; i < count_; ++i) {
@@ -475,9 +560,22 @@ void Blob<Dtype>::ToProto(BlobProto* proto, bool write_diff) const {
   }
   proto->clear_data();
   proto->clear_diff();
-  const Dtype* data_vec = cpu_data();
-  for (int i = 0; i < count_; ++i) {
-    proto->add_data(data_vec[i]);
+  proto->clear_half_data();
+  proto->clear_int8_data();
+  proto->clear_int8_scale();
+  if (half_data_) {
+    proto->set_half_data(half_data_->cpu_data(), count_ * sizeof(uint16_t));
+  } else if (int8_data_) {
+    proto->set_int8_data(int8_data_->cpu_data(), count_);
+    const int rows = int8_scales_->size() / sizeof(Dtype);
+    for (int r = 0; r < rows; ++r) {
+      proto->add_int8_scale(cpu_int8_scales()[r]);
+    }
+  } else {
+    const Dtype* data_vec = cpu_data();
+    for (int i = 0; i < count_; ++i) {
+      proto->add_data(data_vec[i]);
+    }
   }
   if (write_diff) {
     const Dtype* diff_vec = cpu_diff();
@@ -487,6 +585,116 @@ void Blob<Dtype>::ToProto(BlobProto* proto, bool write_diff) const {
   }
 }
 
+// Only float and double data is kept in fp16 or int8.
+template <> void Blob<unsigned int>::ToHalf() { NOT_IMPLEMENTED; }
+template <> void Blob<int>::ToHalf() { NOT_IMPLEMENTED; }
+template <> void Blob<unsigned int>::ToInt8(const int rows) {
+  NOT_IMPLEMENTED;
+}
+template <> void Blob<int>::ToInt8(const int rows) { NOT_IMPLEMENTED; }
+template <> void Blob<unsigned int>::Widen() {}
+template <> void Blob<int>::Widen() {}
+template <> void Blob<unsigned int>::WidenData() {}
+template <> void Blob<int>::WidenData() {}
+template <> void Blob<unsigned int>::Narrow() {}
+template <> void Blob<int>::Narrow() {}
+
+template <typename Dtype>
+void Blob<Dtype>::ToHalf() {
+  keep_half_ = true;
+  keep_int8_rows_ = 0;
+  Narrow();
+}
+
+template <typename Dtype>
+const uint16_t* Blob<Dtype>::cpu_half_data() const {
+  return half_data_ ?
+      static_cast<const uint16_t*>(half_data_->cpu_data()) : NULL;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::ToInt8(const int rows) {
+  CHECK_GT(rows, 0);
+  keep_half_ = false;
+  keep_int8_rows_ = rows;
+  Narrow();
+}
+
+template <typename Dtype>
+const int8_t* Blob<Dtype>::cpu_int8_data() const {
+  return int8_data_ ?
+      static_cast<const int8_t*>(int8_data_->cpu_data()) : NULL;
+}
+
+template <typename Dtype>
+const Dtype* Blob<Dtype>::cpu_int8_scales() const {
+  return int8_scales_ ?
+      static_cast<const Dtype*>(int8_scales_->cpu_data()) : NULL;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::Widen() {
+  WidenData();
+  keep_half_ = false;
+  keep_int8_rows_ = 0;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::WidenData() {
+  if (!narrowed()) {
+    return;
+  }
+  // Fresh memory, as blobs that share the narrowed data share data_ too.
+  data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+  Dtype* data = static_cast<Dtype*>(data_->mutable_cpu_data());
+  if (half_data_) {
+    caffe_cpu_half2float(count_,
+        static_cast<const uint16_t*>(half_data_->cpu_data()), data);
+  } else {
+    const int rows = int8_scales_->size() / sizeof(Dtype);
+    const int row_count = count_ / rows;
+    const int8_t* q = static_cast<const int8_t*>(int8_data_->cpu_data());
+    const Dtype* scales = static_cast<const Dtype*>(int8_scales_->cpu_data());
+    for (int i = 0; i < count_; ++i) {
+      data[i] = q[i] * scales[i / row_count];
+    }
+  }
+  DropNarrowed();
+}
+
+template <typename Dtype>
+void Blob<Dtype>::Narrow() {
+  if (count_ == 0 || (keep_half_ && half_data_) || (keep_int8_rows_ &&
+      int8_data_ && int8_scales_->size() == keep_int8_rows_ * sizeof(Dtype))) {
+    return;
+  }
+  if (keep_half_) {
+    WidenData();
+    shared_ptr<SyncedMemory> half_data(
+        new SyncedMemory(count_ * sizeof(uint16_t)));
+    caffe_cpu_float2half(count_, cpu_data(),
+        static_cast<uint16_t*>(half_data->mutable_cpu_data()));
+    // Release the Dtype data; what is allocated again is only written by
+    // WidenData.
+    data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    half_data_ = half_data;
+  } else if (keep_int8_rows_) {
+    WidenData();
+    const int rows = keep_int8_rows_;
+    CHECK_EQ(0, count_ % rows);
+    shared_ptr<SyncedMemory> int8_data(new SyncedMemory(count_));
+    shared_ptr<SyncedMemory> int8_scales(
+        new SyncedMemory(rows * sizeof(Dtype)));
+    quantize_rows_int8_cpu(rows, count_ / rows, cpu_data(),
+        static_cast<int8_t*>(int8_data->mutable_cpu_data()),
+        static_cast<Dtype*>(int8_scales->mutable_cpu_data()));
+    // As for fp16, release the Dtype data.
+    data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
+    int8_data_ = int8_data;
+    int8_scales_ = int8_scales;
+  }
+}
+
 INSTANTIATE_CLASS(Blob);
 template class Blob<int>;
 template class Blob<unsigned int>;
@@ -1,3 +1,4 @@
+#include <boost/thread/tss.hpp>
 #include <glog/logging.h>
 #include <cstdio>
 #include <ctime>
@@ -9,6 +10,45 @@ namespace caffe {
 
 shared_ptr<Caffe> Caffe::singleton_;
 
+namespace {
+
+// The current context is owned by its creator, not by the thread.
+void KeepContext(Caffe* context) {}
+
+boost::thread_specific_ptr<Caffe> current_context(&KeepContext);
+
+}  // namespace
+
+Caffe& Caffe::Get() {
+  Caffe* context = current_context.get();
+  if (context) {
+    return *context;
+  }
+  if (!singleton_.get()) {
+    singleton_.reset(new Caffe());
+  }
+  return *singleton_;
+}
+
+shared_ptr<Caffe> Caffe::CreateContext() {
+  shared_ptr<Caffe> context(new Caffe());
+  context->mode_ = mode();
+  return context;
+}
+
+Caffe::ContextScope::ContextScope(Caffe* context)
+    : context_(context), previous_(current_context.get()) {
+  if (context_) {
+    current_context.reset(context_);
+  }
+}
+
+Caffe::ContextScope::~ContextScope() {
+  if (context_) {
+    current_context.reset(previous_);
+  }
+}
+
 // random seeding
 int64_t cluster_seedgen(void) {
   int64_t s, seed, pid;
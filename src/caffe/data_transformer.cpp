@@ -1,3 +1,4 @@
+#include <boost/random.hpp>
 #include <opencv2/core/core.hpp>
 
 #include <string>
@@ -10,6 +11,90 @@
 
 namespace caffe {
 
+namespace {
+
+// Pixel (h, w) of a height x width input lands at
+// base + h * h_step + w * w_step of the output plane once it has been
+// mirrored and rotated by rotate_direct quarter turns. Working out the
+// strides once per image keeps the index arithmetic out of the pixel loops.
+struct PlaneStrides {
+  int base;
+  int h_step;
+  int w_step;
+};
+
+PlaneStrides MirrorRotateStrides(const int height, const int width,
+    const bool do_mirror, const int rotate_direct) {
+  // Mirroring maps column w to w_base + w * w_sign.
+  const int w_base = do_mirror ? width - 1 : 0;
+  const int w_sign = do_mirror ? -1 : 1;
+  PlaneStrides strides;
+  switch (rotate_direct) {
+  case 1:
+    strides.base = w_base * width + height - 1;
+    strides.h_step = -1;
+    strides.w_step = w_sign * width;
+    break;
+  case 2:
+    strides.base = (height - 1) * width + width - 1 - w_base;
+    strides.h_step = -width;
+    strides.w_step = -w_sign;
+    break;
+  case 3:
+    strides.base = (width - 1 - w_base) * width;
+    strides.h_step = 1;
+    strides.w_step = -w_sign * width;
+    break;
+  default:
+    strides.base = w_base;
+    strides.h_step = width;
+    strides.w_step = w_sign;
+  }
+  return strides;
+}
+
+// Transforms one row of one channel:
+//   dst[w * dst_step] = ((src[w * src_step] - mean) * scale + relight)
+//                       * contrast
+// where mean is mean_row[w] if mean_row is given and mean_value otherwise.
+// Disabled steps are passed as neutral constants (mean 0, relight 0,
+// contrast 1) so that the loops carry no per-pixel branches; the common
+// unit-stride output gets its own loops so that the compiler vectorizes
+// them.
+template <typename Dtype, typename SrcType>
+void TransformRow(const SrcType* src, const int src_step,
+    const Dtype* mean_row, const Dtype mean_value, const Dtype scale,
+    const Dtype relight, const Dtype contrast, const int width,
+    Dtype* dst, const int dst_step) {
+  if (mean_row) {
+    if (dst_step == 1) {
+      for (int w = 0; w < width; ++w) {
+        dst[w] = ((static_cast<Dtype>(src[w * src_step]) - mean_row[w])
+            * scale + relight) * contrast;
+      }
+    } else {
+      for (int w = 0; w < width; ++w) {
+        dst[w * dst_step] = ((static_cast<Dtype>(src[w * src_step])
+            - mean_row[w]) * scale + relight) * contrast;
+      }
+    }
+  } else {
+    if (dst_step == 1) {
+      for (int w = 0; w < width; ++w) {
+        dst[w] = ((static_cast<Dtype>(src[w * src_step]) - mean_value)
+            * scale + relight) * contrast;
+      }
+    } else {
+      for (int w = 0; w < width; ++w) {
+        dst[w * dst_step] = ((static_cast<Dtype>(src[w * src_step])
+            - mean_value) * scale + relight) * contrast;
+      }
+    }
+  }
+}
+
+}  // namespace
+
 template<typename Dtype>
 DataTransformer<Dtype>::DataTransformer(const TransformationParameter& param,
     Phase phase)
@@ -58,8 +143,12 @@ DataTransformer<Dtype>::DataTransformer(const TransformationParameter& param,
         eigen_vec_data[i] = param_.eigen_vector_component(i);
     }
 
-    relight_filler_ =
-      shared_ptr<Filler<Dtype> > (GetFiller<Dtype>(param_.relight_filler()));
+    // The relight offsets are drawn from this transformer's own rng_ so
+    // that every transformer owns an independent, seedable stream.
+    const string& relight_type = param_.relight_filler().type();
+    CHECK(relight_type == "constant" || relight_type == "gaussian" ||
+        relight_type == "uniform") << "Relighting supports constant, "
+        << "gaussian and uniform fillers, not " << relight_type;
     relight_.Reshape(1, 1, 1, eigen_val_size);
   }
 }
@@ -115,22 +204,7 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
   // Generates a random offset in direction of PCA
   // for each image for re-lighting augmentation.
   if (phase_ == TRAIN && has_eigen_values) {
-    CHECK_EQ(datum_channels, eigen_values_.size()) <<
-      "Specify as many eigen values as channels: " << datum_channels;
-    CHECK_EQ(datum_channels*datum_channels, eigen_vectors_.count()) <<
-      "Eigen vectors should be "<< datum_channels << "^2 matrix, row first";
-
-    Blob<Dtype> relight_alpha(1, 1, 1, datum_channels);
-    relight_filler_->Fill(&relight_alpha);
-
-    for (int c = 0; c < datum_channels ; ++c) {
-      relight_alpha.mutable_cpu_data()[c] *= eigen_values_[c];
-    }
-
-    relight_.Reshape(1, 1, 1, datum_channels);
-    caffe_cpu_gemv<Dtype>(CblasTrans, datum_channels,
-      datum_channels, (Dtype) 1, eigen_vectors_.cpu_data(),
-      relight_alpha.cpu_data(), (Dtype) 0, relight_.mutable_cpu_data());
+    RandRelight(datum_channels);
   }
 
   int height = datum_height;
@@ -157,62 +231,28 @@ void DataTransformer<Dtype>::Transform(const Datum& datum,
     }
   }
 
-  Dtype datum_element;
-  int top_index, data_index;
+  // Select the geometry and the per-channel constants once per image, then
+  // run the branch-free row kernel.
+  const PlaneStrides strides =
+      MirrorRotateStrides(height, width, do_mirror, rotate_direct);
+  const Dtype* relight = has_eigen_values ? relight_.cpu_data() : NULL;
   for (int c = 0; c < datum_channels; ++c) {
+    const Dtype mean_value = has_mean_values ? mean_values_[c] : Dtype(0);
+    const Dtype channel_relight = relight ? relight[c] : Dtype(0);
+    Dtype* top_plane = transformed_data + c * height * width + strides.base;
     for (int h = 0; h < height; ++h) {
-      for (int w = 0; w < width; ++w) {
-        // =======================================
-        // Cutomized rotation augmentation
-        data_index = (c * datum_height + h_off + h) * datum_width + w_off + w;
-        int h_idx = h;
-        int w_idx = w;
-        if (do_mirror) {
-          w_idx = width - 1 - w;
-        }
-
-        if (rotate_direct == 1) {
-          int temp = w_idx;
-          w_idx = height - 1 - h_idx;
-          h_idx = temp;
-        } else if (rotate_direct == 2) {
-          w_idx = width - 1 - w_idx;
-          h_idx = height - 1 - h_idx;
-        } else if (rotate_direct == 3) {
-          int temp = h_idx;
-          h_idx = width - 1 - w_idx;
-          w_idx = temp;
-        }
-
-        top_index = (c * height + h_idx) * width + w_idx;
-
-        if (has_uint8) {
-          datum_element =
-            static_cast<Dtype>(static_cast<uint8_t>(data[data_index]));
-        } else {
-          datum_element = datum.float_data(data_index);
-        }
-        if (has_mean_file) {
-          transformed_data[top_index] =
-            (datum_element - mean[data_index]) * scale;
-        } else {
-          if (has_mean_values) {
-            transformed_data[top_index] =
-              (datum_element - mean_values_[c]) * scale;
-          } else {
-            transformed_data[top_index] = datum_element * scale;
-          }
-        }
-
-        //===============================================
-        // cutomized code for adding relight value
-        if (has_eigen_values) {
-          transformed_data[top_index] += relight_.cpu_data()[c];
-        }
-
-        if (has_contrast_adj) {
-          transformed_data[top_index] *= contrast_scale;
-        }
+      const int data_index = (c * datum_height + h_off + h) * datum_width
+          + w_off;
+      const Dtype* mean_row = has_mean_file ? mean + data_index : NULL;
+      Dtype* top_row = top_plane + h * strides.h_step;
+      if (has_uint8) {
+        TransformRow(reinterpret_cast<const uint8_t*>(data.data())
+            + data_index, 1, mean_row, mean_value, scale, channel_relight,
+            Dtype(contrast_scale), width, top_row, strides.w_step);
+      } else {
+        TransformRow(datum.float_data().data() + data_index, 1, mean_row,
+            mean_value, scale, channel_relight, Dtype(contrast_scale), width,
+            top_row, strides.w_step);
       }
     }
   }
@@ -377,22 +417,7 @@ void DataTransformer<Dtype>::Transform(const cv::Mat& cv_img,
   // Generates a random offset in direction of PCA
   // for each image for re-lighting augmentation.
   if (phase_ == TRAIN && has_eigen_values) {
-    CHECK_EQ(img_channels, eigen_values_.size()) <<
-      "Specify as many eigen values as channels: " << img_channels;
-    CHECK_EQ(img_channels*img_channels, eigen_vectors_.count()) <<
-      "Eigen vectors should be "<< img_channels << "^2 matrix, row first";
-
-    Blob<Dtype> relight_alpha(1, 1, 1, img_channels);
-    relight_filler_->Fill(&relight_alpha);
-
-    for (int c = 0; c < img_channels ; ++c) {
-      relight_alpha.mutable_cpu_data()[c] *= eigen_values_[c];
-    }
-
-    relight_.Reshape(1, 1, 1, img_channels);
-    caffe_cpu_gemv<Dtype>(CblasTrans, img_channels,
-      img_channels, (Dtype) 1, eigen_vectors_.mutable_cpu_data(),
-      relight_alpha.cpu_data(), (Dtype) 0, relight_.mutable_cpu_data());
+    RandRelight(img_channels);
   }
 
   int h_off = 0;
@@ -418,60 +443,23 @@ void DataTransformer<Dtype>::Transform(const cv::Mat& cv_img,
 
   CHECK(cv_cropped_img.data);
 
+  // Select the geometry and the per-channel constants once per image, then
+  // run the branch-free row kernel, which also de-interleaves HWC into CHW.
   Dtype* transformed_data = transformed_blob->mutable_cpu_data();
-  int top_index;
-  for (int h = 0; h < height; ++h) {
-    const uchar* ptr = cv_cropped_img.ptr<uchar>(h);
-    int img_index = 0;
-    for (int w = 0; w < width; ++w) {
-      for (int c = 0; c < img_channels; ++c) {
-              
-        // =======================================
-        // Cutomized rotation augmentation
-        int h_idx = h;
-        int w_idx = w;
-        if (do_mirror) {
-          w_idx = width - 1 - w;
-        }
-
-        if (rotate_direct == 1) {
-          int temp = w_idx;
-          w_idx = height - 1 - h_idx;
-          h_idx = temp;
-        } else if (rotate_direct == 2) {
-          w_idx = width - 1 - w_idx;
-          h_idx = height - 1 - h_idx;
-        } else if (rotate_direct == 3) {
-          int temp = h_idx;
-          h_idx = width - 1 - w_idx;
-          w_idx = temp;
-        }
-
-        top_index = (c * height + h_idx) * width + w_idx;
-
-        Dtype pixel = static_cast<Dtype>(ptr[img_index++]);
-        if (has_mean_file) {
-          int mean_index = (c * img_height + h_off + h) * img_width + w_off + w;
-          transformed_data[top_index] =
-            (pixel - mean[mean_index]) * scale;
-        } else {
-          if (has_mean_values) {
-            transformed_data[top_index] =
-              (pixel - mean_values_[c]) * scale;
-          } else {
-            transformed_data[top_index] = pixel * scale;
-          }
-        }
-
-        //===============================================
-        // cutomized code for adding relight value
-        if (has_eigen_values) {
-          transformed_data[top_index] += relight_.cpu_data()[c];
-        }
-        if (has_contrast_adj) {
-          transformed_data[top_index] *= contrast_scale;
-        }
-      }
+  const PlaneStrides strides =
+      MirrorRotateStrides(height, width, do_mirror, rotate_direct);
+  const Dtype* relight = has_eigen_values ? relight_.cpu_data() : NULL;
+  for (int c = 0; c < img_channels; ++c) {
+    const Dtype mean_value = has_mean_values ? mean_values_[c] : Dtype(0);
+    const Dtype channel_relight = relight ? relight[c] : Dtype(0);
+    Dtype* top_plane = transformed_data + c * height * width + strides.base;
+    for (int h = 0; h < height; ++h) {
+      const uchar* ptr = cv_cropped_img.ptr<uchar>(h) + c;
+      const Dtype* mean_row = has_mean_file ?
+          mean + (c * img_height + h_off + h) * img_width + w_off : NULL;
+      TransformRow(ptr, img_channels, mean_row, mean_value, scale,
+          channel_relight, Dtype(contrast_scale), width,
+          top_plane + h * strides.h_step, strides.w_step);
     }
   }
 }
@@ -570,22 +558,7 @@ void DataTransformer<Dtype>::Transform(Blob<Dtype>* input_blob,
   // Generates a random offset in direction of PCA
   // for each image for re-lighting augmentation.
   if (phase_ == TRAIN && has_eigen_values) {
-    CHECK_EQ(input_channels, eigen_values_.size()) <<
-      "Specify as many eigen values as channels: " << input_channels;
-    CHECK_EQ(input_channels*input_channels, eigen_vectors_.count()) <<
-      "Eigen vectors should be "<< input_channels << "^2 matrix, row first";
-
-    Blob<Dtype> relight_alpha(1, 1, 1, input_channels);
-    relight_filler_->Fill(&relight_alpha);
-
-    for (int c = 0; c < input_channels ; ++c) {
-      relight_alpha.mutable_cpu_data()[c] *= eigen_values_[c];
-    }
-
-    relight_.Reshape(1, 1, 1, input_channels);
-    caffe_cpu_gemv<Dtype>(CblasTrans, input_channels,
-      input_channels, (Dtype) 1, eigen_vectors_.cpu_data(),
-      relight_alpha.cpu_data(), (Dtype) 0, relight_.mutable_cpu_data());
+    RandRelight(input_channels);
   }
 
   Dtype* transformed_data = transformed_blob->mutable_cpu_data();
@@ -710,7 +683,8 @@ template <typename Dtype>
 void DataTransformer<Dtype>::InitRand() 
 {
   const bool needs_rand = param_.mirror() || param_.rotate() || 
-      (phase_ == TRAIN && param_.crop_size());
+      param_.contrast_adjustment() ||
+      (phase_ == TRAIN && (param_.crop_size() || eigen_values_.size() > 0));
   if (needs_rand) {
     const unsigned int rng_seed = caffe_rng_rand();
     rng_.reset(new Caffe::RNG(rng_seed));
@@ -730,9 +704,50 @@ int DataTransformer<Dtype>::Rand(int n) {
 template <typename Dtype>
 float DataTransformer<Dtype>::Uniform(const float min, const float max) {
   CHECK(rng_);
-  Dtype d[1];
-  caffe_rng_uniform<Dtype>(1, Dtype(min), Dtype(max), d);
-  return (float) d[0];
+  caffe::rng_t* rng =
+      static_cast<caffe::rng_t*>(rng_->generator());
+  boost::uniform_real<float> random_distribution(min, max);
+  return random_distribution(*rng);
+}
+
+template <typename Dtype>
+void DataTransformer<Dtype>::RandRelight(const int channels) {
+  CHECK(rng_);
+  CHECK_EQ(channels, eigen_values_.size()) <<
+    "Specify as many eigen values as channels: " << channels;
+  CHECK_EQ(channels*channels, eigen_vectors_.count()) <<
+    "Eigen vectors should be "<< channels << "^2 matrix, row first";
+
+  caffe::rng_t* rng =
+      static_cast<caffe::rng_t*>(rng_->generator());
+  const FillerParameter& filler = param_.relight_filler();
+  Blob<Dtype> relight_alpha(1, 1, 1, channels);
+  Dtype* alpha = relight_alpha.mutable_cpu_data();
+  if (filler.type() == "gaussian") {
+    boost::normal_distribution<Dtype> random_distribution(filler.mean(),
+        filler.std());
+    boost::variate_generator<caffe::rng_t*, boost::normal_distribution<Dtype> >
+        variate_generator(rng, random_distribution);
+    for (int c = 0; c < channels; ++c) {
+      alpha[c] = variate_generator();
+    }
+  } else if (filler.type() == "uniform") {
+    boost::uniform_real<Dtype> random_distribution(filler.min(), filler.max());
+    for (int c = 0; c < channels; ++c) {
+      alpha[c] = random_distribution(*rng);
+    }
+  } else {
+    caffe_set(channels, Dtype(filler.value()), alpha);
+  }
+
+  for (int c = 0; c < channels ; ++c) {
+    alpha[c] *= eigen_values_[c];
+  }
+
+  relight_.Reshape(1, 1, 1, channels);
+  caffe_cpu_gemv<Dtype>(CblasTrans, channels,
+    channels, (Dtype) 1, eigen_vectors_.cpu_data(),
+    relight_alpha.cpu_data(), (Dtype) 0, relight_.mutable_cpu_data());
 }
 
 INSTANTIATE_CLASS(DataTransformer);
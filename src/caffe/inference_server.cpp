@@ -0,0 +1,215 @@
+#include <stdint.h>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe/inference_server.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class InferenceFuture<Dtype>::sync {
+ public:
+  mutable boost::mutex mutex_;
+  mutable boost::condition_variable condition_;
+};
+
+template <typename Dtype>
+InferenceFuture<Dtype>::InferenceFuture(const Dtype* input, int input_count)
+    : input_(input, input + input_count),
+      submit_time_(boost::chrono::steady_clock::now()),
+      done_(false), latency_ms_(0), sync_(new sync()) {
+}
+
+template <typename Dtype>
+void InferenceFuture<Dtype>::Wait() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  while (!done_) {
+    sync_->condition_.wait(lock);
+  }
+}
+
+template <typename Dtype>
+bool InferenceFuture<Dtype>::ready() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return done_;
+}
+
+template <typename Dtype>
+const vector<vector<Dtype> >& InferenceFuture<Dtype>::outputs() const {
+  CHECK(ready()) << "Wait for the outputs first.";
+  return outputs_;
+}
+
+template <typename Dtype>
+void InferenceFuture<Dtype>::set_done(float latency_ms) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  latency_ms_ = latency_ms;
+  done_ = true;
+  lock.unlock();
+  sync_->condition_.notify_all();
+}
+
+template <typename Dtype>
+class InferenceServer<Dtype>::sync {
+ public:
+  mutable boost::mutex mutex_;
+};
+
+template <typename Dtype>
+const int InferenceServer<Dtype>::kLatencyWindow;
+
+template <typename Dtype>
+InferenceServer<Dtype>::InferenceServer(const shared_ptr<Net<Dtype> >& net,
+    int max_delay_us)
+    : net_(net), max_delay_us_(max_delay_us), requests_served_(0),
+      batches_served_(0), total_latency_ms_(0), max_latency_ms_(0),
+      recent_latencies_ms_(kLatencyWindow), sync_(new sync()) {
+  CHECK_GE(max_delay_us_, 0);
+  CHECK_EQ(net_->input_blobs().size(), 1)
+      << "InferenceServer needs a net with exactly one input blob.";
+  const Blob<Dtype>* input_blob = net_->input_blobs()[0];
+  CHECK_GE(input_blob->num_axes(), 1);
+  max_batch_size_ = input_blob->shape(0);
+  input_count_ = input_blob->count(1);
+  CHECK_GT(max_batch_size_, 0);
+  for (int i = 0; i < net_->output_blobs().size(); ++i) {
+    CHECK_GE(net_->output_blobs()[i]->num_axes(), 1);
+    CHECK_EQ(net_->output_blobs()[i]->shape(0), max_batch_size_)
+        << "Every output blob must have an item per input item.";
+  }
+  CHECK(StartInternalThread()) << "Failed to start the server thread.";
+}
+
+template <typename Dtype>
+InferenceServer<Dtype>::~InferenceServer() {
+  StopInternalThread();
+  vector<shared_ptr<InferenceFuture<Dtype> > > batch;
+  shared_ptr<InferenceFuture<Dtype> > request;
+  while (requests_.try_pop(&request)) {
+    batch.push_back(request);
+    if (static_cast<int>(batch.size()) == max_batch_size_) {
+      ForwardBatch(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    ForwardBatch(batch);
+  }
+}
+
+template <typename Dtype>
+shared_ptr<InferenceFuture<Dtype> > InferenceServer<Dtype>::Submit(
+    const Dtype* input) {
+  shared_ptr<InferenceFuture<Dtype> > request(
+      new InferenceFuture<Dtype>(input, input_count_));
+  requests_.push(request);
+  return request;
+}
+
+template <typename Dtype>
+void InferenceServer<Dtype>::InternalThreadEntry() {
+  try {
+    while (!must_stop()) {
+      shared_ptr<InferenceFuture<Dtype> > request = requests_.pop();
+      // Once a request is taken it is served, so a stop waits for the batch.
+      boost::this_thread::disable_interruption no_interruption;
+      vector<shared_ptr<InferenceFuture<Dtype> > > batch(1, request);
+      const boost::chrono::steady_clock::time_point deadline =
+          request->submit_time_ + boost::chrono::microseconds(max_delay_us_);
+      while (static_cast<int>(batch.size()) < max_batch_size_) {
+        const int remaining_us = std::max<int64_t>(0,
+            boost::chrono::duration_cast<boost::chrono::microseconds>(
+            deadline - boost::chrono::steady_clock::now()).count());
+        if (!requests_.try_pop_for(&request, remaining_us)) {
+          break;
+        }
+        batch.push_back(request);
+      }
+      ForwardBatch(batch);
+    }
+  } catch (boost::thread_interrupted&) {
+    // Interrupted exception is expected on shutdown
+  }
+}
+
+template <typename Dtype>
+void InferenceServer<Dtype>::ForwardBatch(
+    const vector<shared_ptr<InferenceFuture<Dtype> > >& batch) {
+  const int batch_size = batch.size();
+  Blob<Dtype>* input_blob = net_->input_blobs()[0];
+  if (input_blob->shape(0) != batch_size) {
+    vector<int> shape = input_blob->shape();
+    shape[0] = batch_size;
+    input_blob->Reshape(shape);
+    net_->Reshape();
+  }
+  Dtype* input_data = input_blob->mutable_cpu_data();
+  for (int i = 0; i < batch_size; ++i) {
+    caffe_copy(input_count_, &batch[i]->input_[0],
+        input_data + i * input_count_);
+  }
+  const vector<Blob<Dtype>*>& output_blobs = net_->ForwardPrefilled();
+  for (int i = 0; i < batch_size; ++i) {
+    vector<vector<Dtype> >& outputs = batch[i]->outputs_;
+    outputs.resize(output_blobs.size());
+    for (int j = 0; j < output_blobs.size(); ++j) {
+      const int output_count = output_blobs[j]->count(1);
+      const Dtype* output_data =
+          output_blobs[j]->cpu_data() + i * output_count;
+      outputs[j].assign(output_data, output_data + output_count);
+    }
+  }
+  const boost::chrono::steady_clock::time_point now =
+      boost::chrono::steady_clock::now();
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  for (int i = 0; i < batch_size; ++i) {
+    const float latency_ms =
+        boost::chrono::duration_cast<boost::chrono::microseconds>(
+        now - batch[i]->submit_time_).count() / 1000.f;
+    recent_latencies_ms_[requests_served_ % kLatencyWindow] = latency_ms;
+    ++requests_served_;
+    total_latency_ms_ += latency_ms;
+    max_latency_ms_ = std::max(max_latency_ms_, latency_ms);
+    batch[i]->set_done(latency_ms);
+  }
+  ++batches_served_;
+}
+
+template <typename Dtype>
+InferenceServerStats InferenceServer<Dtype>::stats() const {
+  InferenceServerStats stats;
+  stats.queue_depth = requests_.size();
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  stats.requests = requests_served_;
+  stats.batches = batches_served_;
+  stats.mean_batch_size = batches_served_ ?
+      static_cast<float>(requests_served_) / batches_served_ : 0;
+  stats.mean_latency_ms = requests_served_ ?
+      total_latency_ms_ / requests_served_ : 0;
+  stats.max_latency_ms = max_latency_ms_;
+  vector<float> latencies(recent_latencies_ms_.begin(),
+      recent_latencies_ms_.begin() +
+      std::min<int>(requests_served_, kLatencyWindow));
+  lock.unlock();
+  stats.p50_latency_ms = stats.p99_latency_ms = 0;
+  if (!latencies.empty()) {
+    const int p50 = latencies.size() / 2;
+    std::nth_element(latencies.begin(), latencies.begin() + p50,
+        latencies.end());
+    stats.p50_latency_ms = latencies[p50];
+    const int p99 = latencies.size() * 99 / 100;
+    std::nth_element(latencies.begin(), latencies.begin() + p99,
+        latencies.end());
+    stats.p99_latency_ms = latencies[p99];
+  }
+  return stats;
+}
+
+INSTANTIATE_CLASS(InferenceFuture);
+INSTANTIATE_CLASS(InferenceServer);
+
+}  // namespace caffe
@@ -25,6 +25,17 @@ bool InternalThread::StartInternalThread() {
   return true;
 }
 
+bool InternalThread::must_stop() const {
+  return boost::this_thread::interruption_requested();
+}
+
+bool InternalThread::StopInternalThread() {
+  if (is_started()) {
+    thread_->interrupt();
+  }
+  return WaitForInternalThreadToExit();
+}
+
 /** Will not return until the internal thread has exited. */
 bool InternalThread::WaitForInternalThreadToExit() {
   if (is_started()) {
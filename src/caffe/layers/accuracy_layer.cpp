@@ -1,15 +1,24 @@
+#include <boost/bind.hpp>
+
 #include <algorithm>
-#include <functional>
 #include <utility>
 #include <vector>
 
 #include "caffe/layer.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/top_k.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
+namespace {
+
+// The number of contiguous positions whose argmaxes are found together.
+const int kArgmaxBlock = 64;
+
+}  // namespace
+
 template <typename Dtype>
 void AccuracyLayer<Dtype>::LayerSetUp(
   const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
@@ -20,6 +29,14 @@ void AccuracyLayer<Dtype>::LayerSetUp(
   if (has_ignore_label_) {
     ignore_label_ = this->layer_param_.accuracy_param().ignore_label();
   }
+  num_threads_ = this->layer_param_.accuracy_param().num_threads();
+  CHECK_GT(num_threads_, 0) << "num_threads must be positive.";
+  if (num_threads_ > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads_));
+  }
+  top_k_buffer_.resize(num_threads_ * top_k_);
+  correct_.resize(num_threads_);
+  counted_.resize(num_threads_);
 }
 
 template <typename Dtype>
@@ -43,46 +60,76 @@ void AccuracyLayer<Dtype>::Reshape(
 template <typename Dtype>
 void AccuracyLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
-  Dtype accuracy = 0;
   const Dtype* bottom_data = bottom[0]->cpu_data();
   const Dtype* bottom_label = bottom[1]->cpu_data();
-  const int dim = bottom[0]->count() / outer_num_;
   const int num_labels = bottom[0]->shape(label_axis_);
-  vector<Dtype> maxval(top_k_+1);
-  vector<int> max_id(top_k_+1);
+  if (num_threads_ == 1) {
+    forward_cpu_range(bottom_data, bottom_label, num_labels, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &AccuracyLayer<Dtype>::forward_cpu_range, this, bottom_data,
+        bottom_label, num_labels, _1));
+  }
+  Dtype accuracy = 0;
   int count = 0;
-  for (int i = 0; i < outer_num_; ++i) {
-    for (int j = 0; j < inner_num_; ++j) {
-      const int label_value =
-          static_cast<int>(bottom_label[i * inner_num_ + j]);
+  for (int t = 0; t < num_threads_; ++t) {
+    accuracy += correct_[t];
+    count += counted_[t];
+  }
+
+  // LOG(INFO) << "Accuracy: " << accuracy;
+  top[0]->mutable_cpu_data()[0] = accuracy / count;
+  // Accuracy layer should not be used as a loss function.
+}
+
+template <typename Dtype>
+void AccuracyLayer<Dtype>::forward_cpu_range(const Dtype* bottom_data,
+    const Dtype* bottom_label, int num_labels, int thread_id) {
+  const int num_positions = outer_num_ * inner_num_;
+  const int begin = num_positions * thread_id / num_threads_;
+  const int end = num_positions * (thread_id + 1) / num_threads_;
+  const int dim = num_labels * inner_num_;
+  std::pair<Dtype, int>* top_k = &top_k_buffer_[thread_id * top_k_];
+  int predicted[kArgmaxBlock];
+  int correct = 0;
+  int count = 0;
+  // Positions i * inner_num_ + j, taken a block of the same i at a time.
+  for (int position = begin; position < end; ) {
+    const int i = position / inner_num_;
+    const int j = position % inner_num_;
+    const int n = top_k_ == 1 ?
+        std::min(kArgmaxBlock, std::min(inner_num_ - j, end - position)) : 1;
+    const Dtype* scores = bottom_data + i * dim + j;
+    if (top_k_ == 1) {
+      caffe_cpu_argmax<Dtype>(num_labels, inner_num_, n, scores, predicted,
+          NULL);
+    } else {
+      caffe_cpu_top_k(num_labels, inner_num_, scores, top_k_, top_k);
+    }
+    for (int m = 0; m < n; ++m) {
+      const int label_value = static_cast<int>(bottom_label[position + m]);
       if (has_ignore_label_ && label_value == ignore_label_) {
         continue;
       }
       DCHECK_GE(label_value, 0);
       DCHECK_LT(label_value, num_labels);
-      // Top-k accuracy
-      std::vector<std::pair<Dtype, int> > bottom_data_vector;
-      for (int k = 0; k < num_labels; ++k) {
-        bottom_data_vector.push_back(std::make_pair(
-            bottom_data[i * dim + k * inner_num_ + j], k));
-      }
-      std::partial_sort(
-          bottom_data_vector.begin(), bottom_data_vector.begin() + top_k_,
-          bottom_data_vector.end(), std::greater<std::pair<Dtype, int> >());
       // check if true label is in top k predictions
-      for (int k = 0; k < top_k_; k++) {
-        if (bottom_data_vector[k].second == label_value) {
-          ++accuracy;
-          break;
+      if (top_k_ == 1) {
+        correct += predicted[m] == label_value;
+      } else {
+        for (int k = 0; k < top_k_; k++) {
+          if (top_k[k].second == label_value) {
+            ++correct;
+            break;
+          }
         }
       }
       ++count;
     }
+    position += n;
   }
-
-  // LOG(INFO) << "Accuracy: " << accuracy;
-  top[0]->mutable_cpu_data()[0] = accuracy / count;
-  // Accuracy layer should not be used as a loss function.
+  correct_[thread_id] = correct;
+  counted_[thread_id] = count;
 }
 
 INSTANTIATE_CLASS(AccuracyLayer);
@@ -1,9 +1,10 @@
-#include <algorithm>
-#include <functional>
+#include <boost/bind.hpp>
+
 #include <utility>
 #include <vector>
 
 #include "caffe/layer.hpp"
+#include "caffe/util/top_k.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
@@ -16,6 +17,12 @@ void ArgMaxLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   CHECK_GE(top_k_, 1) << " top k must not be less than 1.";
   CHECK_LE(top_k_, bottom[0]->count() / bottom[0]->num())
       << "top_k must be less than or equal to the number of classes.";
+  num_threads_ = this->layer_param_.argmax_param().num_threads();
+  CHECK_GT(num_threads_, 0) << "num_threads must be positive.";
+  if (num_threads_ > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads_));
+  }
+  top_k_buffer_.resize(num_threads_ * top_k_);
 }
 
 template <typename Dtype>
@@ -37,21 +44,30 @@ void ArgMaxLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   Dtype* top_data = top[0]->mutable_cpu_data();
   int num = bottom[0]->num();
   int dim = bottom[0]->count() / bottom[0]->num();
-  for (int i = 0; i < num; ++i) {
-    std::vector<std::pair<Dtype, int> > bottom_data_vector;
-    for (int j = 0; j < dim; ++j) {
-      bottom_data_vector.push_back(
-          std::make_pair(bottom_data[i * dim + j], j));
-    }
-    std::partial_sort(
-        bottom_data_vector.begin(), bottom_data_vector.begin() + top_k_,
-        bottom_data_vector.end(), std::greater<std::pair<Dtype, int> >());
+  if (num_threads_ == 1) {
+    forward_cpu_range(bottom_data, top_data, num, dim, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &ArgMaxLayer<Dtype>::forward_cpu_range, this, bottom_data, top_data,
+        num, dim, _1));
+  }
+}
+
+template <typename Dtype>
+void ArgMaxLayer<Dtype>::forward_cpu_range(const Dtype* bottom_data,
+    Dtype* top_data, int num, int dim, int thread_id) {
+  const int begin = num * thread_id / num_threads_;
+  const int end = num * (thread_id + 1) / num_threads_;
+  const int top_dim = (out_max_val_ ? 2 : 1) * top_k_;
+  std::pair<Dtype, int>* top_k = &top_k_buffer_[thread_id * top_k_];
+  for (int i = begin; i < end; ++i) {
+    caffe_cpu_top_k(dim, 1, bottom_data + i * dim, top_k_, top_k);
     for (int j = 0; j < top_k_; ++j) {
-      top_data[top[0]->offset(i, 0, j)] = bottom_data_vector[j].second;
+      top_data[i * top_dim + j] = top_k[j].second;
     }
     if (out_max_val_) {
       for (int j = 0; j < top_k_; ++j) {
-        top_data[top[0]->offset(i, 1, j)] = bottom_data_vector[j].first;
+        top_data[i * top_dim + top_k_ + j] = top_k[j].first;
       }
     }
   }
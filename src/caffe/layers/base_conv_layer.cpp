@@ -1,13 +1,44 @@
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
 #include <vector>
 
 #include "caffe/filler.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/util/fft.hpp"
 #include "caffe/util/im2col.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/quantize.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
+namespace {
+
+// acc += x * w, or x * conj(w), over count complex numbers.
+template <typename Dtype>
+void SpectrumMultiplyAdd(const int count, const std::complex<Dtype>* x,
+    const std::complex<Dtype>* w, const bool conjugate,
+    std::complex<Dtype>* acc) {
+  // On the interleaved real and imaginary parts, which vectorizes better
+  // than the complex operators.
+  const Dtype* x_data = reinterpret_cast<const Dtype*>(x);
+  const Dtype* w_data = reinterpret_cast<const Dtype*>(w);
+  Dtype* acc_data = reinterpret_cast<Dtype*>(acc);
+  const Dtype sign = conjugate ? -1 : 1;
+  for (int i = 0; i < 2 * count; i += 2) {
+    const Dtype x_real = x_data[i], x_imag = x_data[i + 1];
+    const Dtype w_real = w_data[i], w_imag = sign * w_data[i + 1];
+    acc_data[i] += x_real * w_real - x_imag * w_imag;
+    acc_data[i + 1] += x_real * w_imag + x_imag * w_real;
+  }
+}
+
+}  // namespace
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
@@ -72,8 +103,19 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   // - blobs_[0] holds the filter weights
   // - blobs_[1] holds the biases (optional)
   bias_term_ = this->layer_param_.convolution_param().bias_term();
+  vector<int> weight_shape(1, conv_out_channels_);
+  weight_shape.push_back(conv_in_channels_ / group_);
+  weight_shape.push_back(kernel_h_);
+  weight_shape.push_back(kernel_w_);
+  const vector<int> bias_shape(1, num_output_);
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
+    CHECK_EQ(1 + bias_term_, this->blobs_.size())
+        << "Incorrect number of weight blobs.";
+    this->CheckParamShape(0, weight_shape);
+    if (bias_term_) {
+      this->CheckParamShape(1, bias_shape);
+    }
   } else {
     if (bias_term_) {
       this->blobs_.resize(2);
@@ -82,14 +124,12 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     }
     // Initialize and fill the weights:
     // output channels x input channels per-group x kernel height x kernel width
-    this->blobs_[0].reset(new Blob<Dtype>(
-        conv_out_channels_, conv_in_channels_ / group_, kernel_h_, kernel_w_));
+    this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
     shared_ptr<Filler<Dtype> > weight_filler(GetFiller<Dtype>(
         this->layer_param_.convolution_param().weight_filler()));
     weight_filler->Fill(this->blobs_[0].get());
     // If necessary, initialize and fill the biases.
     if (bias_term_) {
-      vector<int> bias_shape(1, num_output_);
       this->blobs_[1].reset(new Blob<Dtype>(bias_shape));
       shared_ptr<Filler<Dtype> > bias_filler(GetFiller<Dtype>(
           this->layer_param_.convolution_param().bias_filler()));
@@ -98,6 +138,26 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   }
   // Propagate gradients to the parameters (as directed by backward pass).
   this->param_propagate_down_.resize(this->blobs_.size(), true);
+  // Set up the threads that split the batch in CPU mode.
+  num_threads_ = this->layer_param_.convolution_param().num_threads();
+  CHECK_GT(num_threads_, 0) << "num_threads must be positive.";
+  if (num_threads_ > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads_));
+  }
+  // Quantize TEST nets that were calibrated for it.
+  quantized_ = this->layer_param_.has_quantization_param() &&
+      this->phase_ == TEST && !reverse_dimensions();
+  if (quantized_) {
+    input_scale_ = this->layer_param_.quantization_param().input_scale();
+    CHECK_GT(input_scale_, 0) << "input_scale must be positive.";
+    LOG(INFO) << "Using int8 quantized convolution in CPU mode";
+    // Quantize the weights once, releasing their Dtype data; weights
+    // loaded later are quantized as they replace them (see Blob::ToInt8).
+    this->blobs_[0]->ToInt8(conv_out_channels_);
+  }
+  // The FFT engine decides in Reshape.
+  fft_decided_ = false;
+  use_fft_ = false;
 }
 
 template <typename Dtype>
@@ -128,23 +188,30 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   if (reverse_dimensions()) {
     conv_in_height_ = height_out_;
     conv_in_width_ = width_out_;
-    conv_out_spatial_dim_ = height_ * width_;
+    conv_out_height_ = height_;
+    conv_out_width_ = width_;
   } else {
     conv_in_height_ = height_;
     conv_in_width_ = width_;
-    conv_out_spatial_dim_ = height_out_ * width_out_;
+    conv_out_height_ = height_out_;
+    conv_out_width_ = width_out_;
   }
+  conv_out_spatial_dim_ = conv_out_height_ * conv_out_width_;
   kernel_dim_ = conv_in_channels_ * kernel_h_ * kernel_w_;
   weight_offset_ = conv_out_channels_ * kernel_dim_ / group_ / group_;
   col_offset_ = kernel_dim_ * conv_out_spatial_dim_ / group_;
   output_offset_ = conv_out_channels_ * conv_out_spatial_dim_ / group_;
-  // The im2col result buffer will only hold one image at a time to avoid
-  // overly large memory usage. In the special case of 1x1 convolution
-  // it goes lazily unused to save memory.
+  bottom_dim_ = bottom[0]->count(1);
+  top_dim_ = top[0]->count(1);
+  // The im2col result buffer will only hold one image at a time (per thread)
+  // to avoid overly large memory usage. In the special case of 1x1
+  // convolution it goes lazily unused to save memory. In a Net it is backed
+  // by the workspace shared by all layers (see SetWorkspace).
+  const int col_buffers = Caffe::mode() == Caffe::CPU ? num_threads_ : 1;
   if (reverse_dimensions()) {
-    col_buffer_.Reshape(1, kernel_dim_, height_, width_);
+    col_buffer_.Reshape(col_buffers, kernel_dim_, height_, width_);
   } else {
-    col_buffer_.Reshape(1, kernel_dim_, height_out_, width_out_);
+    col_buffer_.Reshape(col_buffers, kernel_dim_, height_out_, width_out_);
   }
   // Set up the all ones "bias multiplier" for adding biases by BLAS
   if (bias_term_) {
@@ -153,17 +220,402 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     caffe_set(bias_multiplier_.count(), Dtype(1),
         bias_multiplier_.mutable_cpu_data());
   }
+  if (this->layer_param_.convolution_param().engine() ==
+      ConvolutionParameter_Engine_FFT && !quantized_) {
+    fft_reshape();
+  }
+  if (quantized_) {
+    int8_input_.resize(num_threads_ * bottom_dim_);
+    int8_row_buffer_.resize(num_threads_ * col_offset_);
+    int32_output_.resize(num_threads_ * conv_out_channels_ *
+        conv_out_spatial_dim_);
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::fft_reshape() {
+  // The FFTs are circular: a tile of output rows and the input rows it
+  // reads, or writes in backward_cpu_gemm, must fit in one FFT. The
+  // smallest FFT that takes the whole output at once is
+  const int whole_h = fft_size((conv_out_height_ - 1) * stride_h_ + kernel_h_);
+  const int whole_w = fft_size((conv_out_width_ - 1) * stride_w_ + kernel_w_);
+  // Estimate the operations of every FFT size from the smallest that fits
+  // the filters up to that one: over all tiles, a complex FFT (5 N log2 N)
+  // for every pair of input and of output channels, and a complex
+  // multiply-add for every filter and bin of the half spectra.
+  const int filters = conv_out_channels_ * conv_in_channels_ / group_;
+  const int channel_pairs = (conv_in_channels_ + 1) / 2 +
+      (conv_out_channels_ + 1) / 2;
+  double fft_cost = 0;
+  int fft_h = 0, fft_w = 0;
+  for (int size = fft_size(std::max(kernel_h_, kernel_w_)); ; size *= 2) {
+    const int h = std::min(size, whole_h);
+    const int w = std::min(size, whole_w);
+    const int tile_h = (h - kernel_h_) / stride_h_ + 1;
+    const int tile_w = (w - kernel_w_) / stride_w_ + 1;
+    const int tiles = ((conv_out_height_ + tile_h - 1) / tile_h) *
+        ((conv_out_width_ + tile_w - 1) / tile_w);
+    const double points = static_cast<double>(h) * w;
+    const double cost = tiles * (channel_pairs * 5. * points *
+        std::log(points) / std::log(2.) + 8. * filters * h * (w / 2 + 1));
+    if (fft_h == 0 || cost < fft_cost) {
+      fft_cost = cost;
+      fft_h = h;
+      fft_w = w;
+    }
+    if (size >= std::max(whole_h, whole_w)) {
+      break;
+    }
+  }
+  const double gemm_cost = 2. * filters * kernel_h_ * kernel_w_ *
+      conv_out_spatial_dim_;
+  const bool use_fft = fft_cost < gemm_cost ||
+      !this->layer_param_.convolution_param().fft_crossover();
+  if (fft_decided_ && use_fft == use_fft_ && (!use_fft_ ||
+      (fft_->height() == fft_h && fft_->width() == fft_w))) {
+    return;
+  }
+  fft_decided_ = true;
+  use_fft_ = use_fft;
+  if (!use_fft_) {
+    LOG(INFO) << "Using im2col and gemm convolution in CPU mode: FFTs would "
+        << "take " << fft_cost / gemm_cost << " times as many operations";
+    // Release the plans and buffers of an earlier FFT decision.
+    fft_.reset();
+    fft_filters_.reset();
+    fft_buffer_.reset();
+    return;
+  }
+  LOG(INFO) << "Using " << fft_h << "x" << fft_w
+      << " FFT convolution in CPU mode";
+  fft_.reset(new FFT2D<Dtype>(fft_h, fft_w));
+  fft_tile_h_ = (fft_h - kernel_h_) / stride_h_ + 1;
+  fft_tile_w_ = (fft_w - kernel_w_) / stride_w_ + 1;
+  const int half_count = fft_->half_count();
+  fft_filters_.reset();
+  vector<int> buffer_shape(1, num_threads_);
+  buffer_shape.push_back(2 * (fft_h * fft_w + half_count *
+      (std::max(conv_in_channels_, conv_out_channels_) + 2)));
+  fft_buffer_.reset(new Blob<Dtype>(buffer_shape));
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::fft_update_filters() {
+  const size_t version = this->blobs_[0]->data_version();
+  if (fft_filters_ && fft_filters_version_ == version) {
+    return;
+  }
+  // The spectra depend on the size of the FFTs as well.
+  ostringstream key;
+  key << "fft_" << fft_->height() << "x" << fft_->width();
+  fft_filters_ = this->param_cache()->Get(key.str(), version, boost::bind(
+      &BaseConvolutionLayer<Dtype>::fft_compute_filters, this, _1));
+  fft_filters_version_ = version;
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::fft_compute_filters(
+    Blob<Dtype>* spectra_blob) {
+  typedef typename FFT2D<Dtype>::Complex Complex;
+  const Blob<Dtype>& weights = *this->blobs_[0];
+  const FFT2D<Dtype>& fft = *fft_;
+  const int half_count = fft.half_count();
+  vector<int> filters_shape(1, conv_out_channels_);
+  filters_shape.push_back(conv_in_channels_ / group_);
+  filters_shape.push_back(2 * half_count);
+  spectra_blob->Reshape(filters_shape);
+  const int kernel_size = kernel_h_ * kernel_w_;
+  const int filters = weights.num() * weights.channels();
+  const Dtype* weight = weights.cpu_data();
+  Complex* data = reinterpret_cast<Complex*>(fft_buffer_->mutable_cpu_data());
+  Complex* spectra = reinterpret_cast<Complex*>(
+      spectra_blob->mutable_cpu_data());
+  // Two filters at a time, zero padded to the size of the FFTs.
+  for (int f = 0; f < filters; f += 2) {
+    const Dtype* filter_a = weight + f * kernel_size;
+    const Dtype* filter_b = f + 1 < filters ? filter_a + kernel_size : NULL;
+    std::fill(data, data + fft.height() * fft.width(), Complex());
+    for (int kh = 0; kh < kernel_h_; ++kh) {
+      for (int kw = 0; kw < kernel_w_; ++kw) {
+        const int k = kh * kernel_w_ + kw;
+        data[kh * fft.width() + kw] = Complex(filter_a[k],
+            filter_b ? filter_b[k] : Dtype(0));
+      }
+    }
+    fft.ForwardReal(data, spectra + f * half_count,
+        filter_b ? spectra + (f + 1) * half_count : NULL);
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::fft_correlate_cpu(const Dtype* input,
+    Dtype* output, int thread_id) {
+  typedef typename FFT2D<Dtype>::Complex Complex;
+  const FFT2D<Dtype>& fft = *fft_;
+  const int fft_w = fft.width();
+  const int points = fft.height() * fft_w;
+  const int half_count = fft.half_count();
+  Complex* data = reinterpret_cast<Complex*>(const_cast<Dtype*>(
+      fft_buffer_->cpu_data()) + fft_buffer_->offset(thread_id));
+  Complex* spectra = data + points;
+  Complex* sums = spectra +
+      std::max(conv_in_channels_, conv_out_channels_) * half_count;
+  const Complex* filters = reinterpret_cast<const Complex*>(
+      fft_filters_->cpu_data());
+  const int in_dim = conv_in_height_ * conv_in_width_;
+  const int channels_per_group = conv_in_channels_ / group_;
+  const int outputs_per_group = conv_out_channels_ / group_;
+  for (int oh0 = 0; oh0 < conv_out_height_; oh0 += fft_tile_h_) {
+    const int tile_h = std::min(fft_tile_h_, conv_out_height_ - oh0);
+    const int rows = (tile_h - 1) * stride_h_ + kernel_h_;
+    const int y0 = oh0 * stride_h_ - pad_h_;
+    for (int ow0 = 0; ow0 < conv_out_width_; ow0 += fft_tile_w_) {
+      const int tile_w = std::min(fft_tile_w_, conv_out_width_ - ow0);
+      const int cols = (tile_w - 1) * stride_w_ + kernel_w_;
+      const int x0 = ow0 * stride_w_ - pad_w_;
+      // The spectra of the input window of the tile, two channels at a time.
+      for (int c = 0; c < conv_in_channels_; c += 2) {
+        const Dtype* im_a = input + c * in_dim;
+        const Dtype* im_b = c + 1 < conv_in_channels_ ? im_a + in_dim : NULL;
+        std::fill(data, data + points, Complex());
+        for (int r = 0; r < rows; ++r) {
+          const int y = y0 + r;
+          if (y < 0 || y >= conv_in_height_) {
+            continue;
+          }
+          for (int q = 0; q < cols; ++q) {
+            const int x = x0 + q;
+            if (x >= 0 && x < conv_in_width_) {
+              data[r * fft_w + q] = Complex(im_a[y * conv_in_width_ + x],
+                  im_b ? im_b[y * conv_in_width_ + x] : Dtype(0));
+            }
+          }
+        }
+        fft.ForwardReal(data, spectra + c * half_count,
+            im_b ? spectra + (c + 1) * half_count : NULL);
+      }
+      // Correlate with the filters, two output channels at a time, and keep
+      // the outputs the stride samples.
+      for (int o = 0; o < conv_out_channels_; o += 2) {
+        const int pair = std::min(2, conv_out_channels_ - o);
+        for (int k = 0; k < pair; ++k) {
+          const int g = (o + k) / outputs_per_group;
+          Complex* sum = sums + k * half_count;
+          std::fill(sum, sum + half_count, Complex());
+          for (int c = 0; c < channels_per_group; ++c) {
+            SpectrumMultiplyAdd(half_count,
+                spectra + (g * channels_per_group + c) * half_count,
+                filters + ((o + k) * channels_per_group + c) * half_count,
+                true, sum);
+          }
+        }
+        fft.InverseReal(sums, pair == 2 ? sums + half_count : NULL, data);
+        Dtype* out_a = output + o * conv_out_spatial_dim_;
+        Dtype* out_b = out_a + conv_out_spatial_dim_;
+        for (int i = 0; i < tile_h; ++i) {
+          for (int j = 0; j < tile_w; ++j) {
+            const Complex& z = data[i * stride_h_ * fft_w + j * stride_w_];
+            const int index = (oh0 + i) * conv_out_width_ + ow0 + j;
+            out_a[index] = z.real();
+            if (pair == 2) {
+              out_b[index] = z.imag();
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::fft_convolve_cpu(const Dtype* input,
+    Dtype* output, int thread_id) {
+  typedef typename FFT2D<Dtype>::Complex Complex;
+  const FFT2D<Dtype>& fft = *fft_;
+  const int fft_w = fft.width();
+  const int points = fft.height() * fft_w;
+  const int half_count = fft.half_count();
+  Complex* data = reinterpret_cast<Complex*>(const_cast<Dtype*>(
+      fft_buffer_->cpu_data()) + fft_buffer_->offset(thread_id));
+  Complex* spectra = data + points;
+  Complex* sums = spectra +
+      std::max(conv_in_channels_, conv_out_channels_) * half_count;
+  const Complex* filters = reinterpret_cast<const Complex*>(
+      fft_filters_->cpu_data());
+  const int out_dim = conv_in_height_ * conv_in_width_;
+  const int channels_per_group = conv_in_channels_ / group_;
+  const int outputs_per_group = conv_out_channels_ / group_;
+  caffe_set(conv_in_channels_ * out_dim, Dtype(0), output);
+  for (int oh0 = 0; oh0 < conv_out_height_; oh0 += fft_tile_h_) {
+    const int tile_h = std::min(fft_tile_h_, conv_out_height_ - oh0);
+    const int rows = (tile_h - 1) * stride_h_ + kernel_h_;
+    const int y0 = oh0 * stride_h_ - pad_h_;
+    for (int ow0 = 0; ow0 < conv_out_width_; ow0 += fft_tile_w_) {
+      const int tile_w = std::min(fft_tile_w_, conv_out_width_ - ow0);
+      const int cols = (tile_w - 1) * stride_w_ + kernel_w_;
+      const int x0 = ow0 * stride_w_ - pad_w_;
+      // The spectra of the tile, upsampled by the stride, two channels at a
+      // time.
+      for (int o = 0; o < conv_out_channels_; o += 2) {
+        const Dtype* im_a = input + o * conv_out_spatial_dim_;
+        const Dtype* im_b = o + 1 < conv_out_channels_ ?
+            im_a + conv_out_spatial_dim_ : NULL;
+        std::fill(data, data + points, Complex());
+        for (int i = 0; i < tile_h; ++i) {
+          for (int j = 0; j < tile_w; ++j) {
+            const int index = (oh0 + i) * conv_out_width_ + ow0 + j;
+            data[i * stride_h_ * fft_w + j * stride_w_] = Complex(
+                im_a[index], im_b ? im_b[index] : Dtype(0));
+          }
+        }
+        fft.ForwardReal(data, spectra + o * half_count,
+            im_b ? spectra + (o + 1) * half_count : NULL);
+      }
+      // Convolve with the filters, two channels at a time, and add the
+      // windows of the tiles up where they overlap.
+      for (int c = 0; c < conv_in_channels_; c += 2) {
+        const int pair = std::min(2, conv_in_channels_ - c);
+        for (int k = 0; k < pair; ++k) {
+          const int g = (c + k) / channels_per_group;
+          Complex* sum = sums + k * half_count;
+          std::fill(sum, sum + half_count, Complex());
+          for (int o = g * outputs_per_group; o < (g + 1) * outputs_per_group;
+              ++o) {
+            SpectrumMultiplyAdd(half_count, spectra + o * half_count,
+                filters + (o * channels_per_group +
+                    (c + k) % channels_per_group) * half_count,
+                false, sum);
+          }
+        }
+        fft.InverseReal(sums, pair == 2 ? sums + half_count : NULL, data);
+        Dtype* out_a = output + c * out_dim;
+        Dtype* out_b = out_a + out_dim;
+        for (int r = 0; r < rows; ++r) {
+          const int y = y0 + r;
+          if (y < 0 || y >= conv_in_height_) {
+            continue;
+          }
+          for (int q = 0; q < cols; ++q) {
+            const int x = x0 + q;
+            if (x >= 0 && x < conv_in_width_) {
+              const Complex& z = data[r * fft_w + q];
+              out_a[y * conv_in_width_ + x] += z.real();
+              if (pair == 2) {
+                out_b[y * conv_in_width_ + x] += z.imag();
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+size_t BaseConvolutionLayer<Dtype>::workspace_size() const {
+  // TEST nets run Backward only if forced to, and then the column buffer is
+  // allocated apart from the workspace.
+  if (is_1x1_ || (this->phase_ == TEST && Caffe::mode() == Caffe::CPU &&
+      !forward_cpu_uses_col_buffer())) {
+    return 0;
+  }
+  return col_buffer_.count() * sizeof(Dtype);
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::SetWorkspace(
+    const shared_ptr<SyncedMemory>& workspace) {
+  if (!is_1x1_) {
+    col_buffer_.ShareDataMemory(workspace);
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::cpu_for_each_image(
+    const boost::function<void(int, int)>& image_fn, bool backward) {
+  if (backward ? !is_1x1_ : forward_cpu_uses_col_buffer()) {
+    CHECK_GE(col_buffer_.num(), num_threads_);
+    col_buffer_.mutable_cpu_data();
+  }
+  if (use_fft_) {
+    fft_update_filters();
+    fft_buffer_->mutable_cpu_data();
+  }
+  if (quantized_) {
+    // Narrowed in LayerSetUp; the weights may be shared by nets running
+    // Forward concurrently, so they are only read here.
+    CHECK(this->blobs_[0]->cpu_int8_data())
+        << "The int8 weights were widened after SetUp.";
+  }
+  if (num_threads_ == 1) {
+    cpu_image_range(image_fn, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &BaseConvolutionLayer<Dtype>::cpu_image_range, this, image_fn, _1));
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::cpu_image_range(
+    const boost::function<void(int, int)>& image_fn, int thread_id) {
+  const int begin = num_ * thread_id / num_threads_;
+  const int end = num_ * (thread_id + 1) / num_threads_;
+  for (int n = begin; n < end; ++n) {
+    image_fn(n, thread_id);
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::prepare_weight_diff() {
+  if (num_threads_ == 1) {
+    return;
+  }
+  // Allocated on the first weight gradient pass, so that nets that never
+  // run Backward do not pay for it.
+  if (weight_diff_buffer_.count() == 0) {
+    vector<int> weight_diff_shape(1, num_threads_ - 1);
+    weight_diff_shape.push_back(this->blobs_[0]->count());
+    weight_diff_buffer_.Reshape(weight_diff_shape);
+    caffe_set(weight_diff_buffer_.count(), Dtype(0),
+        weight_diff_buffer_.mutable_cpu_data());
+  }
+  weight_diff_buffer_.mutable_cpu_data();
+}
+
+template <typename Dtype>
+Dtype* BaseConvolutionLayer<Dtype>::cpu_weight_diff(Dtype* weight_diff,
+    int thread_id) {
+  if (thread_id == 0) {
+    return weight_diff;
+  }
+  // prepare_weight_diff has made the CPU copy current.
+  return const_cast<Dtype*>(weight_diff_buffer_.cpu_data()) +
+      weight_diff_buffer_.offset(thread_id - 1);
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::reduce_weight_diff(Dtype* weight_diff) {
+  const int count = this->blobs_[0]->count();
+  for (int t = 1; t < num_threads_; ++t) {
+    Dtype* thread_diff = cpu_weight_diff(weight_diff, t);
+    caffe_axpy(count, Dtype(1), thread_diff, weight_diff);
+    caffe_set(count, Dtype(0), thread_diff);
+  }
 }
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
-    const Dtype* weights, Dtype* output, bool skip_im2col) {
+    const Dtype* weights, Dtype* output, bool skip_im2col, int thread_id) {
+  if (use_fft_) {
+    fft_correlate_cpu(input, output, thread_id);
+    return;
+  }
   const Dtype* col_buff = input;
   if (!is_1x1_) {
     if (!skip_im2col) {
-      conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
+      conv_im2col_cpu(input, cpu_col_buffer(thread_id));
     }
-    col_buff = col_buffer_.cpu_data();
+    col_buff = cpu_col_buffer(thread_id);
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_ /
@@ -173,6 +625,37 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
   }
 }
 
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_gemm_int8(const Dtype* input,
+    Dtype* output, int thread_id) {
+  int8_t* input_int8 = &int8_input_[thread_id * bottom_dim_];
+  quantize_int8_cpu(bottom_dim_, input, input_scale_, input_int8);
+  // The patches of one group at a time, as rows to take dot products of
+  // with the rows of weights.
+  int8_t* row_buff = &int8_row_buffer_[thread_id * col_offset_];
+  int32_t* output_int32 = &int32_output_[thread_id * conv_out_channels_ *
+      conv_out_spatial_dim_];
+  const int8_t* weights = this->blobs_[0]->cpu_int8_data();
+  const int group_channels = conv_in_channels_ / group_;
+  for (int g = 0; g < group_; ++g) {
+    im2row_cpu(input_int8 + g * group_channels * conv_in_height_ *
+        conv_in_width_, group_channels, conv_in_height_, conv_in_width_,
+        kernel_h_, kernel_w_, pad_h_, pad_w_, stride_h_, stride_w_, row_buff);
+    int8_gemm_cpu(conv_out_channels_ / group_, conv_out_spatial_dim_,
+        kernel_dim_ / group_, weights + weight_offset_ * g, row_buff,
+        output_int32 + output_offset_ * g);
+  }
+  const Dtype* weight_scales = this->blobs_[0]->cpu_int8_scales();
+  for (int o = 0; o < conv_out_channels_; ++o) {
+    const Dtype scale = input_scale_ * weight_scales[o];
+    const int32_t* acc = output_int32 + o * conv_out_spatial_dim_;
+    Dtype* out = output + o * conv_out_spatial_dim_;
+    for (int i = 0; i < conv_out_spatial_dim_; ++i) {
+      out[i] = acc[i] * scale;
+    }
+  }
+}
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
     const Dtype* bias) {
@@ -183,10 +666,14 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
-    const Dtype* weights, Dtype* input) {
-  Dtype* col_buff = col_buffer_.mutable_cpu_data();
-  if (is_1x1_) {
-    col_buff = input;
+    const Dtype* weights, Dtype* input, int thread_id) {
+  if (use_fft_) {
+    fft_convolve_cpu(output, input, thread_id);
+    return;
+  }
+  Dtype* col_buff = input;
+  if (!is_1x1_) {
+    col_buff = cpu_col_buffer(thread_id);
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_dim_ / group_,
@@ -201,11 +688,11 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::weight_cpu_gemm(const Dtype* input,
-    const Dtype* output, Dtype* weights) {
+    const Dtype* output, Dtype* weights, int thread_id) {
   const Dtype* col_buff = input;
   if (!is_1x1_) {
-    conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
-    col_buff = col_buffer_.cpu_data();
+    conv_im2col_cpu(input, cpu_col_buffer(thread_id));
+    col_buff = cpu_col_buffer(thread_id);
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, conv_out_channels_ / group_,
@@ -253,9 +740,9 @@ void BaseConvolutionLayer<Dtype>::forward_gpu_bias(Dtype* output,
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::backward_gpu_gemm(const Dtype* output,
     const Dtype* weights, Dtype* input) {
-  Dtype* col_buff = col_buffer_.mutable_gpu_data();
-  if (is_1x1_) {
-    col_buff = input;
+  Dtype* col_buff = input;
+  if (!is_1x1_) {
+    col_buff = col_buffer_.mutable_gpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_gpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_dim_ / group_,
@@ -1,30 +0,0 @@
-#include <vector>
-
-#include "caffe/data_layers.hpp"
-
-namespace caffe {
-
-template <typename Dtype>
-void BasePrefetchingDataLayer<Dtype>::Forward_gpu(
-    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  // First, join the thread
-  JoinPrefetchThread();
-  // Reshape to loaded data.
-  top[0]->ReshapeLike(this->prefetch_data_);
-  // Copy the data
-  caffe_copy(prefetch_data_.count(), prefetch_data_.cpu_data(),
-      top[0]->mutable_gpu_data());
-  if (this->output_labels_) {
-    // Reshape to loaded labels.
-    top[1]->ReshapeLike(prefetch_label_);
-    // Copy the labels.
-    caffe_copy(prefetch_label_.count(), prefetch_label_.cpu_data(),
-        top[1]->mutable_gpu_data());
-  }
-  // Start a new prefetch thread
-  CreatePrefetchThread();
-}
-
-INSTANTIATE_LAYER_GPU_FORWARD(BasePrefetchingDataLayer);
-
-}  // namespace caffe
@@ -1,12 +1,16 @@
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layer.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
-const float kBNLL_THRESHOLD = 50.;
+// The number of values whose exponentials are taken together, in a buffer on
+// the stack so that bottom and top may be the same blob.
+const int kBNLLBlock = 256;
 
 template <typename Dtype>
 void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -14,10 +18,19 @@ void BNLLLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = bottom_data[i] > 0 ?
-        bottom_data[i] + log(1. + exp(-bottom_data[i])) :
-        log(1. + exp(bottom_data[i]));
+  // log(1 + exp(x)) = max(x, 0) + log(1 + exp(-|x|)), where the exponential
+  // can neither overflow nor lose the result.
+  Dtype buffer[kBNLLBlock];
+  for (int i0 = 0; i0 < count; i0 += kBNLLBlock) {
+    const int n = std::min(kBNLLBlock, count - i0);
+    for (int i = 0; i < n; ++i) {
+      buffer[i] = -std::fabs(bottom_data[i0 + i]);
+    }
+    caffe_exp(n, buffer, buffer);
+    caffe_log1p(n, buffer, buffer);
+    for (int i = 0; i < n; ++i) {
+      top_data[i0 + i] = std::max(bottom_data[i0 + i], Dtype(0)) + buffer[i];
+    }
   }
 }
 
@@ -30,10 +43,17 @@ void BNLLLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const Dtype* top_diff = top[0]->cpu_diff();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
     const int count = bottom[0]->count();
-    Dtype expval;
-    for (int i = 0; i < count; ++i) {
-      expval = exp(std::min(bottom_data[i], Dtype(kBNLL_THRESHOLD)));
-      bottom_diff[i] = top_diff[i] * expval / (expval + 1.);
+    // The derivative is sigmoid(x) = 1 / (1 + exp(-x)).
+    Dtype buffer[kBNLLBlock];
+    for (int i0 = 0; i0 < count; i0 += kBNLLBlock) {
+      const int n = std::min(kBNLLBlock, count - i0);
+      for (int i = 0; i < n; ++i) {
+        buffer[i] = -bottom_data[i0 + i];
+      }
+      caffe_exp(n, buffer, buffer);
+      for (int i = 0; i < n; ++i) {
+        bottom_diff[i0 + i] = top_diff[i0 + i] / (1. + buffer[i]);
+      }
     }
   }
 }
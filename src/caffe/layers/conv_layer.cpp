@@ -1,13 +1,44 @@
+#include <boost/bind.hpp>
+
 #include <vector>
 
 #include "caffe/filler.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/util/direct_conv.hpp"
+#include "caffe/util/fuse_layers.hpp"
 #include "caffe/util/im2col.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+  BaseConvolutionLayer<Dtype>::LayerSetUp(bottom, top);
+  const ConvolutionParameter& conv_param =
+      this->layer_param_.convolution_param();
+  // The FFT engine chooses between FFTs and gemm in Reshape.
+  const bool fft = conv_param.engine() == ConvolutionParameter_Engine_FFT;
+  switch (conv_param.cpu_method()) {
+  case ConvolutionParameter_CPUMethod_AUTO:
+    use_direct_ = conv_direct_cpu_preferred(this->channels_ / this->group_,
+        this->num_output_ / this->group_, this->kernel_h_, this->kernel_w_,
+        this->stride_h_, this->stride_w_);
+    break;
+  case ConvolutionParameter_CPUMethod_GEMM:
+    use_direct_ = false;
+    break;
+  case ConvolutionParameter_CPUMethod_DIRECT:
+    use_direct_ = true;
+    break;
+  default:
+    LOG(FATAL) << "Unknown CPU method: " << conv_param.cpu_method();
+  }
+  use_direct_ = use_direct_ && !fft && !this->quantized_ && !this->is_1x1_;
+  direct_logged_ = false;
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::compute_output_shape() {
   this->height_out_ = (this->height_ + 2 * this->pad_h_ - this->kernel_h_)
@@ -19,24 +50,57 @@ void ConvolutionLayer<Dtype>::compute_output_shape() {
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  const Dtype* weight = this->blobs_[0]->cpu_data();
+  // Quantized weights stay int8; reading them as Dtype would widen them.
+  const Dtype* weight = this->quantized_ ? NULL :
+      this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  // Logged here rather than in LayerSetUp, where it is not known whether
+  // the CPU path will run (the CUDNN engine shares this setup).
+  if (use_direct_ && !direct_logged_) {
+    LOG(INFO) << "Using direct convolution in CPU mode";
+    direct_logged_ = true;
+  }
   for (int i = 0; i < bottom.size(); ++i) {
-    const Dtype* bottom_data = bottom[i]->cpu_data();
-    Dtype* top_data = top[i]->mutable_cpu_data();
-    for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + bottom[i]->offset(n), weight,
-          top_data + top[i]->offset(n));
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
-        this->forward_cpu_bias(top_data + top[i]->offset(n), bias);
-      }
-    }
+    this->cpu_for_each_image(boost::bind(
+        &ConvolutionLayer<Dtype>::forward_cpu_image, this,
+        bottom[i]->cpu_data(), weight, bias, top[i]->mutable_cpu_data(),
+        _1, _2));
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_image(const Dtype* bottom_data,
+    const Dtype* weight, const Dtype* bias, Dtype* top_data, int n,
+    int thread_id) {
+  if (this->quantized_) {
+    this->forward_cpu_gemm_int8(bottom_data + n * this->bottom_dim_,
+        top_data + n * this->top_dim_, thread_id);
+  } else if (use_direct_) {
+    conv_direct_cpu(bottom_data + n * this->bottom_dim_, this->channels_,
+        this->height_, this->width_, this->num_output_, this->group_,
+        this->kernel_h_, this->kernel_w_, this->pad_h_, this->pad_w_,
+        this->stride_h_, this->stride_w_, weight,
+        top_data + n * this->top_dim_);
+  } else {
+    this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+        top_data + n * this->top_dim_, false, thread_id);
+  }
+  const ConvolutionParameter& conv_param =
+      this->layer_param_.convolution_param();
+  if (conv_param.has_fused_activation()) {
+    bias_activation_cpu(conv_param.fused_activation(), 1, this->num_output_,
+        this->height_out_ * this->width_out_, bias,
+        top_data + n * this->top_dim_);
+  } else if (bias) {
+    this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
   }
 }
 
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
+  CHECK(!this->layer_param_.convolution_param().has_fused_activation())
+      << "Layers with a fused activation only run forward.";
   const Dtype* weight = this->blobs_[0]->cpu_data();
   Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
   for (int i = 0; i < top.size(); ++i) {
@@ -51,22 +115,38 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       }
     }
     if (this->param_propagate_down_[0] || propagate_down[i]) {
-      for (int n = 0; n < this->num_; ++n) {
-        // gradient w.r.t. weight. Note that we will accumulate diffs.
-        if (this->param_propagate_down_[0]) {
-          this->weight_cpu_gemm(bottom_data + bottom[i]->offset(n),
-              top_diff + top[i]->offset(n), weight_diff);
-        }
-        // gradient w.r.t. bottom data, if necessary.
-        if (propagate_down[i]) {
-          this->backward_cpu_gemm(top_diff + top[i]->offset(n), weight,
-              bottom_diff + bottom[i]->offset(n));
-        }
+      if (this->param_propagate_down_[0]) {
+        this->prepare_weight_diff();
+      }
+      this->cpu_for_each_image(boost::bind(
+          &ConvolutionLayer<Dtype>::backward_cpu_image, this,
+          top_diff, bottom_data, weight,
+          this->param_propagate_down_[0] ? weight_diff : NULL,
+          propagate_down[i] ? bottom_diff : NULL, _1, _2), true);
+      if (this->param_propagate_down_[0]) {
+        this->reduce_weight_diff(weight_diff);
       }
     }
   }
 }
 
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::backward_cpu_image(const Dtype* top_diff,
+    const Dtype* bottom_data, const Dtype* weight, Dtype* weight_diff,
+    Dtype* bottom_diff, int n, int thread_id) {
+  // gradient w.r.t. weight. Note that we will accumulate diffs.
+  if (weight_diff) {
+    this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
+        top_diff + n * this->top_dim_,
+        this->cpu_weight_diff(weight_diff, thread_id), thread_id);
+  }
+  // gradient w.r.t. bottom data, if necessary.
+  if (bottom_diff) {
+    this->backward_cpu_gemm(top_diff + n * this->top_dim_, weight,
+        bottom_diff + n * this->bottom_dim_, thread_id);
+  }
+}
+
 #ifdef CPU_ONLY
 STUB_GPU(ConvolutionLayer);
 #endif
@@ -2,6 +2,7 @@
 
 #include "caffe/filler.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/util/fuse_layers.hpp"
 #include "caffe/util/im2col.hpp"
 #include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
@@ -18,7 +19,14 @@ void ConvolutionLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
     for (int n = 0; n < this->num_; ++n) {
       this->forward_gpu_gemm(bottom_data + bottom[i]->offset(n), weight,
           top_data + top[i]->offset(n));
-      if (this->bias_term_) {
+      const ConvolutionParameter& conv_param =
+          this->layer_param_.convolution_param();
+      if (conv_param.has_fused_activation()) {
+        bias_activation_gpu(conv_param.fused_activation(), 1,
+            this->num_output_, this->height_out_ * this->width_out_,
+            this->bias_term_ ? this->blobs_[1]->gpu_data() : NULL,
+            top_data + top[i]->offset(n));
+      } else if (this->bias_term_) {
         const Dtype* bias = this->blobs_[1]->gpu_data();
         this->forward_gpu_bias(top_data + top[i]->offset(n), bias);
       }
@@ -29,6 +37,8 @@ void ConvolutionLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
+  CHECK(!this->layer_param_.convolution_param().has_fused_activation())
+      << "Layers with a fused activation only run forward.";
   const Dtype* weight = this->blobs_[0]->gpu_data();
   Dtype* weight_diff = this->blobs_[0]->mutable_gpu_diff();
   for (int i = 0; i < top.size(); ++i) {
@@ -1,7 +1,10 @@
+#include <boost/bind.hpp>
 #include <opencv2/core/core.hpp>
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include <string>
 #include <vector>
 
@@ -40,14 +43,14 @@ void DataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   }
   // Read a data point, to initialize the prefetch and top blobs.
   Datum datum;
-  datum.ParseFromString(cursor_->value());
+  datum.ParseFromArray(cursor_->value_data(), cursor_->value_size());
   // Use data_transformer to infer the expected blob shape from datum.
   vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
   this->transformed_data_.Reshape(top_shape);
-  // Reshape top[0] and prefetch_data according to the batch_size.
+  // Reshape top[0] according to the batch_size; the prefetch batches are
+  // shaped after it.
   top_shape[0] = this->layer_param_.data_param().batch_size();
-  this->prefetch_data_.Reshape(top_shape);
-  top[0]->ReshapeLike(this->prefetch_data_);
+  top[0]->Reshape(top_shape);
 
   LOG(INFO) << "output data size: " << top[0]->num() << ","
       << top[0]->channels() << "," << top[0]->height() << ","
@@ -56,56 +59,73 @@ void DataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   if (this->output_labels_) {
     vector<int> label_shape(1, this->layer_param_.data_param().batch_size());
     top[1]->Reshape(label_shape);
-    this->prefetch_label_.Reshape(label_shape);
+  }
+  // decode threads
+  const int decode_threads = this->layer_param_.data_param().decode_threads();
+  CHECK_GT(decode_threads, 0) << "decode_threads must be positive";
+  const int num_slices = std::min(decode_threads, top_shape[0]);
+  slice_transformers_.clear();
+  slice_data_.clear();
+  slice_transformers_.push_back(this->data_transformer_);
+  for (int i = 1; i < num_slices; ++i) {
+    slice_transformers_.push_back(shared_ptr<DataTransformer<Dtype> >(
+        new DataTransformer<Dtype>(this->transform_param_, this->phase_)));
+  }
+  for (int i = 0; i < num_slices; ++i) {
+    slice_data_.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    slice_data_[i]->ReshapeLike(this->transformed_data_);
+  }
+  batch_values_.resize(top_shape[0]);
+  batch_sizes_.resize(top_shape[0]);
+  if (!cursor_->stable_values()) {
+    batch_copies_.resize(top_shape[0]);
+  }
+  batch_datums_.resize(top_shape[0]);
+  decode_pool_.reset(new ThreadPool(num_slices));
+  if (num_slices > 1) {
+    LOG(INFO) << "Decoding batches with " << num_slices << " threads";
   }
 }
 
-// This function is used to create a thread that prefetches the data.
 template <typename Dtype>
-void DataLayer<Dtype>::InternalThreadEntry() {
+void DataLayer<Dtype>::CreatePrefetchThread() {
+  // Reseed the extra slice transformers here, in the calling thread, so that
+  // the streams they draw from depend only on the Caffe random seed.
+  for (int i = 1; i < slice_transformers_.size(); ++i) {
+    slice_transformers_[i]->InitRand();
+  }
+  BasePrefetchingDataLayer<Dtype>::CreatePrefetchThread();
+}
+
+// This function is called on prefetch thread
+template <typename Dtype>
+void DataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CPUTimer batch_timer;
   batch_timer.Start();
   double read_time = 0;
   double trans_time = 0;
   CPUTimer timer;
-  CHECK(this->prefetch_data_.count());
+  CHECK(batch->data_.count());
   CHECK(this->transformed_data_.count());
 
   // Reshape according to the first datum of each batch
   // on single input batches allows for inputs of varying dimension.
   const int batch_size = this->layer_param_.data_param().batch_size();
-  Datum datum;
-  datum.ParseFromString(cursor_->value());
-  // Use data_transformer to infer the expected blob shape from datum.
-  vector<int> top_shape = this->data_transformer_->InferBlobShape(datum);
-  this->transformed_data_.Reshape(top_shape);
-  // Reshape prefetch_data according to the batch_size.
-  top_shape[0] = batch_size;
-  this->prefetch_data_.Reshape(top_shape);
-
-  Dtype* top_data = this->prefetch_data_.mutable_cpu_data();
-  Dtype* top_label = NULL;  // suppress warnings about uninitialized variables
-
-  if (this->output_labels_) {
-    top_label = this->prefetch_label_.mutable_cpu_data();
-  }
   timer.Start();
+  // Walk the cursor serially, only collecting the records; the decode
+  // threads parse them. Where the database keeps its values in place they
+  // are not copied at all, otherwise each is copied into a buffer that is
+  // reused from batch to batch.
+  const bool stable_values = cursor_->stable_values();
   for (int item_id = 0; item_id < batch_size; ++item_id) {
-    // get a datum
-    Datum datum;
-    datum.ParseFromString(cursor_->value());
-    read_time += timer.MicroSeconds();
-    timer.Start();
-    // Apply data transformations (mirror, scale, crop...)
-    int offset = this->prefetch_data_.offset(item_id);
-    this->transformed_data_.set_cpu_data(top_data + offset);
-    this->data_transformer_->Transform(datum, &(this->transformed_data_));
-    // Copy label.
-    if (this->output_labels_) {
-      top_label[item_id] = datum.label();
+    if (stable_values) {
+      batch_values_[item_id] = cursor_->value_data();
+    } else {
+      batch_copies_[item_id].assign(cursor_->value_data(),
+          cursor_->value_size());
+      batch_values_[item_id] = batch_copies_[item_id].data();
     }
-    trans_time += timer.MicroSeconds();
-    timer.Start();
+    batch_sizes_[item_id] = cursor_->value_size();
     // go to the next item.
     cursor_->Next();
     if (!cursor_->valid()) {
@@ -113,6 +133,31 @@ void DataLayer<Dtype>::InternalThreadEntry() {
       cursor_->SeekToFirst();
     }
   }
+  read_time += timer.MicroSeconds();
+  // The first record is parsed here for the shape of the batch.
+  batch_datums_[0].ParseFromArray(batch_values_[0], batch_sizes_[0]);
+  // Use data_transformer to infer the expected blob shape from datum.
+  vector<int> top_shape =
+      this->data_transformer_->InferBlobShape(batch_datums_[0]);
+  this->transformed_data_.Reshape(top_shape);
+  for (int i = 0; i < slice_data_.size(); ++i) {
+    slice_data_[i]->Reshape(top_shape);
+  }
+  // Reshape batch according to the batch_size.
+  top_shape[0] = batch_size;
+  batch->data_.Reshape(top_shape);
+
+  Dtype* top_data = batch->data_.mutable_cpu_data();
+  Dtype* top_label = NULL;  // suppress warnings about uninitialized variables
+
+  if (this->output_labels_) {
+    top_label = batch->label_.mutable_cpu_data();
+  }
+  timer.Start();
+  // Apply data transformations (mirror, scale, crop...)
+  decode_pool_->Run(slice_transformers_.size(), boost::bind(
+      &DataLayer<Dtype>::DecodeSlice, this, _1, top_data, top_label));
+  trans_time += timer.MicroSeconds();
   timer.Stop();
   batch_timer.Stop();
   DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
@@ -120,6 +165,30 @@ void DataLayer<Dtype>::InternalThreadEntry() {
   DLOG(INFO) << "Transform time: " << trans_time / 1000 << " ms.";
 }
 
+template <typename Dtype>
+void DataLayer<Dtype>::DecodeSlice(int slice, Dtype* top_data,
+    Dtype* top_label) {
+  const int batch_size = this->layer_param_.data_param().batch_size();
+  const int num_slices = slice_transformers_.size();
+  const int begin = batch_size * slice / num_slices;
+  const int end = batch_size * (slice + 1) / num_slices;
+  DataTransformer<Dtype>* transformer = slice_transformers_[slice].get();
+  Blob<Dtype>* transformed_data = slice_data_[slice].get();
+  for (int item_id = begin; item_id < end; ++item_id) {
+    Datum& datum = batch_datums_[item_id];
+    if (item_id > 0) {
+      datum.ParseFromArray(batch_values_[item_id], batch_sizes_[item_id]);
+    }
+    int offset = transformed_data->count() * item_id;
+    transformed_data->set_cpu_data(top_data + offset);
+    transformer->Transform(datum, transformed_data);
+    // Copy label.
+    if (this->output_labels_) {
+      top_label[item_id] = datum.label();
+    }
+  }
+}
+
 INSTANTIATE_CLASS(DataLayer);
 REGISTER_LAYER_CLASS(Data);
 
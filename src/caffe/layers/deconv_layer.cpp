@@ -1,3 +1,5 @@
+#include <boost/bind.hpp>
+
 #include <vector>
 
 #include "caffe/filler.hpp"
@@ -20,17 +22,23 @@ template <typename Dtype>
 void DeconvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
   for (int i = 0; i < bottom.size(); ++i) {
-    const Dtype* bottom_data = bottom[i]->cpu_data();
-    Dtype* top_data = top[i]->mutable_cpu_data();
-    for (int n = 0; n < this->num_; ++n) {
-      this->backward_cpu_gemm(bottom_data + bottom[i]->offset(n), weight,
-          top_data + top[i]->offset(n));
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
-        this->forward_cpu_bias(top_data + top[i]->offset(n), bias);
-      }
-    }
+    this->cpu_for_each_image(boost::bind(
+        &DeconvolutionLayer<Dtype>::forward_cpu_image, this,
+        bottom[i]->cpu_data(), weight, bias, top[i]->mutable_cpu_data(),
+        _1, _2));
+  }
+}
+
+template <typename Dtype>
+void DeconvolutionLayer<Dtype>::forward_cpu_image(const Dtype* bottom_data,
+    const Dtype* weight, const Dtype* bias, Dtype* top_data, int n,
+    int thread_id) {
+  this->backward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+      top_data + n * this->top_dim_, thread_id);
+  if (bias) {
+    this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
   }
 }
 
@@ -51,24 +59,39 @@ void DeconvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       }
     }
     if (this->param_propagate_down_[0] || propagate_down[i]) {
-      for (int n = 0; n < this->num_; ++n) {
-        // Gradient w.r.t. weight. Note that we will accumulate diffs.
-        if (this->param_propagate_down_[0]) {
-          this->weight_cpu_gemm(top_diff + top[i]->offset(n),
-              bottom_data + bottom[i]->offset(n), weight_diff);
-        }
-        // Gradient w.r.t. bottom data, if necessary, reusing the column buffer
-        // we might have just computed above.
-        if (propagate_down[i]) {
-          this->forward_cpu_gemm(top_diff + top[i]->offset(n), weight,
-              bottom_diff + bottom[i]->offset(n),
-              this->param_propagate_down_[0]);
-        }
+      if (this->param_propagate_down_[0]) {
+        this->prepare_weight_diff();
+      }
+      this->cpu_for_each_image(boost::bind(
+          &DeconvolutionLayer<Dtype>::backward_cpu_image, this,
+          top_diff, bottom_data, weight,
+          this->param_propagate_down_[0] ? weight_diff : NULL,
+          propagate_down[i] ? bottom_diff : NULL, _1, _2), true);
+      if (this->param_propagate_down_[0]) {
+        this->reduce_weight_diff(weight_diff);
       }
     }
   }
 }
 
+template <typename Dtype>
+void DeconvolutionLayer<Dtype>::backward_cpu_image(const Dtype* top_diff,
+    const Dtype* bottom_data, const Dtype* weight, Dtype* weight_diff,
+    Dtype* bottom_diff, int n, int thread_id) {
+  // Gradient w.r.t. weight. Note that we will accumulate diffs.
+  if (weight_diff) {
+    this->weight_cpu_gemm(top_diff + n * this->top_dim_,
+        bottom_data + n * this->bottom_dim_,
+        this->cpu_weight_diff(weight_diff, thread_id), thread_id);
+  }
+  // Gradient w.r.t. bottom data, if necessary, reusing the column buffer
+  // we might have just computed above.
+  if (bottom_diff) {
+    this->forward_cpu_gemm(top_diff + n * this->top_dim_, weight,
+        bottom_diff + n * this->bottom_dim_, weight_diff != NULL, thread_id);
+  }
+}
+
 #ifdef CPU_ONLY
 STUB_GPU(DeconvolutionLayer);
 #endif
@@ -4,7 +4,10 @@
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
 #include "caffe/layer.hpp"
+#include "caffe/util/fuse_layers.hpp"
+#include "caffe/util/half.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/quantize.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
@@ -21,9 +24,19 @@ void InnerProductLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   // length K_ vector. For example, if bottom[0]'s shape is (N, C, H, W),
   // and axis == 1, N inner products with dimension CHW are performed.
   K_ = bottom[0]->count(axis);
+  vector<int> weight_shape(2);
+  weight_shape[0] = N_;
+  weight_shape[1] = K_;
+  const vector<int> bias_shape(1, N_);
   // Check if we need to set up the weights
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
+    CHECK_EQ(1 + bias_term_, this->blobs_.size())
+        << "Incorrect number of weight blobs.";
+    this->CheckParamShape(0, weight_shape);
+    if (bias_term_) {
+      this->CheckParamShape(1, bias_shape);
+    }
   } else {
     if (bias_term_) {
       this->blobs_.resize(2);
@@ -31,9 +44,6 @@ void InnerProductLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       this->blobs_.resize(1);
     }
     // Intialize the weight
-    vector<int> weight_shape(2);
-    weight_shape[0] = N_;
-    weight_shape[1] = K_;
     this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
     // fill the weights
     shared_ptr<Filler<Dtype> > weight_filler(GetFiller<Dtype>(
@@ -41,7 +51,6 @@ void InnerProductLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     weight_filler->Fill(this->blobs_[0].get());
     // If necessary, intiialize and fill the bias term
     if (bias_term_) {
-      vector<int> bias_shape(1, N_);
       this->blobs_[1].reset(new Blob<Dtype>(bias_shape));
       shared_ptr<Filler<Dtype> > bias_filler(GetFiller<Dtype>(
           this->layer_param_.inner_product_param().bias_filler()));
@@ -49,6 +58,24 @@ void InnerProductLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     }
   }  // parameter initialization
   this->param_propagate_down_.resize(this->blobs_.size(), true);
+  // Quantize TEST nets that were calibrated for it.
+  quantized_ = this->layer_param_.has_quantization_param() &&
+      this->phase_ == TEST;
+  if (quantized_) {
+    input_scale_ = this->layer_param_.quantization_param().input_scale();
+    CHECK_GT(input_scale_, 0) << "input_scale must be positive.";
+    LOG(INFO) << "Using int8 quantized inner product in CPU mode";
+    // Quantize the weights once, releasing their Dtype data; weights
+    // loaded later are quantized as they replace them (see Blob::ToInt8).
+    this->blobs_[0]->ToInt8(N_);
+  }
+  half_weights_ = this->layer_param_.inner_product_param().half_weights() &&
+      this->phase_ == TEST && !quantized_;
+  // Narrow the weights now, as they may be shared by nets running Forward
+  // concurrently.
+  if (half_weights_) {
+    this->blobs_[0]->ToHalf();
+  }
 }
 
 template <typename Dtype>
@@ -75,6 +102,13 @@ void InnerProductLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     bias_multiplier_.Reshape(bias_shape);
     caffe_set(M_, Dtype(1), bias_multiplier_.mutable_cpu_data());
   }
+  if (quantized_) {
+    int8_input_.resize(M_ * K_);
+    int32_output_.resize(M_ * N_);
+  }
+  if (half_weights_) {
+    half_panel_.resize(caffe_cpu_gemm_half_panel_count(N_, K_));
+  }
 }
 
 template <typename Dtype>
@@ -82,10 +116,39 @@ void InnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
-  const Dtype* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
-      bottom_data, weight, (Dtype)0., top_data);
-  if (bias_term_) {
+  if (quantized_) {
+    // Narrowed in LayerSetUp, and only read here; see half_weights_.
+    CHECK(this->blobs_[0]->cpu_int8_data())
+        << "The int8 weights were widened after SetUp.";
+    quantize_int8_cpu(M_ * K_, bottom_data, input_scale_, &int8_input_[0]);
+    int8_gemm_cpu(M_, N_, K_, &int8_input_[0],
+        this->blobs_[0]->cpu_int8_data(), &int32_output_[0]);
+    const Dtype* weight_scales = this->blobs_[0]->cpu_int8_scales();
+    for (int m = 0; m < M_; ++m) {
+      for (int n = 0; n < N_; ++n) {
+        top_data[m * N_ + n] =
+            int32_output_[m * N_ + n] * input_scale_ * weight_scales[n];
+      }
+    }
+  } else if (half_weights_) {
+    // Narrowed in LayerSetUp; the weights may be shared by nets running
+    // Forward concurrently, so they are only read here.
+    CHECK(this->blobs_[0]->cpu_half_data())
+        << "The fp16 weights were widened after SetUp.";
+    caffe_cpu_gemm_half<Dtype>(M_, N_, K_, (Dtype)1., bottom_data,
+        this->blobs_[0]->cpu_half_data(), (Dtype)0., top_data,
+        &half_panel_[0]);
+  } else {
+    const Dtype* weight = this->blobs_[0]->cpu_data();
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, M_, N_, K_, (Dtype)1.,
+        bottom_data, weight, (Dtype)0., top_data);
+  }
+  const InnerProductParameter& inner_product_param =
+      this->layer_param_.inner_product_param();
+  if (inner_product_param.has_fused_activation()) {
+    bias_activation_cpu(inner_product_param.fused_activation(), M_, N_, 1,
+        bias_term_ ? this->blobs_[1]->cpu_data() : NULL, top_data);
+  } else if (bias_term_) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, (Dtype)1.,
         bias_multiplier_.cpu_data(),
         this->blobs_[1]->cpu_data(), (Dtype)1., top_data);
@@ -96,6 +159,8 @@ template <typename Dtype>
 void InnerProductLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const vector<bool>& propagate_down,
     const vector<Blob<Dtype>*>& bottom) {
+  CHECK(!this->layer_param_.inner_product_param().has_fused_activation())
+      << "Layers with a fused activation only run forward.";
   if (this->param_propagate_down_[0]) {
     const Dtype* top_diff = top[0]->cpu_diff();
     const Dtype* bottom_data = bottom[0]->cpu_data();
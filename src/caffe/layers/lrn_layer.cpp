@@ -1,3 +1,7 @@
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "caffe/layer.hpp"
@@ -6,6 +10,41 @@
 
 namespace caffe {
 
+namespace {
+
+// The number of positions of a channel whose window sums are kept on the
+// stack while the window slides over the channels.
+const int kTile = 256;
+
+template <typename Dtype>
+inline void add_squares(const int m, const Dtype* x, Dtype* sum) {
+  for (int k = 0; k < m; ++k) {
+    sum[k] += x[k] * x[k];
+  }
+}
+
+template <typename Dtype>
+inline void subtract_squares(const int m, const Dtype* x, Dtype* sum) {
+  for (int k = 0; k < m; ++k) {
+    sum[k] -= x[k] * x[k];
+  }
+}
+
+// Raises the m scales to the power -beta in place; the common beta = 0.75
+// takes two square roots instead of a pow.
+template <typename Dtype>
+inline void inverse_power(const int m, const Dtype beta, Dtype* scale) {
+  if (beta == Dtype(0.75)) {
+    for (int k = 0; k < m; ++k) {
+      scale[k] = Dtype(1) / std::sqrt(scale[k] * std::sqrt(scale[k]));
+    }
+  } else {
+    caffe_powx(m, scale, -beta, scale);
+  }
+}
+
+}  // namespace
+
 template <typename Dtype>
 void LRNLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
@@ -15,6 +54,11 @@ void LRNLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   alpha_ = this->layer_param_.lrn_param().alpha();
   beta_ = this->layer_param_.lrn_param().beta();
   k_ = this->layer_param_.lrn_param().k();
+  num_threads_ = this->layer_param_.lrn_param().num_threads();
+  CHECK_GT(num_threads_, 0) << "num_threads must be positive.";
+  if (num_threads_ > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads_));
+  }
   if (this->layer_param_.lrn_param().norm_region() ==
       LRNParameter_NormRegion_WITHIN_CHANNEL) {
     // Set up split_layer_ to use inputs in the numerator and denominator.
@@ -79,6 +123,7 @@ void LRNLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   case LRNParameter_NormRegion_ACROSS_CHANNELS:
     top[0]->Reshape(num_, channels_, height_, width_);
     scale_.Reshape(num_, channels_, height_, width_);
+    ratio_buffer_.Reshape(num_threads_, channels_, kTile, 1);
     break;
   case LRNParameter_NormRegion_WITHIN_CHANNEL:
     split_layer_->Reshape(bottom, split_top_vec_);
@@ -110,46 +155,58 @@ void LRNLayer<Dtype>::CrossChannelForward_cpu(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
-  Dtype* scale_data = scale_.mutable_cpu_data();
-  // start with the constant value
-  for (int i = 0; i < scale_.count(); ++i) {
-    scale_data[i] = k_;
+  if (num_threads_ == 1) {
+    cross_channel_forward_cpu_range(bottom_data, top_data, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &LRNLayer<Dtype>::cross_channel_forward_cpu_range, this, bottom_data,
+        top_data, _1));
   }
-  Blob<Dtype> padded_square(1, channels_ + size_ - 1, height_, width_);
-  Dtype* padded_square_data = padded_square.mutable_cpu_data();
-  caffe_set(padded_square.count(), Dtype(0), padded_square_data);
-  Dtype alpha_over_size = alpha_ / size_;
-  // go through the images
-  for (int n = 0; n < num_; ++n) {
-    // compute the padded square
-    caffe_sqr(channels_ * height_ * width_,
-        bottom_data + bottom[0]->offset(n),
-        padded_square_data + padded_square.offset(0, pre_pad_));
-    // Create the first channel scale
-    for (int c = 0; c < size_; ++c) {
-      caffe_axpy<Dtype>(height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c),
-          scale_data + scale_.offset(n, 0));
+}
+
+template <typename Dtype>
+void LRNLayer<Dtype>::cross_channel_forward_cpu_range(
+    const Dtype* bottom_data, Dtype* top_data, int thread_id) {
+  const int spatial_dim = height_ * width_;
+  const int num_tiles = (spatial_dim + kTile - 1) / kTile;
+  const int num_units = num_ * num_tiles;
+  const int begin = num_units * thread_id / num_threads_;
+  const int end = num_units * (thread_id + 1) / num_threads_;
+  const Dtype alpha_over_size = alpha_ / size_;
+  Dtype sum[kTile];
+  Dtype scale[kTile];
+  for (int unit = begin; unit < end; ++unit) {
+    const int k0 = unit % num_tiles * kTile;
+    const int m = std::min(kTile, spatial_dim - k0);
+    const int offset = unit / num_tiles * channels_ * spatial_dim + k0;
+    const Dtype* bottom = bottom_data + offset;
+    Dtype* top = top_data + offset;
+    // sum is the sum of squares over the window of channel c: channels
+    // c - pre_pad_ to c + pre_pad_, those outside the input being zero.
+    for (int k = 0; k < m; ++k) {
+      sum[k] = 0;
     }
-    for (int c = 1; c < channels_; ++c) {
-      // copy previous scale
-      caffe_copy<Dtype>(height_ * width_,
-          scale_data + scale_.offset(n, c - 1),
-          scale_data + scale_.offset(n, c));
-      // add head
-      caffe_axpy<Dtype>(height_ * width_, alpha_over_size,
-          padded_square_data + padded_square.offset(0, c + size_ - 1),
-          scale_data + scale_.offset(n, c));
-      // subtract tail
-      caffe_axpy<Dtype>(height_ * width_, -alpha_over_size,
-          padded_square_data + padded_square.offset(0, c - 1),
-          scale_data + scale_.offset(n, c));
+    for (int c = 0; c < std::min(pre_pad_, channels_); ++c) {
+      add_squares(m, bottom + c * spatial_dim, sum);
+    }
+    for (int c = 0; c < channels_; ++c) {
+      if (c + pre_pad_ < channels_) {
+        add_squares(m, bottom + (c + pre_pad_) * spatial_dim, sum);
+      }
+      for (int k = 0; k < m; ++k) {
+        scale[k] = k_ + alpha_over_size * sum[k];
+      }
+      inverse_power(m, beta_, scale);
+      const Dtype* bottom_c = bottom + c * spatial_dim;
+      Dtype* top_c = top + c * spatial_dim;
+      for (int k = 0; k < m; ++k) {
+        top_c[k] = bottom_c[k] * scale[k];
+      }
+      if (c >= pre_pad_) {
+        subtract_squares(m, bottom + (c - pre_pad_) * spatial_dim, sum);
+      }
     }
   }
-
-  // In the end, compute output
-  caffe_powx<Dtype>(scale_.count(), scale_data, -beta_, top_data);
-  caffe_mul<Dtype>(scale_.count(), top_data, bottom_data, top_data);
 }
 
 template <typename Dtype>
@@ -184,50 +241,100 @@ void LRNLayer<Dtype>::CrossChannelBackward_cpu(
   const Dtype* top_diff = top[0]->cpu_diff();
   const Dtype* top_data = top[0]->cpu_data();
   const Dtype* bottom_data = bottom[0]->cpu_data();
-  const Dtype* scale_data = scale_.cpu_data();
   Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
-  Blob<Dtype> padded_ratio(1, channels_ + size_ - 1, height_, width_);
-  Blob<Dtype> accum_ratio(1, 1, height_, width_);
-  Dtype* padded_ratio_data = padded_ratio.mutable_cpu_data();
-  Dtype* accum_ratio_data = accum_ratio.mutable_cpu_data();
-  // We hack a little bit by using the diff() to store an additional result
-  Dtype* accum_ratio_times_bottom = accum_ratio.mutable_cpu_diff();
-  caffe_set(padded_ratio.count(), Dtype(0), padded_ratio_data);
-  Dtype cache_ratio_value = 2. * alpha_ * beta_ / size_;
-
-  caffe_powx<Dtype>(scale_.count(), scale_data, -beta_, bottom_diff);
-  caffe_mul<Dtype>(scale_.count(), top_diff, bottom_diff, bottom_diff);
+  if (num_threads_ == 1) {
+    cross_channel_backward_cpu_range(top_diff, top_data, bottom_data,
+        bottom_diff, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &LRNLayer<Dtype>::cross_channel_backward_cpu_range, this, top_diff,
+        top_data, bottom_data, bottom_diff, _1));
+  }
+}
 
-  // go through individual data
-  int inverse_pre_pad = size_ - (size_ + 1) / 2;
-  for (int n = 0; n < num_; ++n) {
-    int block_offset = scale_.offset(n);
-    // first, compute diff_i * y_i / s_i
-    caffe_mul<Dtype>(channels_ * height_ * width_,
-        top_diff + block_offset, top_data + block_offset,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad));
-    caffe_div<Dtype>(channels_ * height_ * width_,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad),
-        scale_data + block_offset,
-        padded_ratio_data + padded_ratio.offset(0, inverse_pre_pad));
-    // Now, compute the accumulated ratios and the bottom diff
-    caffe_set(accum_ratio.count(), Dtype(0), accum_ratio_data);
-    for (int c = 0; c < size_ - 1; ++c) {
-      caffe_axpy<Dtype>(height_ * width_, 1.,
-          padded_ratio_data + padded_ratio.offset(0, c), accum_ratio_data);
+template <typename Dtype>
+void LRNLayer<Dtype>::cross_channel_backward_cpu_range(
+    const Dtype* top_diff, const Dtype* top_data, const Dtype* bottom_data,
+    Dtype* bottom_diff, int thread_id) {
+  const int spatial_dim = height_ * width_;
+  const int num_tiles = (spatial_dim + kTile - 1) / kTile;
+  const int num_units = num_ * num_tiles;
+  const int begin = num_units * thread_id / num_threads_;
+  const int end = num_units * (thread_id + 1) / num_threads_;
+  const Dtype alpha_over_size = alpha_ / size_;
+  const Dtype cache_ratio_value = 2. * alpha_ * beta_ / size_;
+  Dtype* ratio = ratio_buffer_.mutable_cpu_data() +
+      ratio_buffer_.offset(thread_id);
+  Dtype sum[kTile];
+  Dtype scale[kTile];
+  for (int unit = begin; unit < end; ++unit) {
+    const int k0 = unit % num_tiles * kTile;
+    const int m = std::min(kTile, spatial_dim - k0);
+    const int offset = unit / num_tiles * channels_ * spatial_dim + k0;
+    const Dtype* bottom = bottom_data + offset;
+    const Dtype* top = top_data + offset;
+    const Dtype* top_d = top_diff + offset;
+    Dtype* bottom_d = bottom_diff + offset;
+    // Slide the window as in the forward pass to find the scales again; the
+    // diff through the numerator is top_diff * scale^-beta, and
+    // top_diff * top / scale is kept for that through the scales.
+    for (int k = 0; k < m; ++k) {
+      sum[k] = 0;
+    }
+    for (int c = 0; c < std::min(pre_pad_, channels_); ++c) {
+      add_squares(m, bottom + c * spatial_dim, sum);
+    }
+    for (int c = 0; c < channels_; ++c) {
+      if (c + pre_pad_ < channels_) {
+        add_squares(m, bottom + (c + pre_pad_) * spatial_dim, sum);
+      }
+      for (int k = 0; k < m; ++k) {
+        scale[k] = k_ + alpha_over_size * sum[k];
+      }
+      const Dtype* top_c = top + c * spatial_dim;
+      const Dtype* top_d_c = top_d + c * spatial_dim;
+      Dtype* ratio_c = ratio + c * kTile;
+      for (int k = 0; k < m; ++k) {
+        ratio_c[k] = top_d_c[k] * top_c[k] / scale[k];
+      }
+      inverse_power(m, beta_, scale);
+      Dtype* bottom_d_c = bottom_d + c * spatial_dim;
+      for (int k = 0; k < m; ++k) {
+        bottom_d_c[k] = top_d_c[k] * scale[k];
+      }
+      if (c >= pre_pad_) {
+        subtract_squares(m, bottom + (c - pre_pad_) * spatial_dim, sum);
+      }
+    }
+    // Then slide a window over the ratios: channel c gets
+    // -2 alpha beta / size * bottom * (the sum of the ratios of its window).
+    for (int k = 0; k < m; ++k) {
+      sum[k] = 0;
+    }
+    for (int c = 0; c < std::min(pre_pad_, channels_); ++c) {
+      const Dtype* ratio_c = ratio + c * kTile;
+      for (int k = 0; k < m; ++k) {
+        sum[k] += ratio_c[k];
+      }
     }
     for (int c = 0; c < channels_; ++c) {
-      caffe_axpy<Dtype>(height_ * width_, 1.,
-          padded_ratio_data + padded_ratio.offset(0, c + size_ - 1),
-          accum_ratio_data);
-      // compute bottom diff
-      caffe_mul<Dtype>(height_ * width_,
-          bottom_data + top[0]->offset(n, c),
-          accum_ratio_data, accum_ratio_times_bottom);
-      caffe_axpy<Dtype>(height_ * width_, -cache_ratio_value,
-          accum_ratio_times_bottom, bottom_diff + top[0]->offset(n, c));
-      caffe_axpy<Dtype>(height_ * width_, -1.,
-          padded_ratio_data + padded_ratio.offset(0, c), accum_ratio_data);
+      if (c + pre_pad_ < channels_) {
+        const Dtype* ratio_head = ratio + (c + pre_pad_) * kTile;
+        for (int k = 0; k < m; ++k) {
+          sum[k] += ratio_head[k];
+        }
+      }
+      const Dtype* bottom_c = bottom + c * spatial_dim;
+      Dtype* bottom_d_c = bottom_d + c * spatial_dim;
+      for (int k = 0; k < m; ++k) {
+        bottom_d_c[k] -= cache_ratio_value * bottom_c[k] * sum[k];
+      }
+      if (c >= pre_pad_) {
+        const Dtype* ratio_tail = ratio + (c - pre_pad_) * kTile;
+        for (int k = 0; k < m; ++k) {
+          sum[k] -= ratio_tail[k];
+        }
+      }
     }
   }
 }
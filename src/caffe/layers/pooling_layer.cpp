@@ -1,3 +1,5 @@
+#include <boost/bind.hpp>
+
 #include <algorithm>
 #include <cfloat>
 #include <vector>
@@ -76,6 +78,13 @@ void PoolingLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
     CHECK_LT(pad_h_, kernel_h_);
     CHECK_LT(pad_w_, kernel_w_);
   }
+  mask_free_ = pool_param.pool() == PoolingParameter_PoolMethod_MAX &&
+      this->phase_ == TEST && top.size() == 1;
+  num_threads_ = pool_param.num_threads();
+  CHECK_GT(num_threads_, 0) << "num_threads must be positive.";
+  if (num_threads_ > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads_));
+  }
 }
 
 template <typename Dtype>
@@ -111,6 +120,16 @@ void PoolingLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   if (top.size() > 1) {
     top[1]->ReshapeLike(*top[0]);
   }
+  fast_kernel_ = 0;
+  full_height_ = full_width_ = 0;
+  if (kernel_h_ == kernel_w_ && (kernel_h_ == 2 || kernel_h_ == 3) &&
+      stride_h_ == 2 && stride_w_ == 2 && pad_h_ == 0 && pad_w_ == 0) {
+    fast_kernel_ = kernel_h_;
+    if (height_ >= kernel_h_ && width_ >= kernel_w_) {
+      full_height_ = min((height_ - kernel_h_) / 2 + 1, pooled_height_);
+      full_width_ = min((width_ - kernel_w_) / 2 + 1, pooled_width_);
+    }
+  }
   // If max pooling, we will initialize the vector index part.
   if (this->layer_param_.pooling_param().pool() ==
       PoolingParameter_PoolMethod_MAX && top.size() == 1) {
@@ -125,101 +144,228 @@ void PoolingLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
   }
 }
 
-// TODO(Yangqing): Is there a faster way to do pooling in the channel-first
-// case?
+namespace {
+
+// The index within a plane of the first maximum of the window, which is
+// assumed non-empty, and that maximum in *value.
+template <typename Dtype>
+int window_argmax(const Dtype* bottom, int width, int hstart, int hend,
+    int wstart, int wend, Dtype* value) {
+  Dtype max_value = -FLT_MAX;
+  int max_index = -1;
+  for (int h = hstart; h < hend; ++h) {
+    for (int w = wstart; w < wend; ++w) {
+      const int index = h * width + w;
+      if (bottom[index] > max_value) {
+        max_value = bottom[index];
+        max_index = index;
+      }
+    }
+  }
+  *value = max_value;
+  return max_index;
+}
+
+// Max pools the outputs [0, full_height) x [0, full_width) of a plane, whose
+// K x K windows at stride 2 all lie inside the input. The window loops have
+// constant bounds and no branches, so that they unroll and the loop over the
+// outputs of a row vectorizes.
+template <typename Dtype, int K>
+void max_pool_stride2(const Dtype* bottom, int width, int full_height,
+    int full_width, Dtype* top, int pooled_width) {
+  for (int ph = 0; ph < full_height; ++ph) {
+    const Dtype* bottom_row = bottom + 2 * ph * width;
+    Dtype* top_row = top + ph * pooled_width;
+    for (int pw = 0; pw < full_width; ++pw) {
+      const Dtype* window = bottom_row + 2 * pw;
+      Dtype value = window[0];
+      for (int kh = 0; kh < K; ++kh) {
+        for (int kw = 0; kw < K; ++kw) {
+          value = max(value, window[kh * width + kw]);
+        }
+      }
+      top_row[pw] = value;
+    }
+  }
+}
+
+// As max_pool_stride2 for average pooling. The window is summed in the
+// order of the generic code, so the results are the same.
+template <typename Dtype, int K>
+void ave_pool_stride2(const Dtype* bottom, int width, int full_height,
+    int full_width, Dtype* top, int pooled_width) {
+  for (int ph = 0; ph < full_height; ++ph) {
+    const Dtype* bottom_row = bottom + 2 * ph * width;
+    Dtype* top_row = top + ph * pooled_width;
+    for (int pw = 0; pw < full_width; ++pw) {
+      const Dtype* window = bottom_row + 2 * pw;
+      Dtype sum = 0;
+      for (int kh = 0; kh < K; ++kh) {
+        for (int kw = 0; kw < K; ++kw) {
+          sum += window[kh * width + kw];
+        }
+      }
+      top_row[pw] = sum / (K * K);
+    }
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+void PoolingLayer<Dtype>::cpu_for_each_plane(int num_planes,
+    const boost::function<void(int)>& plane_fn) {
+  if (num_threads_ == 1) {
+    cpu_plane_range(num_planes, plane_fn, 0);
+  } else {
+    thread_pool_->Run(num_threads_, boost::bind(
+        &PoolingLayer<Dtype>::cpu_plane_range, this, num_planes, plane_fn,
+        _1));
+  }
+}
+
+template <typename Dtype>
+void PoolingLayer<Dtype>::cpu_plane_range(int num_planes,
+    const boost::function<void(int)>& plane_fn, int thread_id) {
+  const int begin = num_planes * thread_id / num_threads_;
+  const int end = num_planes * (thread_id + 1) / num_threads_;
+  for (int p = begin; p < end; ++p) {
+    plane_fn(p);
+  }
+}
+
+template <typename Dtype>
+void PoolingLayer<Dtype>::forward_cpu_plane(const Dtype* bottom_data,
+    Dtype* top_data, int* mask, Dtype* top_mask, int p) {
+  const Dtype* bottom = bottom_data + p * height_ * width_;
+  const int top_offset = p * pooled_height_ * pooled_width_;
+  Dtype* top = top_data + top_offset;
+  const bool is_max = this->layer_param_.pooling_param().pool() ==
+      PoolingParameter_PoolMethod_MAX;
+  const bool keep_argmax = mask || top_mask;
+  // The specialized kernels do not track the argmax.
+  int full_height = 0;
+  int full_width = 0;
+  if (fast_kernel_ && !keep_argmax) {
+    full_height = full_height_;
+    full_width = full_width_;
+    if (is_max && fast_kernel_ == 2) {
+      max_pool_stride2<Dtype, 2>(bottom, width_, full_height, full_width,
+          top, pooled_width_);
+    } else if (is_max) {
+      max_pool_stride2<Dtype, 3>(bottom, width_, full_height, full_width,
+          top, pooled_width_);
+    } else if (fast_kernel_ == 2) {
+      ave_pool_stride2<Dtype, 2>(bottom, width_, full_height, full_width,
+          top, pooled_width_);
+    } else {
+      ave_pool_stride2<Dtype, 3>(bottom, width_, full_height, full_width,
+          top, pooled_width_);
+    }
+  }
+  // The rest, whose windows are clipped by the borders of the input.
+  for (int ph = 0; ph < pooled_height_; ++ph) {
+    for (int pw = ph < full_height ? full_width : 0; pw < pooled_width_;
+         ++pw) {
+      int hstart = ph * stride_h_ - pad_h_;
+      int wstart = pw * stride_w_ - pad_w_;
+      const int pool_index = ph * pooled_width_ + pw;
+      if (is_max) {
+        const int hend = min(hstart + kernel_h_, height_);
+        const int wend = min(wstart + kernel_w_, width_);
+        hstart = max(hstart, 0);
+        wstart = max(wstart, 0);
+        const int index = window_argmax(bottom, width_, hstart, hend, wstart,
+            wend, &top[pool_index]);
+        if (mask) {
+          mask[top_offset + pool_index] = index;
+        } else if (top_mask) {
+          top_mask[top_offset + pool_index] = static_cast<Dtype>(index);
+        }
+      } else {
+        int hend = min(hstart + kernel_h_, height_ + pad_h_);
+        int wend = min(wstart + kernel_w_, width_ + pad_w_);
+        const int pool_size = (hend - hstart) * (wend - wstart);
+        hstart = max(hstart, 0);
+        wstart = max(wstart, 0);
+        hend = min(hend, height_);
+        wend = min(wend, width_);
+        Dtype sum = 0;
+        for (int h = hstart; h < hend; ++h) {
+          for (int w = wstart; w < wend; ++w) {
+            sum += bottom[h * width_ + w];
+          }
+        }
+        top[pool_index] = sum / pool_size;
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void PoolingLayer<Dtype>::backward_cpu_plane(const Dtype* top_diff,
+    const int* mask, const Dtype* top_mask, const Dtype* bottom_data,
+    Dtype* bottom_diff, int p) {
+  const int bottom_offset = p * height_ * width_;
+  const int top_offset = p * pooled_height_ * pooled_width_;
+  Dtype* bottom_plane_diff = bottom_diff + bottom_offset;
+  const Dtype* top_plane_diff = top_diff + top_offset;
+  caffe_set(height_ * width_, Dtype(0), bottom_plane_diff);
+  const bool is_max = this->layer_param_.pooling_param().pool() ==
+      PoolingParameter_PoolMethod_MAX;
+  for (int ph = 0; ph < pooled_height_; ++ph) {
+    for (int pw = 0; pw < pooled_width_; ++pw) {
+      const int index = ph * pooled_width_ + pw;
+      int hstart = ph * stride_h_ - pad_h_;
+      int wstart = pw * stride_w_ - pad_w_;
+      if (is_max) {
+        int bottom_index;
+        if (mask) {
+          bottom_index = mask[top_offset + index];
+        } else if (top_mask) {
+          bottom_index = top_mask[top_offset + index];
+        } else {
+          const int hend = min(hstart + kernel_h_, height_);
+          const int wend = min(wstart + kernel_w_, width_);
+          Dtype value;
+          bottom_index = window_argmax(bottom_data + bottom_offset, width_,
+              max(hstart, 0), hend, max(wstart, 0), wend, &value);
+        }
+        bottom_plane_diff[bottom_index] += top_plane_diff[index];
+      } else {
+        int hend = min(hstart + kernel_h_, height_ + pad_h_);
+        int wend = min(wstart + kernel_w_, width_ + pad_w_);
+        const int pool_size = (hend - hstart) * (wend - wstart);
+        hstart = max(hstart, 0);
+        wstart = max(wstart, 0);
+        hend = min(hend, height_);
+        wend = min(wend, width_);
+        for (int h = hstart; h < hend; ++h) {
+          for (int w = wstart; w < wend; ++w) {
+            bottom_plane_diff[h * width_ + w] +=
+                top_plane_diff[index] / pool_size;
+          }
+        }
+      }
+    }
+  }
+}
+
 template <typename Dtype>
 void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  Dtype* top_data = top[0]->mutable_cpu_data();
-  const int top_count = top[0]->count();
   // We'll output the mask to top[1] if it's of size >1.
-  const bool use_top_mask = top.size() > 1;
-  int* mask = NULL;  // suppress warnings about uninitalized variables
+  int* mask = NULL;
   Dtype* top_mask = NULL;
-  // Different pooling methods. We explicitly do the switch outside the for
-  // loop to save time, although this results in more code.
   switch (this->layer_param_.pooling_param().pool()) {
   case PoolingParameter_PoolMethod_MAX:
-    // Initialize
-    if (use_top_mask) {
+    if (top.size() > 1) {
       top_mask = top[1]->mutable_cpu_data();
-      caffe_set(top_count, Dtype(-1), top_mask);
-    } else {
+    } else if (!mask_free_) {
       mask = max_idx_.mutable_cpu_data();
-      caffe_set(top_count, -1, mask);
-    }
-    caffe_set(top_count, Dtype(-FLT_MAX), top_data);
-    // The main loop
-    for (int n = 0; n < bottom[0]->num(); ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        for (int ph = 0; ph < pooled_height_; ++ph) {
-          for (int pw = 0; pw < pooled_width_; ++pw) {
-            int hstart = ph * stride_h_ - pad_h_;
-            int wstart = pw * stride_w_ - pad_w_;
-            int hend = min(hstart + kernel_h_, height_);
-            int wend = min(wstart + kernel_w_, width_);
-            hstart = max(hstart, 0);
-            wstart = max(wstart, 0);
-            const int pool_index = ph * pooled_width_ + pw;
-            for (int h = hstart; h < hend; ++h) {
-              for (int w = wstart; w < wend; ++w) {
-                const int index = h * width_ + w;
-                if (bottom_data[index] > top_data[pool_index]) {
-                  top_data[pool_index] = bottom_data[index];
-                  if (use_top_mask) {
-                    top_mask[pool_index] = static_cast<Dtype>(index);
-                  } else {
-                    mask[pool_index] = index;
-                  }
-                }
-              }
-            }
-          }
-        }
-        // compute offset
-        bottom_data += bottom[0]->offset(0, 1);
-        top_data += top[0]->offset(0, 1);
-        if (use_top_mask) {
-          top_mask += top[0]->offset(0, 1);
-        } else {
-          mask += top[0]->offset(0, 1);
-        }
-      }
     }
     break;
   case PoolingParameter_PoolMethod_AVE:
-    for (int i = 0; i < top_count; ++i) {
-      top_data[i] = 0;
-    }
-    // The main loop
-    for (int n = 0; n < bottom[0]->num(); ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        for (int ph = 0; ph < pooled_height_; ++ph) {
-          for (int pw = 0; pw < pooled_width_; ++pw) {
-            int hstart = ph * stride_h_ - pad_h_;
-            int wstart = pw * stride_w_ - pad_w_;
-            int hend = min(hstart + kernel_h_, height_ + pad_h_);
-            int wend = min(wstart + kernel_w_, width_ + pad_w_);
-            int pool_size = (hend - hstart) * (wend - wstart);
-            hstart = max(hstart, 0);
-            wstart = max(wstart, 0);
-            hend = min(hend, height_);
-            wend = min(wend, width_);
-            for (int h = hstart; h < hend; ++h) {
-              for (int w = wstart; w < wend; ++w) {
-                top_data[ph * pooled_width_ + pw] +=
-                    bottom_data[h * width_ + w];
-              }
-            }
-            top_data[ph * pooled_width_ + pw] /= pool_size;
-          }
-        }
-        // compute offset
-        bottom_data += bottom[0]->offset(0, 1);
-        top_data += top[0]->offset(0, 1);
-      }
-    }
     break;
   case PoolingParameter_PoolMethod_STOCHASTIC:
     NOT_IMPLEMENTED;
@@ -227,6 +373,9 @@ void PoolingLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   default:
     LOG(FATAL) << "Unknown pooling method.";
   }
+  cpu_for_each_plane(bottom[0]->num() * channels_, boost::bind(
+      &PoolingLayer<Dtype>::forward_cpu_plane, this, bottom[0]->cpu_data(),
+      top[0]->mutable_cpu_data(), mask, top_mask, _1));
 }
 
 template <typename Dtype>
@@ -235,71 +384,20 @@ void PoolingLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   if (!propagate_down[0]) {
     return;
   }
-  const Dtype* top_diff = top[0]->cpu_diff();
-  Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
-  // Different pooling methods. We explicitly do the switch outside the for
-  // loop to save time, although this results in more codes.
-  caffe_set(bottom[0]->count(), Dtype(0), bottom_diff);
-  // We'll output the mask to top[1] if it's of size >1.
-  const bool use_top_mask = top.size() > 1;
-  const int* mask = NULL;  // suppress warnings about uninitialized variables
+  const int* mask = NULL;
   const Dtype* top_mask = NULL;
+  const Dtype* bottom_data = NULL;
   switch (this->layer_param_.pooling_param().pool()) {
   case PoolingParameter_PoolMethod_MAX:
-    // The main loop
-    if (use_top_mask) {
+    if (top.size() > 1) {
       top_mask = top[1]->cpu_data();
+    } else if (mask_free_) {
+      bottom_data = bottom[0]->cpu_data();
     } else {
       mask = max_idx_.cpu_data();
     }
-    for (int n = 0; n < top[0]->num(); ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        for (int ph = 0; ph < pooled_height_; ++ph) {
-          for (int pw = 0; pw < pooled_width_; ++pw) {
-            const int index = ph * pooled_width_ + pw;
-            const int bottom_index =
-                use_top_mask ? top_mask[index] : mask[index];
-            bottom_diff[bottom_index] += top_diff[index];
-          }
-        }
-        bottom_diff += bottom[0]->offset(0, 1);
-        top_diff += top[0]->offset(0, 1);
-        if (use_top_mask) {
-          top_mask += top[0]->offset(0, 1);
-        } else {
-          mask += top[0]->offset(0, 1);
-        }
-      }
-    }
     break;
   case PoolingParameter_PoolMethod_AVE:
-    // The main loop
-    for (int n = 0; n < top[0]->num(); ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        for (int ph = 0; ph < pooled_height_; ++ph) {
-          for (int pw = 0; pw < pooled_width_; ++pw) {
-            int hstart = ph * stride_h_ - pad_h_;
-            int wstart = pw * stride_w_ - pad_w_;
-            int hend = min(hstart + kernel_h_, height_ + pad_h_);
-            int wend = min(wstart + kernel_w_, width_ + pad_w_);
-            int pool_size = (hend - hstart) * (wend - wstart);
-            hstart = max(hstart, 0);
-            wstart = max(wstart, 0);
-            hend = min(hend, height_);
-            wend = min(wend, width_);
-            for (int h = hstart; h < hend; ++h) {
-              for (int w = wstart; w < wend; ++w) {
-                bottom_diff[h * width_ + w] +=
-                  top_diff[ph * pooled_width_ + pw] / pool_size;
-              }
-            }
-          }
-        }
-        // offset
-        bottom_diff += bottom[0]->offset(0, 1);
-        top_diff += top[0]->offset(0, 1);
-      }
-    }
     break;
   case PoolingParameter_PoolMethod_STOCHASTIC:
     NOT_IMPLEMENTED;
@@ -307,6 +405,9 @@ void PoolingLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   default:
     LOG(FATAL) << "Unknown pooling method.";
   }
+  cpu_for_each_plane(top[0]->num() * channels_, boost::bind(
+      &PoolingLayer<Dtype>::backward_cpu_plane, this, top[0]->cpu_diff(),
+      mask, top_mask, bottom_data, bottom[0]->mutable_cpu_diff(), _1));
 }
 
 
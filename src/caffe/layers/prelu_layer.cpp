@@ -15,15 +15,14 @@ void PReLULayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   PReLUParameter prelu_param = this->layer_param().prelu_param();
   int channels = bottom[0]->channels();
   channel_shared_ = prelu_param.channel_shared();
+  const vector<int> slope_shape(channel_shared_ ? 0 : 1, channels);
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
+    CHECK_EQ(1, this->blobs_.size()) << "Incorrect number of weight blobs.";
+    this->CheckParamShape(0, slope_shape);
   } else {
     this->blobs_.resize(1);
-    if (channel_shared_) {
-      this->blobs_[0].reset(new Blob<Dtype>(vector<int>(0)));
-    } else {
-      this->blobs_[0].reset(new Blob<Dtype>(vector<int>(1, channels)));
-    }
+    this->blobs_[0].reset(new Blob<Dtype>(slope_shape));
     shared_ptr<Filler<Dtype> > filler;
     if (prelu_param.has_filler()) {
       filler.reset(GetFiller<Dtype>(prelu_param.filler()));
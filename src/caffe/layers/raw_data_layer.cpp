@@ -0,0 +1,156 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "caffe/data_layers.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/rng.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Converts one CHW sample to Dtype, computing (x - mean[c]) * scale.
+template <typename Dtype, typename SrcType>
+void ConvertSample(const SrcType* src, const int channels, const int dim,
+    const Dtype* mean, const Dtype scale, Dtype* dst) {
+  for (int c = 0; c < channels; ++c) {
+    const Dtype channel_mean = mean[c];
+    for (int i = 0; i < dim; ++i) {
+      dst[i] = (static_cast<Dtype>(src[i]) - channel_mean) * scale;
+    }
+    src += dim;
+    dst += dim;
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+RawDataLayer<Dtype>::~RawDataLayer<Dtype>() {
+  this->JoinPrefetchThread();
+}
+
+template <typename Dtype>
+void RawDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+  const RawDataParameter& raw_data_param = this->layer_param_.raw_data_param();
+  const TransformationParameter& transform_param = this->transform_param_;
+  CHECK(!transform_param.mirror() && !transform_param.crop_size() &&
+      !transform_param.has_mean_file() && !transform_param.rotate() &&
+      !transform_param.contrast_adjustment() &&
+      transform_param.eigen_value_size() == 0)
+      << this->type() << " only supports the scale and mean_value "
+      << "transformations";
+  LOG(INFO) << "Opening raw dataset " << raw_data_param.source();
+  dataset_.Open(raw_data_param.source());
+  CHECK_GT(dataset_.num(), 0) << "The raw dataset is empty";
+  LOG(INFO) << "A total of " << dataset_.num() << " samples.";
+
+  const int channels = dataset_.channels();
+  mean_values_.assign(channels, Dtype(0));
+  if (transform_param.mean_value_size() > 0) {
+    CHECK(transform_param.mean_value_size() == 1 ||
+        transform_param.mean_value_size() == channels) <<
+        "Specify either 1 mean_value or as many as channels: " << channels;
+    for (int c = 0; c < channels; ++c) {
+      mean_values_[c] = transform_param.mean_value(
+          transform_param.mean_value_size() == 1 ? 0 : c);
+    }
+  }
+
+  order_.resize(dataset_.num());
+  for (int i = 0; i < order_.size(); ++i) {
+    order_[i] = i;
+  }
+  if (raw_data_param.shuffle()) {
+    const unsigned int prefetch_rng_seed = caffe_rng_rand();
+    prefetch_rng_.reset(new Caffe::RNG(prefetch_rng_seed));
+    ShuffleSamples();
+  }
+  order_id_ = 0;
+  // Check if we would need to randomly skip a few data points
+  if (raw_data_param.rand_skip()) {
+    unsigned int skip = caffe_rng_rand() % raw_data_param.rand_skip();
+    LOG(INFO) << "Skipping first " << skip << " data points.";
+    CHECK_GT(order_.size(), skip) << "Not enough points to skip";
+    order_id_ = skip;
+  }
+
+  const int batch_size = raw_data_param.batch_size();
+  CHECK_GT(batch_size, 0) << "batch_size must be positive";
+  top[0]->Reshape(batch_size, channels, dataset_.height(), dataset_.width());
+  LOG(INFO) << "output data size: " << top[0]->num() << ","
+      << top[0]->channels() << "," << top[0]->height() << ","
+      << top[0]->width();
+  if (this->output_labels_) {
+    vector<int> label_shape(1, batch_size);
+    top[1]->Reshape(label_shape);
+  }
+}
+
+template <typename Dtype>
+void RawDataLayer<Dtype>::ShuffleSamples() {
+  caffe::rng_t* prefetch_rng =
+      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
+  shuffle(order_.begin(), order_.end(), prefetch_rng);
+}
+
+// This function is called on prefetch thread
+template <typename Dtype>
+void RawDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
+  CPUTimer batch_timer;
+  batch_timer.Start();
+  const int batch_size = this->layer_param_.raw_data_param().batch_size();
+  const int channels = dataset_.channels();
+  const int dim = dataset_.height() * dataset_.width();
+  const int sample_count = dataset_.sample_count();
+  const Dtype scale = this->transform_param_.scale();
+  const bool is_float = dataset_.data_type() == RawDatasetHeader::FLOAT32;
+  // Samples that need no conversion are copied as they are.
+  bool is_identity = is_float && sizeof(Dtype) == sizeof(float) &&
+      scale == Dtype(1);
+  for (int c = 0; c < channels; ++c) {
+    is_identity = is_identity && mean_values_[c] == Dtype(0);
+  }
+
+  Dtype* prefetch_data = batch->data_.mutable_cpu_data();
+  Dtype* prefetch_label = this->output_labels_ ?
+      batch->label_.mutable_cpu_data() : NULL;
+  for (int item_id = 0; item_id < batch_size; ++item_id) {
+    const int sample = order_[order_id_];
+    const void* record = dataset_.record(sample);
+    Dtype* item_data = prefetch_data + item_id * sample_count;
+    if (is_identity) {
+      memcpy(item_data, record, sample_count * sizeof(Dtype));
+    } else if (is_float) {
+      ConvertSample(static_cast<const float*>(record), channels, dim,
+          &mean_values_[0], scale, item_data);
+    } else {
+      ConvertSample(static_cast<const uint8_t*>(record), channels, dim,
+          &mean_values_[0], scale, item_data);
+    }
+    if (this->output_labels_) {
+      prefetch_label[item_id] = dataset_.label(sample);
+    }
+    // go to the next sample
+    ++order_id_;
+    if (order_id_ >= order_.size()) {
+      // We have reached the end. Restart from the first.
+      DLOG(INFO) << "Restarting data prefetching from start.";
+      order_id_ = 0;
+      if (this->layer_param_.raw_data_param().shuffle()) {
+        ShuffleSamples();
+      }
+    }
+  }
+  batch_timer.Stop();
+  DLOG(INFO) << "Prefetch batch: " << batch_timer.MilliSeconds() << " ms.";
+}
+
+INSTANTIATE_CLASS(RawDataLayer);
+REGISTER_LAYER_CLASS(RawData);
+
+}  // namespace caffe
@@ -3,23 +3,25 @@
 #include <vector>
 
 #include "caffe/layer.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
 
-template <typename Dtype>
-inline Dtype sigmoid(Dtype x) {
-  return 1. / (1. + exp(-x));
-}
-
 template <typename Dtype>
 void SigmoidLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
+  // sigmoid(x) = 1 / (1 + exp(-x)), with the exponentials taken together;
+  // vsExp rejects an empty batch.
+  if (count > 0) {
+    caffe_cpu_scale(count, Dtype(-1), bottom_data, top_data);
+    caffe_exp(count, top_data, top_data);
+  }
   for (int i = 0; i < count; ++i) {
-    top_data[i] = sigmoid(bottom_data[i]);
+    top_data[i] = 1. / (1. + top_data[i]);
   }
 }
 
@@ -5,6 +5,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/layer_factory.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/softmax.hpp"
 #include "caffe/vision_layers.hpp"
 
 namespace caffe {
@@ -15,6 +16,9 @@ void SoftmaxWithLossLayer<Dtype>::LayerSetUp(
   LossLayer<Dtype>::LayerSetUp(bottom, top);
   LayerParameter softmax_param(this->layer_param_);
   softmax_param.set_type("Softmax");
+  // The internal layer only runs in GPU mode; this layer computes the
+  // softmax itself in CPU mode.
+  softmax_param.mutable_softmax_param()->set_num_threads(1);
   softmax_layer_ = LayerRegistry<Dtype>::CreateLayer(softmax_param);
   softmax_bottom_vec_.clear();
   softmax_bottom_vec_.push_back(bottom[0]);
@@ -28,6 +32,11 @@ void SoftmaxWithLossLayer<Dtype>::LayerSetUp(
     ignore_label_ = this->layer_param_.loss_param().ignore_label();
   }
   normalize_ = this->layer_param_.loss_param().normalize();
+  const int num_threads = this->layer_param_.softmax_param().num_threads();
+  CHECK_GT(num_threads, 0) << "num_threads must be positive.";
+  if (num_threads > 1) {
+    thread_pool_.reset(new ThreadPool(num_threads));
+  }
 }
 
 template <typename Dtype>
@@ -44,6 +53,7 @@ void SoftmaxWithLossLayer<Dtype>::Reshape(
       << "e.g., if softmax axis == 1 and prediction shape is (N, C, H, W), "
       << "label count (number of labels) must be N*H*W, "
       << "with integer values in {0, 1, ..., C-1}.";
+  log_norm_.Reshape(vector<int>(1, outer_num_ * inner_num_));
   if (top.size() >= 2) {
     // softmax output
     top[1]->ReshapeLike(*bottom[0]);
@@ -53,10 +63,16 @@ void SoftmaxWithLossLayer<Dtype>::Reshape(
 template <typename Dtype>
 void SoftmaxWithLossLayer<Dtype>::Forward_cpu(
     const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  // The forward pass computes the softmax prob values.
-  softmax_layer_->Forward(softmax_bottom_vec_, softmax_top_vec_);
-  const Dtype* prob_data = prob_.cpu_data();
+  // The forward pass computes the softmax prob values, and the log of their
+  // normalizers from which the log-probabilities follow.
+  const Dtype* bottom_data = bottom[0]->cpu_data();
+  caffe_cpu_softmax(outer_num_, bottom[0]->shape(softmax_axis_), inner_num_,
+      bottom_data, prob_.mutable_cpu_data(), log_norm_.mutable_cpu_data(),
+      thread_pool_.get());
+  const Dtype* log_norm = log_norm_.cpu_data();
   const Dtype* label = bottom[1]->cpu_data();
+  // The probabilities are clipped at FLT_MIN.
+  const Dtype min_log_prob = log(Dtype(FLT_MIN));
   int dim = prob_.count() / outer_num_;
   int count = 0;
   Dtype loss = 0;
@@ -68,8 +84,8 @@ void SoftmaxWithLossLayer<Dtype>::Forward_cpu(
       }
       DCHECK_GE(label_value, 0);
       DCHECK_LT(label_value, prob_.shape(softmax_axis_));
-      loss -= log(std::max(prob_data[i * dim + label_value * inner_num_ + j],
-                           Dtype(FLT_MIN)));
+      loss -= std::max(bottom_data[i * dim + label_value * inner_num_ + j] -
+          log_norm[i * inner_num_ + j], min_log_prob);
       ++count;
     }
   }
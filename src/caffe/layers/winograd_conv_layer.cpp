@@ -0,0 +1,180 @@
+#include <boost/bind.hpp>
+
+#include <vector>
+
+#include "caffe/layer.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/winograd.hpp"
+#include "caffe/vision_layers.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::LayerSetUp(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  BaseConvolutionLayer<Dtype>::LayerSetUp(bottom, top);
+  this->use_direct_ = false;
+  // Int8 weights would be widened back to read them as Dtype filters.
+  CHECK(!this->quantized_)
+      << "The WINOGRAD engine does not run quantized; use engine CAFFE.";
+  CHECK(this->kernel_h_ == 3 && this->kernel_w_ == 3)
+      << "The WINOGRAD engine only supports 3x3 filters.";
+  CHECK(this->stride_h_ == 1 && this->stride_w_ == 1)
+      << "The WINOGRAD engine only supports stride 1.";
+  // Backward convolves the top diff with padding 2 - pad.
+  CHECK(this->pad_h_ <= 2 && this->pad_w_ <= 2)
+      << "The WINOGRAD engine only supports padding up to 2.";
+  tile_ = this->layer_param_.convolution_param().winograd_tile();
+  LOG(INFO) << "Using Winograd F(" << tile_ << "x" << tile_
+      << ",3x3) convolution in CPU mode";
+  forward_filters_.reset();
+  backward_filters_.reset();
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Reshape(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::Reshape(bottom, top);
+  const int block = winograd_block_size(tile_);
+  const int num_tiles = winograd_num_tiles(tile_, this->height_out_,
+      this->width_out_);
+  vector<int> blocks_shape(1, block * block);
+  blocks_shape.push_back(this->channels_);
+  blocks_shape.push_back(num_tiles);
+  input_blocks_.Reshape(blocks_shape);
+  blocks_shape[1] = this->num_output_;
+  output_blocks_.Reshape(blocks_shape);
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::TransformFilters(bool backward) {
+  const size_t version = this->blobs_[0]->data_version();
+  if (!backward && (!forward_filters_ || forward_filters_version_ != version)) {
+    forward_filters_ = this->param_cache()->Get("winograd_forward", version,
+        boost::bind(&WinogradConvolutionLayer<Dtype>::ComputeForwardFilters,
+        this, _1));
+    forward_filters_version_ = version;
+  }
+  if (backward &&
+      (!backward_filters_ || backward_filters_version_ != version)) {
+    backward_filters_ = this->param_cache()->Get("winograd_backward", version,
+        boost::bind(&WinogradConvolutionLayer<Dtype>::ComputeBackwardFilters,
+        this, _1));
+    backward_filters_version_ = version;
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::ComputeForwardFilters(
+    Blob<Dtype>* filters) {
+  const int block = winograd_block_size(tile_);
+  vector<int> filters_shape(1, block * block);
+  filters_shape.push_back(this->num_output_);
+  filters_shape.push_back(this->channels_ / this->group_);
+  filters->Reshape(filters_shape);
+  winograd_transform_filters_cpu(tile_, this->num_output_,
+      this->channels_ / this->group_, this->blobs_[0]->cpu_data(),
+      filters->mutable_cpu_data());
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::ComputeBackwardFilters(
+    Blob<Dtype>* filters) {
+  const int channels_per_group = this->channels_ / this->group_;
+  const int outputs_per_group = this->num_output_ / this->group_;
+  // Backward convolves with the filters rotated by 180 degrees, and with
+  // the roles of the input and output channels of each group swapped.
+  Blob<Dtype> flipped(this->channels_, outputs_per_group, 3, 3);
+  const Dtype* weight = this->blobs_[0]->cpu_data();
+  Dtype* flipped_data = flipped.mutable_cpu_data();
+  for (int o = 0; o < this->num_output_; ++o) {
+    const int g = o / outputs_per_group;
+    for (int c = 0; c < channels_per_group; ++c) {
+      const Dtype* filter = weight + (o * channels_per_group + c) * 9;
+      Dtype* flipped_filter = flipped_data + ((g * channels_per_group + c) *
+          outputs_per_group + o % outputs_per_group) * 9;
+      for (int k = 0; k < 9; ++k) {
+        flipped_filter[k] = filter[8 - k];
+      }
+    }
+  }
+  const int block = winograd_block_size(tile_);
+  vector<int> filters_shape(1, block * block);
+  filters_shape.push_back(this->channels_);
+  filters_shape.push_back(outputs_per_group);
+  filters->Reshape(filters_shape);
+  winograd_transform_filters_cpu(tile_, this->channels_, outputs_per_group,
+      flipped.cpu_data(), filters->mutable_cpu_data());
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  TransformFilters(false);
+  const Dtype* filters = forward_filters_->cpu_data();
+  Dtype* input_blocks = input_blocks_.mutable_cpu_data();
+  Dtype* output_blocks = output_blocks_.mutable_cpu_data();
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      winograd_conv_cpu(tile_, bottom_data + n * this->bottom_dim_,
+          this->channels_, this->height_, this->width_, this->num_output_,
+          this->group_, this->pad_h_, this->pad_w_, filters, input_blocks,
+          output_blocks, top_data + n * this->top_dim_);
+      if (this->bias_term_) {
+        const Dtype* bias = this->blobs_[1]->cpu_data();
+        this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Backward_cpu(
+    const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down,
+    const vector<Blob<Dtype>*>& bottom) {
+  // Gradients w.r.t. the weights and biases, if necessary.
+  ConvolutionLayer<Dtype>::Backward_cpu(top,
+      vector<bool>(propagate_down.size(), false), bottom);
+  bool propagate_any = false;
+  for (int i = 0; i < propagate_down.size(); ++i) {
+    propagate_any = propagate_any || propagate_down[i];
+  }
+  if (!propagate_any) {
+    return;
+  }
+  // Gradient w.r.t. bottom data: the top diff convolved with the flipped
+  // filters, padded so that it comes out the size of the bottom.
+  TransformFilters(true);
+  const int block = winograd_block_size(tile_);
+  const int num_tiles = winograd_num_tiles(tile_, this->height_,
+      this->width_);
+  vector<int> blocks_shape(1, block * block);
+  blocks_shape.push_back(this->num_output_);
+  blocks_shape.push_back(num_tiles);
+  input_blocks_.Reshape(blocks_shape);
+  blocks_shape[1] = this->channels_;
+  output_blocks_.Reshape(blocks_shape);
+  const Dtype* filters = backward_filters_->cpu_data();
+  Dtype* input_blocks = input_blocks_.mutable_cpu_data();
+  Dtype* output_blocks = output_blocks_.mutable_cpu_data();
+  for (int i = 0; i < top.size(); ++i) {
+    if (!propagate_down[i]) {
+      continue;
+    }
+    const Dtype* top_diff = top[i]->cpu_diff();
+    Dtype* bottom_diff = bottom[i]->mutable_cpu_diff();
+    for (int n = 0; n < this->num_; ++n) {
+      winograd_conv_cpu(tile_, top_diff + n * this->top_dim_,
+          this->num_output_, this->height_out_, this->width_out_,
+          this->channels_, this->group_, 2 - this->pad_h_, 2 - this->pad_w_,
+          filters, input_blocks, output_blocks,
+          bottom_diff + n * this->bottom_dim_);
+    }
+  }
+}
+
+INSTANTIATE_CLASS(WinogradConvolutionLayer);
+
+}  // namespace caffe
@@ -9,6 +9,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/net.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/fuse_layers.hpp"
 #include "caffe/util/insert_splits.hpp"
 #include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
@@ -31,6 +32,14 @@ Net<Dtype>::Net(const string& param_file, Phase phase) {
   Init(param);
 }
 
+template <typename Dtype>
+Net<Dtype>::Net(const NetParameter& param,
+    const shared_ptr<const NetWeights<Dtype> >& weights)
+    : shared_weights_(weights) {
+  CHECK(weights) << "Shared weights must not be null";
+  Init(param);
+}
+
 template <typename Dtype>
 void Net<Dtype>::Init(const NetParameter& in_param) {
   // Set phase from the state.
@@ -41,9 +50,21 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   FilterNet(in_param, &filtered_param);
   LOG(INFO) << "Initializing net from parameters: " << std::endl
             << filtered_param.DebugString();
-  // Create a copy of filtered_param with splits added where necessary.
+  // Fold activations into the layers that compute their inputs, for TEST
+  // nets that ask for it and never run Backward.
+  NetParameter fused_param;
+  if (filtered_param.fuse_layers() && phase_ == TEST &&
+      !filtered_param.force_backward()) {
+    FuseLayers(filtered_param, &fused_param);
+  } else {
+    if (filtered_param.fuse_layers()) {
+      LOG(WARNING) << "fuse_layers is ignored for nets that may run Backward";
+    }
+    fused_param.CopyFrom(filtered_param);
+  }
+  // Create a copy of fused_param with splits added where necessary.
   NetParameter param;
-  InsertSplits(filtered_param, &param);
+  InsertSplits(fused_param, &param);
   // Basically, build all the layers and set up their connections.
   name_ = param.name();
   map<string, int> blob_name_to_idx;
@@ -87,6 +108,17 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     }
     layers_.push_back(LayerRegistry<Dtype>::CreateLayer(layer_param));
     layer_names_.push_back(layer_param.name());
+    // Layers given their parameters skip filling their own in SetUp, and
+    // check their shapes instead (see Layer::CheckParamShape).
+    if (shared_weights_) {
+      const vector<shared_ptr<Blob<Dtype> > >* shared_blobs =
+          shared_weights_->layer_blobs(layer_param.name());
+      if (shared_blobs) {
+        layers_[layer_id]->blobs() = *shared_blobs;
+        layers_[layer_id]->set_param_cache(
+            shared_weights_->layer_param_cache(layer_param.name()));
+      }
+    }
     LOG(INFO) << "Creating Layer " << layer_param.name();
     bool need_backward = false;
 
@@ -246,6 +278,151 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   debug_info_ = param.debug_info();
   LOG(INFO) << "Network initialization done.";
   LOG(INFO) << "Memory required for data: " << memory_used_ * sizeof(Dtype);
+  size_t separate_workspace_size = 0;
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    separate_workspace_size += layers_[layer_id]->workspace_size();
+  }
+  LOG(INFO) << "Memory required for workspace: " << SetUpWorkspace()
+      << " (instead of " << separate_workspace_size << ")";
+  activation_memory_shared_ = false;
+  if (param.share_activation_memory()) {
+    if (phase_ == TEST && !param.force_backward()) {
+      LOG(INFO) << "Memory required for data after sharing activations: "
+          << ShareActivationMemory();
+      activation_memory_shared_ = true;
+    } else {
+      LOG(WARNING) << "share_activation_memory is ignored for nets that "
+          << "may run Backward";
+    }
+  }
+}
+
+namespace {
+
+int FindAliasRoot(vector<int>* alias, int blob_id) {
+  while ((*alias)[blob_id] != blob_id) {
+    blob_id = (*alias)[blob_id] = (*alias)[(*alias)[blob_id]];
+  }
+  return blob_id;
+}
+
+}  // namespace
+
+template <typename Dtype>
+size_t Net<Dtype>::ShareActivationMemory() {
+  const int num_blobs = blobs_.size();
+  // Group the blobs that share memory anyway (the tops of Split, Reshape,
+  // Flatten...) with their bottom: a group is live from its first producer
+  // to its last consumer, and is only planned if every member can be.
+  vector<int> alias(num_blobs);
+  vector<int> birth(num_blobs, -1);
+  vector<int> death(num_blobs, -1);
+  vector<bool> plannable(num_blobs, true);
+  for (int i = 0; i < num_blobs; ++i) {
+    alias[i] = i;
+    plannable[i] = blobs_[i]->count() > 0;
+  }
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    plannable[net_input_blob_indices_[i]] = false;
+  }
+  for (int i = 0; i < net_output_blob_indices_.size(); ++i) {
+    plannable[net_output_blob_indices_[i]] = false;
+  }
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    const vector<int>& bottom_ids = bottom_id_vecs_[layer_id];
+    const vector<int>& top_ids = top_id_vecs_[layer_id];
+    for (int i = 0; i < bottom_ids.size(); ++i) {
+      death[bottom_ids[i]] = layer_id;
+    }
+    for (int i = 0; i < top_ids.size(); ++i) {
+      const int top_id = top_ids[i];
+      if (birth[top_id] < 0) {
+        birth[top_id] = layer_id;
+      }
+      death[top_id] = std::max(death[top_id], layer_id);
+      // Data layers may point their tops at memory they own.
+      if (bottom_ids.empty()) {
+        plannable[top_id] = false;
+      }
+      if (layers_[layer_id]->TopsShareBottomData()) {
+        for (int j = 0; j < bottom_ids.size(); ++j) {
+          alias[FindAliasRoot(&alias, top_id)] =
+              FindAliasRoot(&alias, bottom_ids[j]);
+        }
+      }
+    }
+  }
+  vector<int> group_birth(num_blobs, -1);
+  vector<int> group_death(num_blobs, -1);
+  vector<size_t> group_size(num_blobs, 0);
+  vector<bool> group_plannable(num_blobs, true);
+  for (int i = 0; i < num_blobs; ++i) {
+    const int root = FindAliasRoot(&alias, i);
+    if (group_birth[root] < 0 || birth[i] < group_birth[root]) {
+      group_birth[root] = birth[i];
+    }
+    group_death[root] = std::max(group_death[root], death[i]);
+    group_size[root] = std::max(group_size[root],
+        blobs_[i]->count() * sizeof(Dtype));
+    group_plannable[root] = group_plannable[root] && plannable[i];
+  }
+  // Greedily assign the groups, in order of birth, to the best fitting
+  // buffer whose last user has already run.
+  vector<pair<int, int> > groups;
+  for (int i = 0; i < num_blobs; ++i) {
+    if (FindAliasRoot(&alias, i) == i && group_plannable[i]) {
+      groups.push_back(std::make_pair(group_birth[i], i));
+    }
+  }
+  std::sort(groups.begin(), groups.end());
+  vector<size_t> buffer_size;
+  vector<int> buffer_free_after;
+  vector<int> group_buffer(num_blobs, -1);
+  for (int g = 0; g < groups.size(); ++g) {
+    const int root = groups[g].second;
+    // Prefer the smallest free buffer that fits, else grow the largest one.
+    int best_fit = -1;
+    int largest = -1;
+    for (int b = 0; b < buffer_size.size(); ++b) {
+      if (buffer_free_after[b] >= group_birth[root]) {
+        continue;
+      }
+      if (buffer_size[b] >= group_size[root] &&
+          (best_fit < 0 || buffer_size[b] < buffer_size[best_fit])) {
+        best_fit = b;
+      }
+      if (largest < 0 || buffer_size[b] > buffer_size[largest]) {
+        largest = b;
+      }
+    }
+    int best = best_fit >= 0 ? best_fit : largest;
+    if (best < 0) {
+      best = buffer_size.size();
+      buffer_size.push_back(0);
+      buffer_free_after.push_back(-1);
+    }
+    buffer_size[best] = std::max(buffer_size[best], group_size[root]);
+    buffer_free_after[best] = group_death[root];
+    group_buffer[root] = best;
+  }
+  vector<shared_ptr<SyncedMemory> > buffers(buffer_size.size());
+  size_t shared_memory_used = 0;
+  for (int b = 0; b < buffers.size(); ++b) {
+    buffers[b].reset(new SyncedMemory(buffer_size[b]));
+    shared_memory_used += buffer_size[b];
+  }
+  size_t private_memory_used = 0;
+  for (int i = 0; i < num_blobs; ++i) {
+    const int buffer = group_buffer[FindAliasRoot(&alias, i)];
+    if (buffer >= 0) {
+      blobs_[i]->ShareDataMemory(buffers[buffer]);
+      DLOG(INFO) << "Blob " << blob_names_[i] << " uses shared buffer "
+          << buffer;
+    } else if (FindAliasRoot(&alias, i) == i) {
+      private_memory_used += blobs_[i]->count() * sizeof(Dtype);
+    }
+  }
+  return shared_memory_used + private_memory_used;
 }
 
 template <typename Dtype>
@@ -497,6 +674,7 @@ template <typename Dtype>
 Dtype Net<Dtype>::ForwardFromTo(int start, int end) {
   CHECK_GE(start, 0);
   CHECK_LT(end, layers_.size());
+  Caffe::ContextScope context_scope(context_.get());
   Dtype loss = 0;
   if (debug_info_) {
     for (int i = 0; i < net_input_blobs_.size(); ++i) {
@@ -567,6 +745,7 @@ template <typename Dtype>
 void Net<Dtype>::BackwardFromTo(int start, int end) {
   CHECK_GE(end, 0);
   CHECK_LT(start, layers_.size());
+  Caffe::ContextScope context_scope(context_.get());
   for (int i = start; i >= end; --i) {
     if (layer_need_backward_[i]) {
       layers_[i]->Backward(
@@ -713,9 +892,59 @@ void Net<Dtype>::Backward() {
 
 template <typename Dtype>
 void Net<Dtype>::Reshape() {
+  Caffe::ContextScope context_scope(context_.get());
   for (int i = 0; i < layers_.size(); ++i) {
     layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
   }
+  SetUpWorkspace();
+}
+
+template <typename Dtype>
+void Net<Dtype>::Reserve(const vector<vector<int> >& max_input_shapes) {
+  // The Forward below would take a batch from the data layers of a net fed
+  // by them.
+  CHECK(!net_input_blobs_.empty())
+      << "Reserve is for nets that take their inputs through input blobs.";
+  CHECK_EQ(max_input_shapes.size(), net_input_blobs_.size())
+      << "Give a shape for every input blob.";
+  vector<vector<int> > input_shapes(net_input_blobs_.size());
+  for (int i = 0; i < net_input_blobs_.size(); ++i) {
+    Blob<Dtype>* input = net_input_blobs_[i];
+    input_shapes[i] = input->shape();
+    input->Reshape(max_input_shapes[i]);
+    caffe_set(input->count(), Dtype(0), input->mutable_cpu_data());
+  }
+  Reshape();
+  if (activation_memory_shared_) {
+    // The blobs that outgrew the shared buffers moved out of them.
+    LOG(INFO) << "Memory required for data after sharing activations: "
+        << ShareActivationMemory();
+  }
+  ForwardPrefilled();
+  for (int i = 0; i < net_input_blobs_.size(); ++i) {
+    net_input_blobs_[i]->Reshape(input_shapes[i]);
+  }
+  Reshape();
+}
+
+template <typename Dtype>
+size_t Net<Dtype>::SetUpWorkspace() {
+  size_t workspace_size = 0;
+  for (int i = 0; i < layers_.size(); ++i) {
+    workspace_size = std::max(workspace_size, layers_[i]->workspace_size());
+  }
+  if (workspace_size == 0) {
+    return 0;
+  }
+  if (!workspace_ || workspace_->size() < workspace_size) {
+    workspace_.reset(new SyncedMemory(workspace_size));
+  }
+  for (int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i]->workspace_size() > 0) {
+      layers_[i]->SetWorkspace(workspace_);
+    }
+  }
+  return workspace_->size();
 }
 
 template <typename Dtype>
@@ -745,8 +974,81 @@ void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
   }
 }
 
+namespace {
+
+// Points the blob at the mapped floats, or copies them for other types.
+void SetMappedData(float* data, Blob<float>* blob) {
+  blob->set_cpu_data(data);
+}
+
+void SetMappedData(float* data, Blob<double>* blob) {
+  // Copied through a blob of its own, which a blob kept in fp16 or int8
+  // narrows.
+  Blob<double> widened(blob->shape());
+  double* widened_data = widened.mutable_cpu_data();
+  for (int i = 0; i < blob->count(); ++i) {
+    widened_data[i] = data[i];
+  }
+  blob->CopyFrom(widened);
+}
+
+}  // namespace
+
+template <typename Dtype>
+void Net<Dtype>::MapTrainedLayersFrom(const string& filename) {
+  shared_ptr<MappedWeights> mapped_weights(new MappedWeights());
+  mapped_weights->Open(filename);
+  const NetParameter& index = mapped_weights->index();
+  for (int i = 0; i < index.layer_size(); ++i) {
+    const LayerParameter& source_layer = index.layer(i);
+    const string& source_layer_name = source_layer.name();
+    if (!layer_names_index_.count(source_layer_name)) {
+      DLOG(INFO) << "Ignoring source layer " << source_layer_name;
+      continue;
+    }
+    DLOG(INFO) << "Mapping source layer " << source_layer_name;
+    vector<shared_ptr<Blob<Dtype> > >& target_blobs =
+        layers_[layer_names_index_[source_layer_name]]->blobs();
+    CHECK_EQ(target_blobs.size(), source_layer.blobs_size())
+        << "Incompatible number of blobs for layer " << source_layer_name;
+    for (int j = 0; j < target_blobs.size(); ++j) {
+      CHECK(target_blobs[j]->ShapeEquals(source_layer.blobs(j)))
+          << "shape mismatch for layer " << source_layer_name;
+      SetMappedData(mapped_weights->data(i, j), target_blobs[j].get());
+    }
+  }
+  // Only the new mapping is kept: parameters that still point into the last
+  // one get memory of their own, shared as before.
+  if (mapped_weights_) {
+    map<const SyncedMemory*, shared_ptr<SyncedMemory> > copies;
+    for (int i = 0; i < params_.size(); ++i) {
+      Blob<Dtype>* param = params_[i].get();
+      // Narrowed weights no longer point anywhere; keep them narrow.
+      if (param->cpu_half_data() || param->cpu_int8_data()) {
+        continue;
+      }
+      const shared_ptr<SyncedMemory>& data = param->data();
+      if (!mapped_weights_->contains(data->cpu_data())) {
+        continue;
+      }
+      shared_ptr<SyncedMemory>& copy = copies[data.get()];
+      if (!copy) {
+        copy.reset(new SyncedMemory(param->count() * sizeof(Dtype)));
+        caffe_copy(param->count(), param->cpu_data(),
+            static_cast<Dtype*>(copy->mutable_cpu_data()));
+      }
+      param->ShareDataMemory(copy);
+    }
+  }
+  mapped_weights_ = mapped_weights;
+}
+
 template <typename Dtype>
 void Net<Dtype>::CopyTrainedLayersFrom(const string trained_filename) {
+  if (IsMappedWeightsFile(trained_filename)) {
+    MapTrainedLayersFrom(trained_filename);
+    return;
+  }
   NetParameter param;
   ReadNetParamsFromBinaryFileOrDie(trained_filename, &param);
   CopyTrainedLayersFrom(param);
@@ -847,6 +1149,122 @@ const shared_ptr<Layer<Dtype> > Net<Dtype>::layer_by_name(
   return layer_ptr;
 }
 
+template <typename Dtype>
+NetWeights<Dtype>::NetWeights(const string& trained_filename) {
+  if (!IsMappedWeightsFile(trained_filename)) {
+    NetParameter param;
+    ReadNetParamsFromBinaryFileOrDie(trained_filename, &param);
+    FromProto(param);
+    CreateParamCaches();
+    return;
+  }
+  mapped_weights_.reset(new MappedWeights());
+  mapped_weights_->Open(trained_filename);
+  const NetParameter& index = mapped_weights_->index();
+  for (int i = 0; i < index.layer_size(); ++i) {
+    const LayerParameter& layer_param = index.layer(i);
+    vector<shared_ptr<Blob<Dtype> > >& blobs =
+        layer_blobs_[layer_param.name()];
+    for (int j = 0; j < layer_param.blobs_size(); ++j) {
+      vector<int> shape;
+      BlobProtoShape(layer_param.blobs(j), &shape);
+      blobs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>(shape)));
+      SetMappedData(mapped_weights_->data(i, j), blobs.back().get());
+    }
+  }
+  CreateParamCaches();
+}
+
+template <typename Dtype>
+NetWeights<Dtype>::NetWeights(const NetParameter& param) {
+  FromProto(param);
+  CreateParamCaches();
+}
+
+template <typename Dtype>
+void NetWeights<Dtype>::FromProto(const NetParameter& param) {
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& layer_param = param.layer(i);
+    vector<shared_ptr<Blob<Dtype> > >& blobs =
+        layer_blobs_[layer_param.name()];
+    blobs.clear();
+    for (int j = 0; j < layer_param.blobs_size(); ++j) {
+      blobs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+      blobs.back()->FromProto(layer_param.blobs(j));
+    }
+  }
+}
+
+template <typename Dtype>
+void NetWeights<Dtype>::CreateParamCaches() {
+  for (typename map<string, vector<shared_ptr<Blob<Dtype> > > >::iterator
+       it = layer_blobs_.begin(); it != layer_blobs_.end(); ++it) {
+    if (!it->second.empty()) {
+      layer_param_caches_[it->first].reset(new ParamCache<Dtype>());
+    }
+  }
+}
+
+template <typename Dtype>
+shared_ptr<ParamCache<Dtype> > NetWeights<Dtype>::layer_param_cache(
+    const string& layer_name) const {
+  typename map<string, shared_ptr<ParamCache<Dtype> > >::const_iterator it =
+      layer_param_caches_.find(layer_name);
+  return it == layer_param_caches_.end() ?
+      shared_ptr<ParamCache<Dtype> >() : it->second;
+}
+
+template <typename Dtype>
+const vector<shared_ptr<Blob<Dtype> > >* NetWeights<Dtype>::layer_blobs(
+    const string& layer_name) const {
+  typename map<string, vector<shared_ptr<Blob<Dtype> > > >::const_iterator
+      it = layer_blobs_.find(layer_name);
+  if (it == layer_blobs_.end() || it->second.empty()) {
+    return NULL;
+  }
+  return &it->second;
+}
+
+template <typename Dtype>
+void CreateSharedWeightsNets(const NetParameter& param,
+    const shared_ptr<const NetWeights<Dtype> >& weights, int num_nets,
+    vector<shared_ptr<Net<Dtype> > >* nets) {
+  CHECK_GT(num_nets, 0);
+  NetParameter test_param(param);
+  test_param.mutable_state()->set_phase(TEST);
+  nets->clear();
+  for (int i = 0; i < num_nets; ++i) {
+    nets->push_back(shared_ptr<Net<Dtype> >(
+        new Net<Dtype>(test_param, weights)));
+    // Each net draws from its own RNG, seeded from the caller's.
+    shared_ptr<Caffe> context = Caffe::CreateContext();
+    const unsigned int seed = caffe_rng_rand();
+    Caffe::ContextScope context_scope(context.get());
+    Caffe::set_random_seed(seed);
+    nets->back()->set_context(context);
+  }
+#ifndef CPU_ONLY
+  // The parameters are loaded on the CPU; copy them to the device now, as
+  // reading a SyncedMemory that is already in place never writes to it, so
+  // concurrent Forwards only read the parameters.
+  if (Caffe::mode() == Caffe::GPU) {
+    const vector<shared_ptr<Blob<Dtype> > >& params =
+        nets->front()->params();
+    for (int i = 0; i < params.size(); ++i) {
+      params[i]->gpu_data();
+    }
+  }
+#endif
+}
+
+template void CreateSharedWeightsNets<float>(const NetParameter& param,
+    const shared_ptr<const NetWeights<float> >& weights, int num_nets,
+    vector<shared_ptr<Net<float> > >* nets);
+template void CreateSharedWeightsNets<double>(const NetParameter& param,
+    const shared_ptr<const NetWeights<double> >& weights, int num_nets,
+    vector<shared_ptr<Net<double> > >* nets);
+
 INSTANTIATE_CLASS(Net);
+INSTANTIATE_CLASS(NetWeights);
 
 }  // namespace caffe
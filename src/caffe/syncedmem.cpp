@@ -1,3 +1,5 @@
+#include <boost/atomic.hpp>
+
 #include <cstring>
 
 #include "caffe/common.hpp"
@@ -6,6 +8,11 @@
 
 namespace caffe {
 
+size_t SyncedMemory::NewVersion() {
+  static boost::atomic<size_t> last_version(0);
+  return ++last_version;
+}
+
 SyncedMemory::~SyncedMemory() {
   if (cpu_ptr_ && own_cpu_data_) {
     CaffeFreeHost(cpu_ptr_);
@@ -81,6 +88,7 @@ void SyncedMemory::set_cpu_data(void* data) {
   cpu_ptr_ = data;
   head_ = HEAD_AT_CPU;
   own_cpu_data_ = false;
+  version_ = NewVersion();
 }
 
 const void* SyncedMemory::gpu_data() {
@@ -95,6 +103,7 @@ const void* SyncedMemory::gpu_data() {
 void* SyncedMemory::mutable_cpu_data() {
   to_cpu();
   head_ = HEAD_AT_CPU;
+  version_ = NewVersion();
   return cpu_ptr_;
 }
 
@@ -102,6 +111,7 @@ void* SyncedMemory::mutable_gpu_data() {
 #ifndef CPU_ONLY
   to_gpu();
   head_ = HEAD_AT_GPU;
+  version_ = NewVersion();
   return gpu_ptr_;
 #else
   NO_GPU;
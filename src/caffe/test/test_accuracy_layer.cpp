@@ -228,4 +228,47 @@ TYPED_TEST(AccuracyLayerTest, TestForwardCPUTopK) {
               num_correct_labels / 100.0, 1e-4);
 }
 
+TYPED_TEST(AccuracyLayerTest, TestForwardSpatialMultithreaded) {
+  // More positions per image than are scanned together, split over threads.
+  this->blob_bottom_data_->Reshape(3, 10, 9, 10);
+  vector<int> label_shape(3);
+  label_shape[0] = 3; label_shape[1] = 9; label_shape[2] = 10;
+  this->blob_bottom_label_->Reshape(label_shape);
+  this->FillBottoms();
+  for (int top_k = 1; top_k <= this->top_k_; top_k += 2) {
+    LayerParameter layer_param;
+    AccuracyParameter* accuracy_param = layer_param.mutable_accuracy_param();
+    accuracy_param->set_top_k(top_k);
+    accuracy_param->set_num_threads(3);
+    AccuracyLayer<TypeParam> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+
+    int num_correct_labels = 0;
+    vector<int> label_offset(3);
+    for (int n = 0; n < 3; ++n) {
+      for (int h = 0; h < 9; ++h) {
+        for (int w = 0; w < 10; ++w) {
+          label_offset[0] = n; label_offset[1] = h; label_offset[2] = w;
+          const int label = static_cast<int>(
+              this->blob_bottom_label_->data_at(label_offset));
+          const TypeParam label_value =
+              this->blob_bottom_data_->data_at(n, label, h, w);
+          int rank = 0;
+          for (int c = 0; c < 10; ++c) {
+            if (this->blob_bottom_data_->data_at(n, c, h, w) > label_value) {
+              ++rank;
+            }
+          }
+          if (rank < top_k) {
+            ++num_correct_labels;
+          }
+        }
+      }
+    }
+    EXPECT_NEAR(this->blob_top_->data_at(0, 0, 0, 0),
+                num_correct_labels / TypeParam(270), 1e-4);
+  }
+}
+
 }  // namespace caffe
@@ -6,6 +6,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -164,5 +165,51 @@ TYPED_TEST(ArgMaxLayerTest, TestCPUMaxValTopK) {
   }
 }
 
+TYPED_TEST(ArgMaxLayerTest, TestCPUTies) {
+  LayerParameter layer_param;
+  ArgMaxParameter* argmax_param = layer_param.mutable_argmax_param();
+  argmax_param->set_out_max_val(true);
+  argmax_param->set_top_k(this->top_k_);
+  ArgMaxLayer<TypeParam> layer(layer_param);
+  // Ties rank the larger index first.
+  caffe_set(this->blob_bottom_->count(), TypeParam(1),
+      this->blob_bottom_->mutable_cpu_data());
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  int dim = this->blob_bottom_->count() / this->blob_bottom_->num();
+  for (int i = 0; i < this->blob_bottom_->num(); ++i) {
+    for (int j = 0; j < this->top_k_; ++j) {
+      EXPECT_EQ(dim - 1 - j, this->blob_top_->data_at(i, 0, j, 0));
+      EXPECT_EQ(1, this->blob_top_->data_at(i, 1, j, 0));
+    }
+  }
+  // The same for the single argmax.
+  argmax_param->set_top_k(1);
+  ArgMaxLayer<TypeParam> argmax_layer(layer_param);
+  argmax_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  argmax_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < this->blob_bottom_->num(); ++i) {
+    EXPECT_EQ(dim - 1, this->blob_top_->data_at(i, 0, 0, 0));
+  }
+}
+
+TYPED_TEST(ArgMaxLayerTest, TestCPUTopKMultithreaded) {
+  LayerParameter layer_param;
+  ArgMaxParameter* argmax_param = layer_param.mutable_argmax_param();
+  argmax_param->set_out_max_val(true);
+  argmax_param->set_top_k(this->top_k_);
+  ArgMaxLayer<TypeParam> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  Blob<TypeParam> expected;
+  expected.CopyFrom(*this->blob_top_, false, true);
+  argmax_param->set_num_threads(3);
+  ArgMaxLayer<TypeParam> threaded_layer(layer_param);
+  threaded_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  threaded_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < expected.count(); ++i) {
+    EXPECT_EQ(expected.cpu_data()[i], this->blob_top_->cpu_data()[i]);
+  }
+}
 
 }  // namespace caffe
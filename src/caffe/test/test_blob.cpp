@@ -1,3 +1,4 @@
+#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -52,6 +53,37 @@ TYPED_TEST(BlobSimpleTest, TestReshape) {
   EXPECT_EQ(this->blob_->count(), 120);
 }
 
+TYPED_TEST(BlobSimpleTest, TestToHalf) {
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(this->blob_preshaped_);
+  const int count = this->blob_preshaped_->count();
+  vector<TypeParam> data(this->blob_preshaped_->cpu_data(),
+      this->blob_preshaped_->cpu_data() + count);
+  EXPECT_TRUE(this->blob_preshaped_->cpu_half_data() == NULL);
+  this->blob_preshaped_->ToHalf();
+  ASSERT_TRUE(this->blob_preshaped_->cpu_half_data() != NULL);
+  // Writing the blob to a proto and back keeps the fp16 values.
+  BlobProto proto;
+  this->blob_preshaped_->ToProto(&proto);
+  EXPECT_EQ(0, proto.data_size());
+  EXPECT_EQ(count * sizeof(uint16_t), proto.half_data().size());
+  this->blob_->FromProto(proto);
+  // Data that replaces it is narrowed too.
+  this->blob_preshaped_->FromProto(proto);
+  EXPECT_TRUE(this->blob_preshaped_->cpu_half_data() != NULL);
+  this->blob_preshaped_->Widen();
+  EXPECT_FALSE(this->blob_preshaped_->narrowed());
+  const TypeParam* widened = this->blob_preshaped_->cpu_data();
+  for (int i = 0; i < count; ++i) {
+    EXPECT_NEAR(data[i], widened[i], std::abs(data[i]) / 1024);
+    EXPECT_EQ(widened[i], this->blob_->cpu_data()[i]);
+  }
+  // Once widened, it stays Dtype.
+  this->blob_preshaped_->FromProto(proto);
+  EXPECT_FALSE(this->blob_preshaped_->narrowed());
+}
+
 TYPED_TEST(BlobSimpleTest, TestLegacyBlobProtoShapeEquals) {
   BlobProto blob_proto;
 
@@ -1,4 +1,8 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include <cstring>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -44,6 +48,68 @@ TEST_F(CommonTest, TestRandSeedCPU) {
   }
 }
 
+TEST_F(CommonTest, TestContextScope) {
+  Caffe::set_mode(Caffe::CPU);
+  shared_ptr<Caffe> context = Caffe::CreateContext();
+  EXPECT_NE(&Caffe::Get(), context.get());
+  {
+    Caffe::ContextScope scope(context.get());
+    EXPECT_EQ(&Caffe::Get(), context.get());
+    EXPECT_EQ(Caffe::mode(), Caffe::CPU);
+    Caffe::set_mode(Caffe::GPU);
+    EXPECT_EQ(Caffe::mode(), Caffe::GPU);
+    {
+      // A NULL context leaves the current one.
+      Caffe::ContextScope null_scope(NULL);
+      EXPECT_EQ(&Caffe::Get(), context.get());
+    }
+  }
+  EXPECT_NE(&Caffe::Get(), context.get());
+  EXPECT_EQ(Caffe::mode(), Caffe::CPU);
+}
+
+namespace {
+
+void DrawInContext(Caffe* context, int* draws) {
+  Caffe::ContextScope scope(context);
+  caffe_rng_bernoulli(100, 0.5, draws);
+}
+
+}  // namespace
+
+TEST_F(CommonTest, TestContextRandSeed) {
+  // Contexts seeded alike draw alike, concurrently and apart from the
+  // global RNG.
+  const int kNumContexts = 4;
+  vector<shared_ptr<Caffe> > contexts;
+  for (int i = 0; i < kNumContexts; ++i) {
+    contexts.push_back(Caffe::CreateContext());
+    Caffe::ContextScope scope(contexts.back().get());
+    Caffe::set_random_seed(1701);
+  }
+  Caffe::set_random_seed(1701);
+  vector<int> expected_draws(100);
+  caffe_rng_bernoulli(100, 0.5, &expected_draws[0]);
+  Caffe::set_random_seed(1701);
+  vector<vector<int> > draws(kNumContexts, vector<int>(100));
+  boost::thread_group threads;
+  for (int i = 0; i < kNumContexts; ++i) {
+    threads.create_thread(boost::bind(&DrawInContext, contexts[i].get(),
+        &draws[i][0]));
+  }
+  threads.join_all();
+  vector<int> global_draws(100);
+  caffe_rng_bernoulli(100, 0.5, &global_draws[0]);
+  for (int j = 0; j < 100; ++j) {
+    EXPECT_EQ(expected_draws[j], global_draws[j]);
+  }
+  for (int i = 0; i < kNumContexts; ++i) {
+    for (int j = 0; j < 100; ++j) {
+      EXPECT_EQ(expected_draws[j], draws[i][j]);
+    }
+  }
+}
+
 #ifndef CPU_ONLY  // GPU Caffe singleton test.
 
 TEST_F(CommonTest, TestRandSeedGPU) {
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -6,6 +8,8 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/direct_conv.hpp"
+#include "caffe/util/quantize.hpp"
 #include "caffe/vision_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -244,6 +248,384 @@ TYPED_TEST(ConvolutionLayerTest, Test1x1Convolution) {
   }
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestDirectConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Wide enough for whole tiles of output columns as well as the borders and
+  // the columns left over; 6 outputs per group make a block of 4 and 2
+  // single ones, through the 3x3 stride 1 or the general plane kernel.
+  Blob<Dtype> blob_bottom(2, 3, 7, 21);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&blob_bottom);
+  vector<Blob<Dtype>*> blob_bottom_vec(1, &blob_bottom);
+  const int kernel_h[] = {3, 3, 2, 5, 3};
+  const int kernel_w[] = {3, 3, 3, 1, 3};
+  const int stride[] = {1, 1, 2, 1, 1};
+  const int pad[] = {1, 0, 1, 2, 1};
+  const int group[] = {1, 1, 1, 1, 3};
+  for (int c = 0; c < 5; ++c) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_h(kernel_h[c]);
+    convolution_param->set_kernel_w(kernel_w[c]);
+    convolution_param->set_stride(stride[c]);
+    convolution_param->set_pad(pad[c]);
+    convolution_param->set_group(group[c]);
+    convolution_param->set_num_output(6 * group[c]);
+    convolution_param->set_cpu_method(ConvolutionParameter_CPUMethod_DIRECT);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("constant");
+    convolution_param->mutable_bias_filler()->set_value(0.1);
+    shared_ptr<Layer<Dtype> > layer(
+        new ConvolutionLayer<Dtype>(layer_param));
+    layer->SetUp(blob_bottom_vec, this->blob_top_vec_);
+    layer->Forward(blob_bottom_vec, this->blob_top_vec_);
+    // Check against reference convolution.
+    caffe_conv(&blob_bottom, convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_));
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4) << "config " << c;
+    }
+  }
+}
+
+TEST(DirectConvolutionTest, TestPreferred) {
+  // Only depthwise-like convolutions with small kernels and stride 1.
+  EXPECT_TRUE(conv_direct_cpu_preferred(1, 1, 3, 3, 1, 1));
+  EXPECT_TRUE(conv_direct_cpu_preferred(2, 2, 5, 5, 1, 1));
+  EXPECT_FALSE(conv_direct_cpu_preferred(1, 1, 3, 3, 2, 2));
+  EXPECT_FALSE(conv_direct_cpu_preferred(1, 1, 7, 7, 1, 1));
+  EXPECT_FALSE(conv_direct_cpu_preferred(3, 64, 3, 3, 1, 1));
+  EXPECT_FALSE(conv_direct_cpu_preferred(3, 96, 11, 11, 4, 4));
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestIm2colConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Too many channels per group for direct convolution.
+  Blob<Dtype> blob_bottom(2, 8, 6, 4);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&blob_bottom);
+  vector<Blob<Dtype>*> blob_bottom_vec(1, &blob_bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_pad(1);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(blob_bottom_vec, this->blob_top_vec_);
+  layer->Forward(blob_bottom_vec, this->blob_top_vec_);
+  // Check against reference convolution.
+  caffe_conv(&blob_bottom, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestWinogradConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  for (int tile = 2; tile <= 4; tile += 2) {
+    for (int pad = 0; pad <= 1; ++pad) {
+      for (int group = 1; group <= 3; group += 2) {
+        LayerParameter layer_param;
+        ConvolutionParameter* convolution_param =
+            layer_param.mutable_convolution_param();
+        convolution_param->set_kernel_size(3);
+        convolution_param->set_pad(pad);
+        convolution_param->set_group(group);
+        convolution_param->set_num_output(6);
+        convolution_param->set_winograd_tile(tile);
+        convolution_param->mutable_weight_filler()->set_type("gaussian");
+        convolution_param->mutable_bias_filler()->set_type("constant");
+        convolution_param->mutable_bias_filler()->set_value(0.1);
+        shared_ptr<Layer<Dtype> > layer(
+            new WinogradConvolutionLayer<Dtype>(layer_param));
+        layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+        // The second pass must notice that the weights have changed.
+        for (int iter = 0; iter < 2; ++iter) {
+          if (iter == 1) {
+            caffe_scal(layer->blobs()[0]->count(), Dtype(-2),
+                layer->blobs()[0]->mutable_cpu_data());
+          }
+          layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+          caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+              this->MakeReferenceTop(this->blob_top_));
+          const Dtype* top_data = this->blob_top_->cpu_data();
+          const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+          for (int i = 0; i < this->blob_top_->count(); ++i) {
+            EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4) << "tile " << tile
+                << " pad " << pad << " group " << group << " iter " << iter;
+          }
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestFFTConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  for (int kernel = 3; kernel <= 5; kernel += 2) {
+    for (int stride = 1; stride <= 2; ++stride) {
+      for (int group = 1; group <= 3; group += 2) {
+        LayerParameter layer_param;
+        ConvolutionParameter* convolution_param =
+            layer_param.mutable_convolution_param();
+        convolution_param->set_kernel_size(kernel);
+        convolution_param->set_stride(stride);
+        convolution_param->set_pad(2);
+        convolution_param->set_group(group);
+        convolution_param->set_num_output(3);
+        convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+        convolution_param->set_fft_crossover(false);
+        convolution_param->mutable_weight_filler()->set_type("gaussian");
+        convolution_param->mutable_bias_filler()->set_type("constant");
+        convolution_param->mutable_bias_filler()->set_value(0.1);
+        shared_ptr<Layer<Dtype> > layer(
+            new ConvolutionLayer<Dtype>(layer_param));
+        layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+        // The second pass must notice that the weights have changed.
+        for (int iter = 0; iter < 2; ++iter) {
+          if (iter == 1) {
+            caffe_scal(layer->blobs()[0]->count(), Dtype(-2),
+                layer->blobs()[0]->mutable_cpu_data());
+          }
+          layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+          caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+              this->MakeReferenceTop(this->blob_top_));
+          const Dtype* top_data = this->blob_top_->cpu_data();
+          const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+          for (int i = 0; i < this->blob_top_->count(); ++i) {
+            EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4) << "kernel "
+                << kernel << " stride " << stride << " group " << group
+                << " iter " << iter;
+          }
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestForwardOnlyWorkspace) {
+  typedef typename TypeParam::Dtype Dtype;
+  if (Caffe::mode() == Caffe::GPU) {
+    return;
+  }
+  // Forward through the FFTs, and direct Forward, do not read the column
+  // buffer.
+  for (int direct = 0; direct <= 1; ++direct) {
+    LayerParameter layer_param;
+    layer_param.set_phase(TEST);
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_size(3);
+    convolution_param->set_stride(2);
+    convolution_param->set_num_output(4);
+    if (direct) {
+      convolution_param->set_cpu_method(ConvolutionParameter_CPUMethod_DIRECT);
+    } else {
+      convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+      convolution_param->set_fft_crossover(false);
+    }
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("constant");
+    convolution_param->mutable_bias_filler()->set_value(0.1);
+    shared_ptr<Layer<Dtype> > layer(
+        new ConvolutionLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    EXPECT_EQ(size_t(0), layer->workspace_size()) << "direct " << direct;
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_));
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4) << "direct " << direct;
+    }
+    // The weight gradient does, if Backward runs after all.
+    caffe_set(this->blob_top_->count(), Dtype(1),
+        this->blob_top_->mutable_cpu_diff());
+    vector<bool> propagate_down(1, true);
+    layer->Backward(this->blob_top_vec_, propagate_down,
+        this->blob_bottom_vec_);
+    Dtype weight_diff_sum = 0;
+    for (int i = 0; i < layer->blobs()[0]->count(); ++i) {
+      weight_diff_sum += std::fabs(layer->blobs()[0]->cpu_diff()[i]);
+    }
+    EXPECT_GT(weight_diff_sum, 0) << "direct " << direct;
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestFFTLargeKernelConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Large enough for the crossover to pick FFTs over several tiles.
+  Blob<Dtype> blob_bottom(1, 4, 40, 40);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&blob_bottom);
+  vector<Blob<Dtype>*> blob_bottom_vec(1, &blob_bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(11);
+  convolution_param->set_pad(5);
+  convolution_param->set_num_output(4);
+  convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(blob_bottom_vec, this->blob_top_vec_);
+  layer->Forward(blob_bottom_vec, this->blob_top_vec_);
+  caffe_conv(&blob_bottom, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-3);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestInt8Convolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Calibrate the input scale on the input itself.
+  Dtype max_abs = 0;
+  for (int i = 0; i < this->blob_bottom_->count(); ++i) {
+    max_abs = std::max(max_abs, std::abs(this->blob_bottom_->cpu_data()[i]));
+  }
+  for (int kernel = 1; kernel <= 3; kernel += 2) {
+    for (int group = 1; group <= 3; group += 2) {
+      LayerParameter layer_param;
+      layer_param.set_phase(TEST);
+      layer_param.mutable_quantization_param()->set_input_scale(
+          int8_scale(max_abs));
+      ConvolutionParameter* convolution_param =
+          layer_param.mutable_convolution_param();
+      convolution_param->set_kernel_size(kernel);
+      convolution_param->set_pad(kernel / 2);
+      convolution_param->set_group(group);
+      convolution_param->set_num_output(3);
+      convolution_param->mutable_weight_filler()->set_type("gaussian");
+      convolution_param->mutable_bias_filler()->set_type("constant");
+      convolution_param->mutable_bias_filler()->set_value(0.1);
+      shared_ptr<Layer<Dtype> > layer(
+          new ConvolutionLayer<Dtype>(layer_param));
+      layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+      if (Caffe::mode() == Caffe::CPU && kernel > 1) {
+        // int8 Forward does not read the column buffer.
+        EXPECT_EQ(size_t(0), layer->workspace_size());
+      }
+      layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      // The reference convolves the dequantized weights.
+      layer->blobs()[0]->Widen();
+      caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+          this->MakeReferenceTop(this->blob_top_));
+      // int8 rounding: compare the RMS error to the RMS of the output.
+      const Dtype* top_data = this->blob_top_->cpu_data();
+      const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+      Dtype error = 0, norm = 0;
+      for (int i = 0; i < this->blob_top_->count(); ++i) {
+        error += (top_data[i] - ref_top_data[i]) *
+            (top_data[i] - ref_top_data[i]);
+        norm += ref_top_data[i] * ref_top_data[i];
+      }
+      EXPECT_LT(sqrt(error / norm), 0.02) << "kernel " << kernel
+          << " group " << group;
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestMultithreadedConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Three threads for two images: one of them has nothing to do.
+  for (int num_threads = 2; num_threads <= 3; ++num_threads) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_size(3);
+    convolution_param->set_stride(2);
+    convolution_param->set_num_output(4);
+    convolution_param->set_num_threads(num_threads);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("constant");
+    convolution_param->mutable_bias_filler()->set_value(0.1);
+    shared_ptr<Layer<Dtype> > layer(
+        new ConvolutionLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    // Check against reference convolution.
+    caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_));
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_->count(); ++i) {
+      EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestSharedWorkspace) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // 3 channels x 3 x 3 kernel x 2 x 1 outputs
+  EXPECT_EQ(3 * 3 * 3 * 2 * 1 * sizeof(Dtype), layer->workspace_size());
+  LayerParameter layer_param_2(layer_param);
+  layer_param_2.mutable_convolution_param()->set_kernel_size(2);
+  layer_param_2.mutable_convolution_param()->set_stride(1);
+  vector<Blob<Dtype>*> blob_top_vec_2(1, this->blob_top_2_);
+  shared_ptr<Layer<Dtype> > layer_2(
+      new ConvolutionLayer<Dtype>(layer_param_2));
+  layer_2->SetUp(this->blob_bottom_vec_, blob_top_vec_2);
+  // 3 channels x 2 x 2 kernel x 5 x 3 outputs
+  EXPECT_EQ(3 * 2 * 2 * 5 * 3 * sizeof(Dtype), layer_2->workspace_size());
+  // Both layers use a single workspace and still compute what they should.
+  shared_ptr<SyncedMemory> workspace(new SyncedMemory(
+      std::max(layer->workspace_size(), layer_2->workspace_size())));
+  layer->SetWorkspace(workspace);
+  layer_2->SetWorkspace(workspace);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer_2->Forward(this->blob_bottom_vec_, blob_top_vec_2);
+  const Dtype* top_data;
+  const Dtype* ref_top_data;
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  top_data = this->blob_top_->cpu_data();
+  ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+  caffe_conv(this->blob_bottom_, layer_param_2.mutable_convolution_param(),
+      layer_2->blobs(), this->MakeReferenceTop(this->blob_top_2_));
+  top_data = this->blob_top_2_->cpu_data();
+  ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_2_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
 TYPED_TEST(ConvolutionLayerTest, TestSimpleConvolutionGroup) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -350,14 +732,12 @@ TYPED_TEST(ConvolutionLayerTest, TestSobelConvolution) {
   convolution_param->set_bias_term(false);
   layer.reset(new ConvolutionLayer<Dtype>(layer_param));
   layer->blobs().resize(1);
-  layer->blobs()[0].reset(new Blob<Dtype>(1, 3, 1, 3));
+  // The input is the single channel of the column filter.
+  layer->blobs()[0].reset(new Blob<Dtype>(1, 1, 1, 3));
   Dtype* weights_2 = layer->blobs()[0]->mutable_cpu_data();
-  for (int c = 0; c < 3; ++c) {
-    int i = c * 3;  // 1 x 3 filter
-    weights_2[i +  0] = -1;
-    weights_2[i +  1] =  0;
-    weights_2[i +  2] =  1;
-  }
+  weights_2[0] = -1;
+  weights_2[1] =  0;
+  weights_2[2] =  1;
   layer->SetUp(sep_blob_bottom_vec, sep_blob_top_vec);
   layer->Forward(sep_blob_bottom_vec, sep_blob_top_vec);
   // Test equivalence of full and separable filters.
@@ -386,6 +766,69 @@ TYPED_TEST(ConvolutionLayerTest, TestGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestMultithreadedGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_num_output(2);
+  convolution_param->set_num_threads(2);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestWinogradGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  for (int tile = 2; tile <= 4; tile += 2) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_size(3);
+    convolution_param->set_pad(1);
+    convolution_param->set_group(3);
+    convolution_param->set_num_output(3);
+    convolution_param->set_winograd_tile(tile);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    WinogradConvolutionLayer<Dtype> layer(layer_param);
+    // F(4x4,3x3) rounds more, which shows in the finite differences.
+    GradientChecker<Dtype> checker(1e-2, tile == 2 ? 1e-3 : 5e-3);
+    checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+        this->blob_top_vec_);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestFFTGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  for (int stride = 1; stride <= 2; ++stride) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_size(3);
+    convolution_param->set_stride(stride);
+    convolution_param->set_pad(1);
+    convolution_param->set_group(3);
+    convolution_param->set_num_output(3);
+    convolution_param->set_num_threads(2);
+    convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+    convolution_param->set_fft_crossover(false);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    ConvolutionLayer<Dtype> layer(layer_param);
+    GradientChecker<Dtype> checker(1e-2, 1e-3);
+    checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+        this->blob_top_vec_);
+  }
+}
+
 TYPED_TEST(ConvolutionLayerTest, Test1x1Gradient) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -643,14 +1086,12 @@ TYPED_TEST(CuDNNConvolutionLayerTest, TestSobelConvolutionCuDNN) {
   convolution_param->set_bias_term(false);
   layer.reset(new CuDNNConvolutionLayer<TypeParam>(layer_param));
   layer->blobs().resize(1);
-  layer->blobs()[0].reset(new Blob<TypeParam>(1, 3, 1, 3));
+  // The input is the single channel of the column filter.
+  layer->blobs()[0].reset(new Blob<TypeParam>(1, 1, 1, 3));
   TypeParam* weights_2 = layer->blobs()[0]->mutable_cpu_data();
-  for (int c = 0; c < 3; ++c) {
-    int i = c * 3;  // 1 x 3 filter
-    weights_2[i +  0] = -1;
-    weights_2[i +  1] =  0;
-    weights_2[i +  2] =  1;
-  }
+  weights_2[0] = -1;
+  weights_2[1] =  0;
+  weights_2[2] =  1;
   layer->SetUp(sep_blob_bottom_vec, sep_blob_top_vec);
   layer->Forward(sep_blob_bottom_vec, sep_blob_top_vec);
   // Test equivalence of full and separable filters.
@@ -27,7 +27,8 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
       : backend_(DataParameter_DB_LEVELDB),
         blob_top_data_(new Blob<Dtype>()),
         blob_top_label_(new Blob<Dtype>()),
-        seed_(1701) {}
+        seed_(1701),
+        decode_threads_(1) {}
   virtual void SetUp() {
     filename_.reset(new string());
     MakeTempDir(filename_.get());
@@ -74,6 +75,7 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
     data_param->set_batch_size(5);
     data_param->set_source(filename_->c_str());
     data_param->set_backend(backend_);
+    data_param->set_decode_threads(decode_threads_);
 
     TransformationParameter* transform_param =
         param.mutable_transform_param();
@@ -230,6 +232,7 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
     data_param->set_batch_size(5);
     data_param->set_source(filename_->c_str());
     data_param->set_backend(backend_);
+    data_param->set_decode_threads(decode_threads_);
 
     TransformationParameter* transform_param =
         param.mutable_transform_param();
@@ -344,6 +347,7 @@ class DataLayerTest : public MultiDeviceTest<TypeParam> {
   vector<Blob<Dtype>*> blob_bottom_vec_;
   vector<Blob<Dtype>*> blob_top_vec_;
   int seed_;
+  int decode_threads_;
 };
 
 TYPED_TEST_CASE(DataLayerTest, TestDtypesAndDevices);
@@ -386,6 +390,22 @@ TYPED_TEST(DataLayerTest, TestReadCropTestLevelDB) {
   this->TestReadCrop(TEST);
 }
 
+TYPED_TEST(DataLayerTest, TestReadMultiThreadLevelDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  this->decode_threads_ = 3;
+  this->TestRead();
+}
+
+// Test that the sequence of random crops is consistent when the batch is
+// decoded by several threads.
+TYPED_TEST(DataLayerTest, TestReadCropTrainSequenceSeededMultiThreadLevelDB) {
+  const bool unique_pixels = true;  // all images the same; pixels different
+  this->Fill(unique_pixels, DataParameter_DB_LEVELDB);
+  this->decode_threads_ = 3;
+  this->TestReadCropTrainSequenceSeeded();
+}
+
 TYPED_TEST(DataLayerTest, TestReadLMDB) {
   const bool unique_pixels = false;  // all pixels the same; images different
   this->Fill(unique_pixels, DataParameter_DB_LMDB);
@@ -424,4 +444,20 @@ TYPED_TEST(DataLayerTest, TestReadCropTestLMDB) {
   this->TestReadCrop(TEST);
 }
 
+TYPED_TEST(DataLayerTest, TestReadMultiThreadLMDB) {
+  const bool unique_pixels = false;  // all pixels the same; images different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  this->decode_threads_ = 3;
+  this->TestRead();
+}
+
+// Test that the sequence of random crops is consistent when the batch is
+// decoded by several threads.
+TYPED_TEST(DataLayerTest, TestReadCropTrainSequenceSeededMultiThreadLMDB) {
+  const bool unique_pixels = true;  // all images the same; pixels different
+  this->Fill(unique_pixels, DataParameter_DB_LMDB);
+  this->decode_threads_ = 3;
+  this->TestReadCropTrainSequenceSeeded();
+}
+
 }  // namespace caffe
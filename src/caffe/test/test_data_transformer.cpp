@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "leveldb/db.h"
+#include "opencv2/core/core.hpp"
 
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
@@ -252,6 +254,104 @@ TYPED_TEST(DataTransformTest, TestRotateTest){
   int num_matches = this->NumSequenceMatches(transform_param, datum, TEST);
   EXPECT_LT(num_matches, size * this->num_iter_);
 }
+TYPED_TEST(DataTransformTest, TestRotateLayout) {
+  TransformationParameter transform_param;
+  const bool unique_pixels = true;  // pixels are consecutive ints [0,size]
+  const int label = 0;
+  const int channels = 2;
+  const int height = 3;
+  const int width = 3;
+  const int size = channels * height * width;
+
+  transform_param.set_rotate(true);
+  Datum datum;
+  FillDatum(label, channels, height, width, unique_pixels, &datum);
+  // Expected output of each of the four quarter-turn rotations.
+  vector<vector<TypeParam> > rotations(4, vector<TypeParam>(size));
+  for (int c = 0; c < channels; ++c) {
+    for (int h = 0; h < height; ++h) {
+      for (int w = 0; w < width; ++w) {
+        const TypeParam pixel = (c * height + h) * width + w;
+        const int plane = c * height * width;
+        rotations[0][plane + h * width + w] = pixel;
+        rotations[1][plane + w * width + height - 1 - h] = pixel;
+        rotations[2][plane + (height - 1 - h) * width + width - 1 - w] =
+            pixel;
+        rotations[3][plane + (width - 1 - w) * width + h] = pixel;
+      }
+    }
+  }
+  Caffe::set_random_seed(this->seed_);
+  DataTransformer<TypeParam> transformer(transform_param, TEST);
+  transformer.InitRand();
+  Blob<TypeParam> blob(1, channels, height, width);
+  vector<bool> seen(4, false);
+  for (int iter = 0; iter < this->num_iter_; ++iter) {
+    transformer.Transform(datum, &blob);
+    vector<TypeParam> output(blob.cpu_data(), blob.cpu_data() + size);
+    int rotation = 0;
+    while (rotation < 4 && output != rotations[rotation]) {
+      ++rotation;
+    }
+    ASSERT_LT(rotation, 4) << "Output is not a rotation of the input";
+    seen[rotation] = true;
+  }
+  EXPECT_GT(std::count(seen.begin(), seen.end(), true), 1);
+}
+
+TYPED_TEST(DataTransformTest, TestMatMatchesDatum) {
+  TransformationParameter transform_param;
+  const bool unique_pixels = true;  // pixels are consecutive ints [0,size]
+  const int label = 0;
+  const int channels = 3;
+  const int height = 5;
+  const int width = 5;
+  const int crop_size = 3;
+
+  transform_param.set_crop_size(crop_size);
+  transform_param.set_mirror(true);
+  transform_param.set_rotate(true);
+  transform_param.set_contrast_adjustment(true);
+  transform_param.set_scale(0.5);
+  for (int c = 0; c < channels; ++c) {
+    transform_param.add_mean_value(10 * c);
+    transform_param.add_eigen_value(c + 1);
+    for (int i = 0; i < channels; ++i) {
+      transform_param.add_eigen_vector_component(c == i);
+    }
+  }
+  transform_param.mutable_relight_filler()->set_type("uniform");
+  Datum datum;
+  FillDatum(label, channels, height, width, unique_pixels, &datum);
+  // The same image, stored interleaved as OpenCV does.
+  cv::Mat cv_img(height, width, CV_8UC3);
+  for (int h = 0; h < height; ++h) {
+    uchar* ptr = cv_img.ptr<uchar>(h);
+    for (int w = 0; w < width; ++w) {
+      for (int c = 0; c < channels; ++c) {
+        ptr[w * channels + c] = static_cast<uint8_t>(
+            datum.data()[(c * height + h) * width + w]);
+      }
+    }
+  }
+  // Identically seeded transformers draw the same augmentations.
+  DataTransformer<TypeParam> datum_transformer(transform_param, TRAIN);
+  DataTransformer<TypeParam> mat_transformer(transform_param, TRAIN);
+  Caffe::set_random_seed(this->seed_);
+  datum_transformer.InitRand();
+  Caffe::set_random_seed(this->seed_);
+  mat_transformer.InitRand();
+  Blob<TypeParam> datum_blob(1, channels, crop_size, crop_size);
+  Blob<TypeParam> mat_blob(1, channels, crop_size, crop_size);
+  for (int iter = 0; iter < this->num_iter_; ++iter) {
+    datum_transformer.Transform(datum, &datum_blob);
+    mat_transformer.Transform(cv_img, &mat_blob);
+    for (int j = 0; j < datum_blob.count(); ++j) {
+      EXPECT_EQ(datum_blob.cpu_data()[j], mat_blob.cpu_data()[j]);
+    }
+  }
+}
+
 TYPED_TEST(DataTransformTest, TestCropMirrorTrain) {
   TransformationParameter transform_param;
   const bool unique_pixels = true;  // pixels are consecutive ints [0,size]
@@ -137,6 +137,39 @@ TYPED_TEST(DeconvolutionLayerTest, TestSimpleDeconvolution) {
   }
 }
 
+TYPED_TEST(DeconvolutionLayerTest, TestFFTDeconvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  for (int stride = 1; stride <= 2; ++stride) {
+    LayerParameter layer_param;
+    ConvolutionParameter* convolution_param =
+        layer_param.mutable_convolution_param();
+    convolution_param->set_kernel_size(5);
+    convolution_param->set_stride(stride);
+    convolution_param->set_pad(1);
+    convolution_param->set_group(3);
+    convolution_param->set_num_output(6);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+    DeconvolutionLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    // The same deconvolution through FFTs.
+    convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+    convolution_param->set_fft_crossover(false);
+    DeconvolutionLayer<Dtype> fft_layer(layer_param);
+    fft_layer.blobs() = layer.blobs();
+    Blob<Dtype> fft_top;
+    vector<Blob<Dtype>*> fft_top_vec(1, &fft_top);
+    fft_layer.SetUp(this->blob_bottom_vec_, fft_top_vec);
+    fft_layer.Forward(this->blob_bottom_vec_, fft_top_vec);
+    ASSERT_EQ(this->blob_top_->count(), fft_top.count());
+    for (int i = 0; i < fft_top.count(); ++i) {
+      EXPECT_NEAR(this->blob_top_->cpu_data()[i], fft_top.cpu_data()[i],
+          1e-4) << "stride " << stride;
+    }
+  }
+}
+
 TYPED_TEST(DeconvolutionLayerTest, TestGradient) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -155,4 +188,42 @@ TYPED_TEST(DeconvolutionLayerTest, TestGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(DeconvolutionLayerTest, TestMultithreadedGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  convolution_param->set_kernel_size(2);
+  convolution_param->set_stride(1);
+  convolution_param->set_num_output(1);
+  convolution_param->set_num_threads(2);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  DeconvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+TYPED_TEST(DeconvolutionLayerTest, TestFFTGradient) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_size(3);
+  convolution_param->set_stride(2);
+  convolution_param->set_pad(1);
+  convolution_param->set_num_output(2);
+  convolution_param->set_engine(ConvolutionParameter_Engine_FFT);
+  convolution_param->set_fft_crossover(false);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  DeconvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
 }  // namespace caffe
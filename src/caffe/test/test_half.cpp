@@ -0,0 +1,79 @@
+#include <stdint.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class HalfTest : public ::testing::Test {};
+
+TEST_F(HalfTest, TestConversion) {
+  EXPECT_EQ(0x0000, float_to_half(0.f));
+  EXPECT_EQ(0x8000, float_to_half(-0.f));
+  EXPECT_EQ(0x3c00, float_to_half(1.f));
+  EXPECT_EQ(0xc000, float_to_half(-2.f));
+  EXPECT_EQ(0x7bff, float_to_half(65504.f));
+  EXPECT_EQ(0x7c00, float_to_half(65520.f));
+  EXPECT_EQ(0xfc00, float_to_half(-1e10f));
+  EXPECT_EQ(0x0001, float_to_half(std::pow(2.f, -24)));
+  EXPECT_EQ(0x0000, float_to_half(std::pow(2.f, -26)));
+  // Ties round to even: 1 + 2^-11 lies halfway between 1 and 1 + 2^-10.
+  EXPECT_EQ(0x3c00, float_to_half(1.f + std::pow(2.f, -11)));
+  EXPECT_EQ(0x3c02, float_to_half(1.f + 3 * std::pow(2.f, -11)));
+  const float nan = half_to_float(
+      float_to_half(std::numeric_limits<float>::quiet_NaN()));
+  EXPECT_NE(nan, nan);
+}
+
+TEST_F(HalfTest, TestRoundTrip) {
+  // Every finite half survives widening and narrowing again.
+  for (int h = 0; h < 0x10000; ++h) {
+    if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff)) {
+      continue;
+    }
+    EXPECT_EQ(h, float_to_half(half_to_float(static_cast<uint16_t>(h))))
+        << "half " << h;
+  }
+}
+
+template <typename Dtype>
+class HalfGemmTest : public CPUDeviceTest<Dtype> {};
+
+TYPED_TEST_CASE(HalfGemmTest, TestDtypes);
+
+TYPED_TEST(HalfGemmTest, TestGemm) {
+  // Enough rows of B for several panels.
+  const int M = 3, N = 70, K = 1000;
+  Blob<TypeParam> A(1, 1, M, K), B(1, 1, N, K), C(1, 1, M, N),
+      ref_C(1, 1, M, N);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(&A);
+  filler.Fill(&B);
+  filler.Fill(&C);
+  ref_C.CopyFrom(C);
+  vector<uint16_t> B_half(N * K);
+  caffe_cpu_float2half(N * K, B.cpu_data(), &B_half[0]);
+  caffe_cpu_half2float(N * K, &B_half[0], B.mutable_cpu_data());
+  vector<TypeParam> panel(caffe_cpu_gemm_half_panel_count(N, K));
+  caffe_cpu_gemm_half<TypeParam>(M, N, K, 2., A.cpu_data(), &B_half[0], 0.5,
+      C.mutable_cpu_data(), &panel[0]);
+  caffe_cpu_gemm<TypeParam>(CblasNoTrans, CblasTrans, M, N, K, 2.,
+      A.cpu_data(), B.cpu_data(), 0.5, ref_C.mutable_cpu_data());
+  for (int i = 0; i < M * N; ++i) {
+    EXPECT_NEAR(ref_C.cpu_data()[i], C.cpu_data()[i], 1e-3);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,143 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/syncedmem.hpp"
+#include "caffe/util/host_allocator.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class HostAllocatorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    HostReleaseCache();
+    default_cache_limit_ = host_cache_limit();
+  }
+
+  virtual void TearDown() {
+    SetHostCacheLimit(default_cache_limit_);
+  }
+
+  size_t default_cache_limit_;
+};
+
+TEST_F(HostAllocatorTest, TestAlignment) {
+  const size_t sizes[] = {0, 1, 63, 64, 65, 1000, 4096, 100000,
+      static_cast<size_t>(1) << 29};
+  for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    char* ptr = static_cast<char*>(HostAllocate(sizes[i]));
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % kHostAlignment);
+    // The whole block is usable; the largest, past the pooled sizes, is left
+    // untouched.
+    if (sizes[i] > 0 && sizes[i] <= 100000) {
+      memset(ptr, 1, sizes[i]);
+    }
+    HostFree(ptr);
+  }
+}
+
+TEST_F(HostAllocatorTest, TestReuse) {
+  void* ptr = HostAllocate(1000);
+  HostFree(ptr);
+  const HostAllocatorStats before = host_allocator_stats();
+  // A size of the same class gets the cached block back.
+  void* reused = HostAllocate(1010);
+  EXPECT_EQ(ptr, reused);
+  const HostAllocatorStats after = host_allocator_stats();
+  EXPECT_EQ(before.allocations + 1, after.allocations);
+  EXPECT_EQ(before.system_allocations, after.system_allocations);
+  // A larger class does not.
+  void* larger = HostAllocate(2000);
+  EXPECT_NE(ptr, larger);
+  EXPECT_EQ(before.system_allocations + 1,
+      host_allocator_stats().system_allocations);
+  HostFree(larger);
+  HostFree(reused);
+}
+
+TEST_F(HostAllocatorTest, TestStats) {
+  const HostAllocatorStats before = host_allocator_stats();
+  void* a = HostAllocate(1 << 20);
+  void* b = HostAllocate(1 << 20);
+  const HostAllocatorStats during = host_allocator_stats();
+  EXPECT_EQ(before.bytes_live + (2 << 20), during.bytes_live);
+  EXPECT_GE(during.peak_bytes_live, during.bytes_live);
+  EXPECT_EQ(before.allocations + 2, during.allocations);
+  HostFree(a);
+  HostFree(b);
+  const HostAllocatorStats after = host_allocator_stats();
+  EXPECT_EQ(before.bytes_live, after.bytes_live);
+  EXPECT_EQ(during.peak_bytes_live, after.peak_bytes_live);
+}
+
+namespace {
+
+void FreeOnThread(void* ptr) {
+  HostFree(ptr);
+}
+
+}  // namespace
+
+TEST_F(HostAllocatorTest, TestFreeOnOtherThread) {
+  const HostAllocatorStats before = host_allocator_stats();
+  void* ptr = HostAllocate(5000);
+  boost::thread thread(boost::bind(&FreeOnThread, ptr));
+  thread.join();
+  EXPECT_EQ(before.bytes_live, host_allocator_stats().bytes_live);
+}
+
+TEST_F(HostAllocatorTest, TestCacheLimit) {
+  const size_t cached = host_allocator_stats().cached_bytes;
+  SetHostCacheLimit(cached + (1 << 20));
+  // Two blocks of the 640 KB class do not both fit in the cache.
+  void* a = HostAllocate(600000);
+  void* b = HostAllocate(600000);
+  HostFree(a);
+  EXPECT_EQ(cached + 655360, host_allocator_stats().cached_bytes);
+  // Freeing the second returns the first to the system to make room.
+  HostFree(b);
+  EXPECT_EQ(cached + 655360, host_allocator_stats().cached_bytes);
+  const HostAllocatorStats before = host_allocator_stats();
+  EXPECT_EQ(b, HostAllocate(600000));
+  EXPECT_EQ(before.system_allocations,
+      host_allocator_stats().system_allocations);
+  HostFree(b);
+  // Lowering the limit trims the cache of this thread.
+  SetHostCacheLimit(cached);
+  EXPECT_EQ(cached, host_allocator_stats().cached_bytes);
+  void* c = HostAllocate(1000);
+  HostFree(c);
+  EXPECT_EQ(cached, host_allocator_stats().cached_bytes);
+}
+
+TEST_F(HostAllocatorTest, TestSyncedMemoryReuse) {
+  // Transient blobs reuse memory rather than reallocating it.
+  {
+    SyncedMemory mem(10000);
+    memset(mem.mutable_cpu_data(), 1, 10000);
+  }
+  const HostAllocatorStats before = host_allocator_stats();
+  {
+    SyncedMemory mem(10000);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(mem.cpu_data()) %
+        kHostAlignment);
+    // Reused memory is zeroed as before.
+    for (int i = 0; i < 10000; ++i) {
+      EXPECT_EQ(0, static_cast<const char*>(mem.cpu_data())[i]);
+    }
+    static_cast<char*>(mem.mutable_cpu_data())[0] = 1;
+  }
+  EXPECT_EQ(before.system_allocations,
+      host_allocator_stats().system_allocations);
+}
+
+}  // namespace caffe
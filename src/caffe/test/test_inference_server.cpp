@@ -0,0 +1,184 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/inference_server.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class InferenceServerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  InferenceServerTest() : max_batch_size_(4), num_requests_(10) {}
+
+  virtual void SetUp() {
+    Caffe::set_random_seed(1701);
+    const string proto =
+        "name: 'ServedNetwork' "
+        "input: 'data' "
+        "input_shape { dim: 4 dim: 2 dim: 5 dim: 5 } "
+        "layer { "
+        "  name: 'conv' "
+        "  type: 'Convolution' "
+        "  convolution_param { "
+        "    num_output: 3 "
+        "    kernel_size: 3 "
+        "    weight_filler { type: 'gaussian' std: 0.1 } "
+        "    bias_filler { type: 'gaussian' std: 0.1 } "
+        "  } "
+        "  bottom: 'data' "
+        "  top: 'conv' "
+        "} "
+        "layer { "
+        "  name: 'ip' "
+        "  type: 'InnerProduct' "
+        "  inner_product_param { "
+        "    num_output: 6 "
+        "    weight_filler { type: 'gaussian' std: 0.1 } "
+        "    bias_filler { type: 'gaussian' std: 0.1 } "
+        "  } "
+        "  bottom: 'conv' "
+        "  top: 'ip' "
+        "} "
+        "layer { "
+        "  name: 'prob' "
+        "  type: 'Softmax' "
+        "  bottom: 'ip' "
+        "  top: 'prob' "
+        "} ";
+    NetParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+    param.mutable_state()->set_phase(TEST);
+    vector<shared_ptr<Net<Dtype> > > nets;
+    NetParameter weights_param;
+    Net<Dtype>(param).ToProto(&weights_param);
+    CreateSharedWeightsNets(param,
+        shared_ptr<const NetWeights<Dtype> >(
+            new NetWeights<Dtype>(weights_param)), 2, &nets);
+    net_ = nets[0];
+    reference_net_ = nets[1];
+    const int input_count = net_->input_blobs()[0]->count(1);
+    Blob<Dtype> inputs(num_requests_, input_count, 1, 1);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(&inputs);
+    inputs_.assign(inputs.cpu_data(), inputs.cpu_data() + inputs.count());
+  }
+
+  // The outputs of request i run on its own.
+  void ExpectServed(int i, const InferenceFuture<Dtype>& future) {
+    Blob<Dtype>* input_blob = reference_net_->input_blobs()[0];
+    vector<int> shape = input_blob->shape();
+    shape[0] = 1;
+    input_blob->Reshape(shape);
+    reference_net_->Reshape();
+    caffe_copy(input_blob->count(), &inputs_[i * input_blob->count()],
+        input_blob->mutable_cpu_data());
+    const vector<Blob<Dtype>*>& expected = reference_net_->ForwardPrefilled();
+    ASSERT_TRUE(future.ready());
+    ASSERT_EQ(expected.size(), future.outputs().size());
+    for (int j = 0; j < expected.size(); ++j) {
+      ASSERT_EQ(expected[j]->count(), future.outputs()[j].size());
+      for (int k = 0; k < expected[j]->count(); ++k) {
+        EXPECT_NEAR(expected[j]->cpu_data()[k], future.outputs()[j][k], 1e-5);
+      }
+    }
+  }
+
+  const int max_batch_size_;
+  const int num_requests_;
+  shared_ptr<Net<Dtype> > net_;
+  shared_ptr<Net<Dtype> > reference_net_;
+  vector<Dtype> inputs_;
+};
+
+TYPED_TEST_CASE(InferenceServerTest, TestDtypesAndDevices);
+
+TYPED_TEST(InferenceServerTest, TestBatching) {
+  typedef typename TypeParam::Dtype Dtype;
+  // A long delay, so that requests submitted together share batches.
+  InferenceServer<Dtype> server(this->net_, 200000);
+  EXPECT_EQ(this->max_batch_size_, server.max_batch_size());
+  const int input_count = server.input_count();
+  vector<shared_ptr<InferenceFuture<Dtype> > > futures;
+  for (int i = 0; i < this->num_requests_; ++i) {
+    futures.push_back(server.Submit(&this->inputs_[i * input_count]));
+  }
+  for (int i = 0; i < this->num_requests_; ++i) {
+    futures[i]->Wait();
+    this->ExpectServed(i, *futures[i]);
+  }
+  // How the requests were split depends on the scheduling of the threads,
+  // so only the bounds are checked.
+  const InferenceServerStats stats = server.stats();
+  EXPECT_EQ(this->num_requests_, stats.requests);
+  EXPECT_GE(stats.batches, (this->num_requests_ + this->max_batch_size_ - 1) /
+      this->max_batch_size_);
+  EXPECT_LE(stats.batches, this->num_requests_);
+  EXPECT_LE(stats.mean_batch_size, this->max_batch_size_);
+  EXPECT_LE(stats.p50_latency_ms, stats.max_latency_ms);
+}
+
+namespace {
+
+template <typename Dtype>
+void SubmitAndWait(InferenceServer<Dtype>* server, const Dtype* input,
+    shared_ptr<InferenceFuture<Dtype> >* future) {
+  *future = server->Submit(input);
+  (*future)->Wait();
+}
+
+}  // namespace
+
+TYPED_TEST(InferenceServerTest, TestConcurrentRequests) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<shared_ptr<InferenceFuture<Dtype> > > futures(this->num_requests_);
+  {
+    InferenceServer<Dtype> server(this->net_, 1000);
+    const int input_count = server.input_count();
+    boost::thread_group threads;
+    for (int i = 0; i < this->num_requests_; ++i) {
+      threads.create_thread(boost::bind(&SubmitAndWait<Dtype>, &server,
+          &this->inputs_[i * input_count], &futures[i]));
+    }
+    threads.join_all();
+    const InferenceServerStats stats = server.stats();
+    EXPECT_EQ(this->num_requests_, stats.requests);
+    EXPECT_EQ(0, stats.queue_depth);
+    EXPECT_LE(stats.batches, this->num_requests_);
+  }
+  for (int i = 0; i < this->num_requests_; ++i) {
+    this->ExpectServed(i, *futures[i]);
+  }
+}
+
+TYPED_TEST(InferenceServerTest, TestServesQueuedOnDestruction) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<shared_ptr<InferenceFuture<Dtype> > > futures;
+  {
+    InferenceServer<Dtype> server(this->net_, 200000);
+    const int input_count = server.input_count();
+    for (int i = 0; i < this->num_requests_; ++i) {
+      futures.push_back(server.Submit(&this->inputs_[i * input_count]));
+    }
+  }
+  for (int i = 0; i < this->num_requests_; ++i) {
+    this->ExpectServed(i, *futures[i]);
+  }
+}
+
+}  // namespace caffe
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <cstring>
 #include <vector>
 
@@ -6,6 +7,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/quantize.hpp"
 #include "caffe/vision_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -55,6 +57,23 @@ TYPED_TEST(InnerProductLayerTest, TestSetUp) {
   EXPECT_EQ(this->blob_top_->channels(), 10);
 }
 
+TYPED_TEST(InnerProductLayerTest, TestSetUpLegacyParams) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  InnerProductParameter* inner_product_param =
+      layer_param.mutable_inner_product_param();
+  inner_product_param->set_num_output(10);
+  InnerProductLayer<Dtype> layer(layer_param);
+  // Given parameters in the 4D shapes of older models.
+  layer.blobs().push_back(
+      shared_ptr<Blob<Dtype> >(new Blob<Dtype>(1, 1, 10, 60)));
+  layer.blobs().push_back(
+      shared_ptr<Blob<Dtype> >(new Blob<Dtype>(1, 1, 1, 10)));
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(this->blob_top_->channels(), 10);
+  EXPECT_EQ(4, layer.blobs()[0]->num_axes());
+}
+
 TYPED_TEST(InnerProductLayerTest, TestForward) {
   typedef typename TypeParam::Dtype Dtype;
   bool IS_VALID_CUDA = false;
@@ -85,6 +104,68 @@ TYPED_TEST(InnerProductLayerTest, TestForward) {
   }
 }
 
+TYPED_TEST(InnerProductLayerTest, TestInt8Forward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  InnerProductParameter* inner_product_param =
+      layer_param.mutable_inner_product_param();
+  inner_product_param->set_num_output(10);
+  inner_product_param->mutable_weight_filler()->set_type("gaussian");
+  inner_product_param->mutable_bias_filler()->set_type("uniform");
+  InnerProductLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  Blob<Dtype> ref_top;
+  ref_top.CopyFrom(*this->blob_top_, false, true);
+  // The same weights, quantized; the uniform bottom lies in [0, 1].
+  layer_param.set_phase(TEST);
+  layer_param.mutable_quantization_param()->set_input_scale(
+      int8_scale(Dtype(1)));
+  InnerProductLayer<Dtype> int8_layer(layer_param);
+  int8_layer.blobs() = layer.blobs();
+  int8_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  int8_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_TRUE(int8_layer.blobs()[0]->cpu_int8_data() != NULL);
+  const Dtype* data = this->blob_top_->cpu_data();
+  const Dtype* ref_data = ref_top.cpu_data();
+  Dtype error = 0, norm = 0;
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    error += (data[i] - ref_data[i]) * (data[i] - ref_data[i]);
+    norm += ref_data[i] * ref_data[i];
+  }
+  EXPECT_LT(sqrt(error / norm), 0.02);
+}
+
+TYPED_TEST(InnerProductLayerTest, TestHalfWeightsForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.set_phase(TEST);
+  InnerProductParameter* inner_product_param =
+      layer_param.mutable_inner_product_param();
+  inner_product_param->set_num_output(10);
+  inner_product_param->set_half_weights(true);
+  inner_product_param->mutable_weight_filler()->set_type("gaussian");
+  inner_product_param->mutable_bias_filler()->set_type("uniform");
+  InnerProductLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  Blob<Dtype> top;
+  top.CopyFrom(*this->blob_top_, false, true);
+  if (Caffe::mode() == Caffe::CPU) {
+    EXPECT_TRUE(layer.blobs()[0]->cpu_half_data() != NULL);
+  }
+  // The reference product of the widened weights.
+  layer.blobs()[0]->Widen();
+  inner_product_param->set_half_weights(false);
+  InnerProductLayer<Dtype> ref_layer(layer_param);
+  ref_layer.blobs() = layer.blobs();
+  ref_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  ref_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(this->blob_top_->cpu_data()[i], top.cpu_data()[i], 1e-4);
+  }
+}
+
 TYPED_TEST(InnerProductLayerTest, TestGradient) {
   typedef typename TypeParam::Dtype Dtype;
   bool IS_VALID_CUDA = false;
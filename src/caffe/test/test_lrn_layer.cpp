@@ -197,6 +197,46 @@ TYPED_TEST(LRNLayerTest, TestGradientAcrossChannelsLargeRegion) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(LRNLayerTest, TestForwardAcrossChannelsMultithreaded) {
+  typedef typename TypeParam::Dtype Dtype;
+  // More positions than fit in one tile, split over three threads.
+  this->blob_bottom_->Reshape(2, 7, 20, 20);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  const float betas[] = {0.75, 0.6};
+  for (int i = 0; i < 2; ++i) {
+    LayerParameter layer_param;
+    layer_param.mutable_lrn_param()->set_beta(betas[i]);
+    layer_param.mutable_lrn_param()->set_num_threads(3);
+    LRNLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    Blob<Dtype> top_reference;
+    this->ReferenceLRNForward(*(this->blob_bottom_), layer_param,
+        &top_reference);
+    for (int j = 0; j < this->blob_bottom_->count(); ++j) {
+      EXPECT_NEAR(this->blob_top_->cpu_data()[j],
+          top_reference.cpu_data()[j], this->epsilon_);
+    }
+  }
+}
+
+TYPED_TEST(LRNLayerTest, TestGradientAcrossChannelsMultithreaded) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->blob_bottom_->Reshape(2, 5, 17, 17);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  layer_param.mutable_lrn_param()->set_beta(0.6);
+  layer_param.mutable_lrn_param()->set_num_threads(3);
+  LRNLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-2);
+  checker.CheckGradient(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
 TYPED_TEST(LRNLayerTest, TestSetupWithinChannel) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
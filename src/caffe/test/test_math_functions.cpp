@@ -1,8 +1,10 @@
 #include <stdint.h>  // for uint32_t & uint64_t
 #include <time.h>
+#include <algorithm>
 #include <climits>
 #include <cmath>  // for std::fabs
 #include <cstdlib>  // for rand_r
+#include <limits>
 
 #include "gtest/gtest.h"
 
@@ -150,6 +152,107 @@ TYPED_TEST(CPUMathFunctionsTest, TestCopy) {
   }
 }
 
+TYPED_TEST(CPUMathFunctionsTest, TestExp) {
+  const int n = this->blob_bottom_->count();
+  const TypeParam* x = this->blob_bottom_->cpu_data();
+  caffe_exp<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::exp(x[i]);
+    EXPECT_NEAR(y[i], expected, 1e-6 * expected);
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  for (int i = 0; i < n; ++i) {
+    x[i] = std::fabs(x[i]);
+  }
+  caffe_log<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::log(x[i]);
+    EXPECT_NEAR(y[i], expected, 1e-6 * std::max<TypeParam>(1,
+        std::fabs(expected)));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestLog1p) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  for (int i = 0; i < n; ++i) {
+    x[i] = std::fabs(x[i]) - TypeParam(0.9);
+  }
+  caffe_log1p<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = log1p(x[i]);
+    EXPECT_NEAR(y[i], expected, 1e-6 * std::fabs(expected));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestTanh) {
+  const int n = this->blob_bottom_->count();
+  TypeParam* x = this->blob_bottom_->mutable_cpu_data();
+  caffe_scal<TypeParam>(n, 3, x);
+  caffe_tanh<TypeParam>(n, x, this->blob_bottom_->mutable_cpu_diff());
+  const TypeParam* y = this->blob_bottom_->cpu_diff();
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = std::tanh(x[i]);
+    EXPECT_NEAR(y[i], expected, 1e-6 * std::fabs(expected));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestPowx) {
+  const int n = this->blob_bottom_->count();
+  const TypeParam* x = this->blob_bottom_->cpu_data();
+  TypeParam* abs_x = this->blob_top_->mutable_cpu_data();
+  caffe_abs<TypeParam>(n, x, abs_x);
+  TypeParam* y = this->blob_bottom_->mutable_cpu_diff();
+  const TypeParam powers[] = {0.75, -0.75, 1.5, 0.5, 2, -1};
+  for (int j = 0; j < sizeof(powers) / sizeof(powers[0]); ++j) {
+    caffe_powx<TypeParam>(n, abs_x, powers[j], y);
+    for (int i = 0; i < n; ++i) {
+      const TypeParam expected = std::pow(abs_x[i], powers[j]);
+      EXPECT_NEAR(y[i], expected, 1e-5 * expected);
+    }
+  }
+  // Negative bases have the sign of an odd integer power.
+  caffe_powx<TypeParam>(n, x, TypeParam(3), y);
+  for (int i = 0; i < n; ++i) {
+    const TypeParam expected = x[i] * x[i] * x[i];
+    EXPECT_NEAR(y[i], expected, 1e-5 * std::fabs(expected));
+  }
+}
+
+TYPED_TEST(CPUMathFunctionsTest, TestSpecialValues) {
+  const TypeParam inf = std::numeric_limits<TypeParam>::infinity();
+  const TypeParam x[] = {-1000, 1000, 0, -1, inf, -inf};
+  const int n = sizeof(x) / sizeof(x[0]);
+  TypeParam y[n];
+  caffe_exp<TypeParam>(n, x, y);
+  EXPECT_EQ(0, y[0]);
+  EXPECT_EQ(inf, y[1]);
+  EXPECT_EQ(1, y[2]);
+  EXPECT_EQ(inf, y[4]);
+  EXPECT_EQ(0, y[5]);
+  caffe_log<TypeParam>(n, x, y);
+  EXPECT_TRUE(isnan(y[0]));
+  EXPECT_EQ(-inf, y[2]);
+  EXPECT_EQ(inf, y[4]);
+  caffe_log1p<TypeParam>(n, x, y);
+  EXPECT_EQ(0, y[2]);
+  EXPECT_EQ(-inf, y[3]);
+  EXPECT_EQ(inf, y[4]);
+  caffe_tanh<TypeParam>(n, x, y);
+  EXPECT_EQ(-1, y[0]);
+  EXPECT_EQ(1, y[1]);
+  EXPECT_EQ(0, y[2]);
+  EXPECT_EQ(1, y[4]);
+  EXPECT_EQ(-1, y[5]);
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
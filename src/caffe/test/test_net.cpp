@@ -1,3 +1,6 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include <string>
 #include <utility>
 #include <vector>
@@ -9,6 +12,7 @@
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
 #include "caffe/net.hpp"
+#include "caffe/util/io.hpp"
 #include "caffe/util/math_functions.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -613,6 +617,180 @@ class NetTest : public MultiDeviceTest<TypeParam> {
     InitNetFromProtoString(proto);
   }
 
+  virtual void InitActivationSharingNet(const bool share) {
+    string proto =
+        "name: 'ActivationSharingNetwork' "
+        "state { phase: TEST } "
+        "input: 'data' "
+        "input_dim: 2 "
+        "input_dim: 3 "
+        "input_dim: 10 "
+        "input_dim: 10 "
+        "layer { "
+        "  name: 'conv1' "
+        "  type: 'Convolution' "
+        "  bottom: 'data' "
+        "  top: 'conv1' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu1' "
+        "  type: 'ReLU' "
+        "  bottom: 'conv1' "
+        "  top: 'conv1' "
+        "} "
+        "layer { "
+        "  name: 'pool1' "
+        "  type: 'Pooling' "
+        "  bottom: 'conv1' "
+        "  top: 'pool1' "
+        "  pooling_param { "
+        "    pool: MAX "
+        "    kernel_size: 2 "
+        "    stride: 2 "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'ip1' "
+        "  type: 'InnerProduct' "
+        "  bottom: 'pool1' "
+        "  top: 'ip1' "
+        "  inner_product_param { "
+        "    num_output: 5 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'ip2' "
+        "  type: 'InnerProduct' "
+        "  bottom: 'pool1' "
+        "  top: 'ip2' "
+        "  inner_product_param { "
+        "    num_output: 5 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.1 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'sum' "
+        "  type: 'Eltwise' "
+        "  bottom: 'ip1' "
+        "  bottom: 'ip2' "
+        "  top: 'sum' "
+        "} "
+        "layer { "
+        "  name: 'reshape' "
+        "  type: 'Reshape' "
+        "  bottom: 'sum' "
+        "  top: 'sum_reshaped' "
+        "  reshape_param { shape { dim: 0 dim: -1 } } "
+        "} "
+        "layer { "
+        "  name: 'prob' "
+        "  type: 'Softmax' "
+        "  bottom: 'sum_reshaped' "
+        "  top: 'prob' "
+        "} ";
+    if (share) {
+      proto += "share_activation_memory: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
+  virtual void InitFusionNet(const bool fuse) {
+    string proto =
+        "name: 'FusionNetwork' "
+        "state { phase: TEST } "
+        "input: 'data' "
+        "input_dim: 2 "
+        "input_dim: 3 "
+        "input_dim: 6 "
+        "input_dim: 6 "
+        "layer { "
+        "  name: 'conv1' "
+        "  type: 'Convolution' "
+        "  bottom: 'data' "
+        "  top: 'conv1' "
+        "  convolution_param { "
+        "    num_output: 4 "
+        "    kernel_size: 3 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.5 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.5 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'relu1' "
+        "  type: 'ReLU' "
+        "  bottom: 'conv1' "
+        "  top: 'conv1' "
+        "  relu_param { negative_slope: 0.1 } "
+        "} "
+        "layer { "
+        "  name: 'ip1' "
+        "  type: 'InnerProduct' "
+        "  bottom: 'conv1' "
+        "  top: 'ip1' "
+        "  inner_product_param { "
+        "    num_output: 5 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.5 "
+        "    } "
+        "    bias_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.5 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'tanh1' "
+        "  type: 'TanH' "
+        "  bottom: 'ip1' "
+        "  top: 'ip1' "
+        "} "
+        "layer { "
+        "  name: 'ip2' "
+        "  type: 'InnerProduct' "
+        "  bottom: 'ip1' "
+        "  top: 'ip2' "
+        "  inner_product_param { "
+        "    num_output: 3 "
+        "    weight_filler { "
+        "      type: 'gaussian' "
+        "      std: 0.5 "
+        "    } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'sigmoid' "
+        "  type: 'Sigmoid' "
+        "  bottom: 'ip2' "
+        "  top: 'prob' "
+        "} ";
+    if (fuse) {
+      proto += "fuse_layers: true ";
+    }
+    InitNetFromProtoString(proto);
+  }
+
   virtual void InitSkipPropNet(bool test_skip_true) {
     string proto =
       "name: 'SkipPropTestNetwork' "
@@ -1230,6 +1408,322 @@ TYPED_TEST(NetTest, TestSharedWeightsResume) {
   EXPECT_NE(ip1_weights->cpu_diff(), ip2_weights->cpu_diff());
 }
 
+TYPED_TEST(NetTest, TestMapTrainedLayers) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_random_seed(this->seed_);
+  this->InitTinyNet();
+  NetParameter net_param;
+  this->net_->ToProto(&net_param);
+  string filename;
+  MakeTempFilename(&filename);
+  WriteMappedWeights(net_param, filename);
+  EXPECT_TRUE(IsMappedWeightsFile(filename));
+  const vector<shared_ptr<Blob<Dtype> > > params = this->net_->params();
+
+  // A net initialized differently loads the same weights.
+  for (int iter = 0; iter < 2; ++iter) {
+    Caffe::set_random_seed(this->seed_ + 1);
+    this->InitTinyNet();
+    this->net_->CopyTrainedLayersFrom(filename);
+    ASSERT_EQ(params.size(), this->net_->params().size());
+    for (int i = 0; i < params.size(); ++i) {
+      Blob<Dtype>* param = this->net_->params()[i].get();
+      ASSERT_EQ(params[i]->count(), param->count());
+      // The weights are stored as float.
+      for (int j = 0; j < param->count(); ++j) {
+        EXPECT_EQ(static_cast<float>(params[i]->cpu_data()[j]),
+            param->cpu_data()[j]);
+      }
+      // Writes to the weights stay out of the file.
+      caffe_set(param->count(), Dtype(0), param->mutable_cpu_data());
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestMapLegacyTrainedLayers) {
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_random_seed(this->seed_);
+  this->InitTinyNet();
+  NetParameter net_param;
+  this->net_->ToProto(&net_param);
+  // Give the blobs the legacy dimensions of old models: the weights
+  // 1 x 1 x 1000 x 24 and the biases 1 x 1 x 1 x 1000.
+  for (int i = 0; i < net_param.layer_size(); ++i) {
+    for (int j = 0; j < net_param.layer(i).blobs_size(); ++j) {
+      BlobProto* blob_proto = net_param.mutable_layer(i)->mutable_blobs(j);
+      const BlobShape& shape = blob_proto->shape();
+      ASSERT_LE(shape.dim_size(), 2);
+      blob_proto->set_num(1);
+      blob_proto->set_channels(1);
+      blob_proto->set_height(shape.dim_size() == 2 ? shape.dim(0) : 1);
+      blob_proto->set_width(shape.dim(shape.dim_size() - 1));
+      blob_proto->clear_shape();
+    }
+  }
+  string filename;
+  MakeTempFilename(&filename);
+  WriteMappedWeights(net_param, filename);
+  {
+    MappedWeights mapped_weights;
+    mapped_weights.Open(filename);
+    const LayerParameter& index_layer = mapped_weights.index().layer(1);
+    ASSERT_EQ(2, index_layer.blobs_size());
+    EXPECT_EQ(1000, index_layer.blobs(0).height());
+    EXPECT_EQ(24, index_layer.blobs(0).width());
+    EXPECT_EQ(1000, index_layer.blobs(1).width());
+  }
+  const vector<shared_ptr<Blob<Dtype> > > params = this->net_->params();
+  Caffe::set_random_seed(this->seed_ + 1);
+  this->InitTinyNet();
+  this->net_->CopyTrainedLayersFrom(filename);
+  // Mapping weights for no layer at all releases the first mapping, while
+  // the parameters keep its weights.
+  NetParameter empty_param;
+  string empty_filename;
+  MakeTempFilename(&empty_filename);
+  WriteMappedWeights(empty_param, empty_filename);
+  this->net_->CopyTrainedLayersFrom(empty_filename);
+  ASSERT_EQ(params.size(), this->net_->params().size());
+  for (int i = 0; i < params.size(); ++i) {
+    Blob<Dtype>* param = this->net_->params()[i].get();
+    ASSERT_EQ(params[i]->count(), param->count());
+    for (int j = 0; j < param->count(); ++j) {
+      EXPECT_EQ(static_cast<float>(params[i]->cpu_data()[j]),
+          param->cpu_data()[j]);
+    }
+  }
+}
+
+namespace {
+
+template <typename Dtype>
+void ForwardRepeatedly(Net<Dtype>* net, int iterations) {
+  for (int i = 0; i < iterations; ++i) {
+    net->ForwardPrefilled();
+  }
+}
+
+// A net of a convolution and an inner product, with layer_extra added to
+// both of their parameters and ip_extra to the inner_product_param.
+string SharedWeightsNetsProto(const string& layer_extra,
+    const string& ip_extra) {
+  return
+      "name: 'SharedWeightsNetwork' "
+      "input: 'data' "
+      "input_shape { dim: 2 dim: 3 dim: 6 dim: 6 } "
+      "layer { "
+      "  name: 'conv' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 4 "
+      "    kernel_size: 3 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "    bias_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv' " + layer_extra +
+      "} "
+      "layer { "
+      "  name: 'relu' "
+      "  type: 'ReLU' "
+      "  bottom: 'conv' "
+      "  top: 'conv' "
+      "} "
+      "layer { "
+      "  name: 'ip' "
+      "  type: 'InnerProduct' "
+      "  inner_product_param { "
+      "    num_output: 5 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "    bias_filler { type: 'gaussian' std: 0.1 } " + ip_extra +
+      "  } "
+      "  bottom: 'conv' "
+      "  top: 'ip' " + layer_extra +
+      "} ";
+}
+
+// Checks that nets created by CreateSharedWeightsNets from proto share
+// their parameters, and running Forward concurrently gives the outputs of
+// a net of their own. Returns the weights they share.
+template <typename Dtype>
+shared_ptr<const NetWeights<Dtype> > CheckSharedWeightsNets(
+    const string& proto, int seed) {
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Caffe::set_random_seed(seed);
+  Net<Dtype> net(param);
+  NetParameter weights_param;
+  net.ToProto(&weights_param);
+  shared_ptr<const NetWeights<Dtype> > weights(
+      new NetWeights<Dtype>(weights_param));
+  // As the weights went through the proto.
+  net.CopyTrainedLayersFrom(weights_param);
+  const int kNumNets = 4;
+  vector<shared_ptr<Net<Dtype> > > nets;
+  CreateSharedWeightsNets(param, weights, kNumNets, &nets);
+  EXPECT_EQ(kNumNets, nets.size());
+
+  // The nets hold the same parameter blobs but their own activations.
+  const vector<shared_ptr<Blob<Dtype> > >& params = nets[0]->params();
+  EXPECT_EQ(4, params.size());
+  EXPECT_EQ(weights->layer_blobs("conv")->at(0), params[0]);
+  EXPECT_EQ(weights->layer_blobs("ip")->at(1), params[3]);
+  for (int i = 1; i < kNumNets; ++i) {
+    EXPECT_EQ(params.size(), nets[i]->params().size());
+    for (int j = 0; j < params.size(); ++j) {
+      EXPECT_EQ(params[j], nets[i]->params()[j]);
+    }
+    EXPECT_NE(nets[0]->blob_by_name("ip"), nets[i]->blob_by_name("ip"));
+    // And the blobs their layers compute from the parameters.
+    EXPECT_EQ(nets[0]->layer_by_name("conv")->param_cache(),
+        nets[i]->layer_by_name("conv")->param_cache());
+  }
+
+  // Forward concurrently on different inputs gives the outputs of the
+  // original net.
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  vector<shared_ptr<Blob<Dtype> > > expected_outputs;
+  for (int i = 0; i < kNumNets; ++i) {
+    filler.Fill(nets[i]->input_blobs()[0]);
+    net.input_blobs()[0]->CopyFrom(*nets[i]->input_blobs()[0]);
+    net.ForwardPrefilled();
+    expected_outputs.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>()));
+    expected_outputs.back()->CopyFrom(*net.output_blobs()[0], false, true);
+  }
+  const int kIterations = 50;
+  boost::thread_group threads;
+  for (int i = 0; i < kNumNets; ++i) {
+    threads.create_thread(boost::bind(&ForwardRepeatedly<Dtype>,
+        nets[i].get(), kIterations));
+  }
+  threads.join_all();
+  for (int i = 0; i < kNumNets; ++i) {
+    const Blob<Dtype>* output = nets[i]->output_blobs()[0];
+    EXPECT_EQ(expected_outputs[i]->count(), output->count());
+    for (int j = 0; j < output->count(); ++j) {
+      EXPECT_EQ(expected_outputs[i]->cpu_data()[j], output->cpu_data()[j]);
+    }
+  }
+  return weights;
+}
+
+}  // namespace
+
+TYPED_TEST(NetTest, TestSharedWeightsNets) {
+  typedef typename TypeParam::Dtype Dtype;
+  CheckSharedWeightsNets<Dtype>(SharedWeightsNetsProto("", ""), this->seed_);
+}
+
+TYPED_TEST(NetTest, TestSharedWeightsNetsHalfWeights) {
+  typedef typename TypeParam::Dtype Dtype;
+  shared_ptr<const NetWeights<Dtype> > weights =
+      CheckSharedWeightsNets<Dtype>(SharedWeightsNetsProto("",
+          "half_weights: true "), this->seed_);
+  // The nets ran on the shared fp16 weights.
+  EXPECT_TRUE(weights->layer_blobs("ip")->at(0)->cpu_half_data());
+}
+
+TYPED_TEST(NetTest, TestSharedWeightsNetsQuantized) {
+  typedef typename TypeParam::Dtype Dtype;
+  shared_ptr<const NetWeights<Dtype> > weights =
+      CheckSharedWeightsNets<Dtype>(SharedWeightsNetsProto(
+          "quantization_param { input_scale: 0.05 } ", ""), this->seed_);
+  // The nets ran on the shared int8 weights.
+  EXPECT_TRUE(weights->layer_blobs("conv")->at(0)->cpu_int8_data());
+  EXPECT_TRUE(weights->layer_blobs("ip")->at(0)->cpu_int8_data());
+}
+
+TYPED_TEST(NetTest, TestReserve) {
+  typedef typename TypeParam::Dtype Dtype;
+  const string proto =
+      "name: 'FullyConvolutionalNetwork' "
+      "input: 'data' "
+      "input_shape { dim: 1 dim: 3 dim: 8 dim: 8 } "
+      "state { phase: TEST } "
+      "layer { "
+      "  name: 'conv1' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 4 "
+      "    kernel_size: 3 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'data' "
+      "  top: 'conv1' "
+      "} "
+      "layer { "
+      "  name: 'relu1' "
+      "  type: 'ReLU' "
+      "  bottom: 'conv1' "
+      "  top: 'conv1' "
+      "} "
+      "layer { "
+      "  name: 'conv2' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 4 "
+      "    kernel_size: 3 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'conv1' "
+      "  top: 'conv2' "
+      "} "
+      "layer { "
+      "  name: 'conv3' "
+      "  type: 'Convolution' "
+      "  convolution_param { "
+      "    num_output: 2 "
+      "    kernel_size: 1 "
+      "    weight_filler { type: 'gaussian' std: 0.1 } "
+      "  } "
+      "  bottom: 'conv2' "
+      "  top: 'conv3' "
+      "} ";
+  NetParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(proto, &param));
+  Net<Dtype> reference_net(param);
+  param.set_share_activation_memory(true);
+  this->net_.reset(new Net<Dtype>(param));
+  this->net_->ShareTrainedLayersWith(&reference_net);
+  vector<vector<int> > max_shapes(1);
+  max_shapes[0].push_back(4);
+  max_shapes[0].push_back(3);
+  max_shapes[0].push_back(12);
+  max_shapes[0].push_back(12);
+  this->net_->Reserve(max_shapes);
+  const vector<shared_ptr<Blob<Dtype> > >& blobs = this->net_->blobs();
+  vector<const Dtype*> blob_data(blobs.size());
+  for (int i = 0; i < blobs.size(); ++i) {
+    blob_data[i] = blobs[i]->cpu_data();
+  }
+  // Shapes within the reserved one move no memory, and run as usual.
+  const int kNumShapes = 3;
+  const int shapes[kNumShapes][4] = {{2, 3, 10, 9}, {4, 3, 12, 12},
+      {1, 3, 8, 8}};
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  for (int s = 0; s < kNumShapes; ++s) {
+    const vector<int> shape(shapes[s], shapes[s] + 4);
+    Blob<Dtype>* input = this->net_->input_blobs()[0];
+    input->Reshape(shape);
+    filler.Fill(input);
+    this->net_->ForwardPrefilled();
+    for (int i = 0; i < blobs.size(); ++i) {
+      EXPECT_EQ(blob_data[i], blobs[i]->cpu_data()) << "blob " << i;
+    }
+    reference_net.input_blobs()[0]->ReshapeLike(*input);
+    reference_net.input_blobs()[0]->CopyFrom(*input);
+    reference_net.ForwardPrefilled();
+    const Blob<Dtype>* output = this->net_->output_blobs()[0];
+    const Blob<Dtype>* expected = reference_net.output_blobs()[0];
+    ASSERT_TRUE(output->shape() == expected->shape());
+    for (int i = 0; i < output->count(); ++i) {
+      EXPECT_EQ(expected->cpu_data()[i], output->cpu_data()[i]);
+    }
+  }
+}
+
 TYPED_TEST(NetTest, TestParamPropagateDown) {
   typedef typename TypeParam::Dtype Dtype;
   vector<Blob<Dtype>*> bottom;
@@ -2321,6 +2815,87 @@ TYPED_TEST(NetTest, TestReshape) {
   }
 }
 
+TYPED_TEST(NetTest, TestShareActivationMemory) {
+  typedef typename TypeParam::Dtype Dtype;
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> data(2, 3, 10, 10);
+  filler.Fill(&data);
+
+  Caffe::set_random_seed(this->seed_);
+  this->InitActivationSharingNet(false);
+  shared_ptr<Net<Dtype> > unshared_net = this->net_;
+  Caffe::set_random_seed(this->seed_);
+  this->InitActivationSharingNet(true);
+  shared_ptr<Net<Dtype> > shared_net = this->net_;
+
+  // conv1 is dead once pool1 has run, so ip1 can reuse its memory; the
+  // split of pool1 keeps it alive until ip2 has run.
+  EXPECT_EQ(shared_net->blob_by_name("conv1")->data(),
+      shared_net->blob_by_name("ip1")->data());
+  EXPECT_NE(shared_net->blob_by_name("pool1")->data(),
+      shared_net->blob_by_name("ip1")->data());
+  EXPECT_NE(shared_net->blob_by_name("pool1")->data(),
+      shared_net->blob_by_name("ip2")->data());
+  EXPECT_NE(shared_net->blob_by_name("ip1")->data(),
+      shared_net->blob_by_name("ip2")->data());
+
+  for (int iter = 0; iter < 2; ++iter) {
+    unshared_net->input_blobs()[0]->CopyFrom(data);
+    shared_net->input_blobs()[0]->CopyFrom(data);
+    unshared_net->ForwardPrefilled();
+    shared_net->ForwardPrefilled();
+    const Blob<Dtype>* expected = unshared_net->output_blobs()[0];
+    const Blob<Dtype>* actual = shared_net->output_blobs()[0];
+    ASSERT_EQ(expected->count(), actual->count());
+    for (int i = 0; i < expected->count(); ++i) {
+      EXPECT_EQ(expected->cpu_data()[i], actual->cpu_data()[i]);
+    }
+  }
+}
+
+TYPED_TEST(NetTest, TestFuseLayers) {
+  typedef typename TypeParam::Dtype Dtype;
+  FillerParameter filler_param;
+  filler_param.set_std(1);
+  GaussianFiller<Dtype> filler(filler_param);
+  Blob<Dtype> data(2, 3, 6, 6);
+  filler.Fill(&data);
+
+  Caffe::set_random_seed(this->seed_);
+  this->InitFusionNet(false);
+  shared_ptr<Net<Dtype> > unfused_net = this->net_;
+  Caffe::set_random_seed(this->seed_);
+  this->InitFusionNet(true);
+  shared_ptr<Net<Dtype> > fused_net = this->net_;
+
+  // The in-place activations are folded into the layers before them; the
+  // Sigmoid writes to another blob, so it stays.
+  EXPECT_TRUE(unfused_net->has_layer("relu1"));
+  EXPECT_TRUE(unfused_net->has_layer("tanh1"));
+  EXPECT_FALSE(fused_net->has_layer("relu1"));
+  EXPECT_FALSE(fused_net->has_layer("tanh1"));
+  EXPECT_TRUE(fused_net->has_layer("sigmoid"));
+  EXPECT_EQ(unfused_net->layers().size() - 2, fused_net->layers().size());
+
+  unfused_net->input_blobs()[0]->CopyFrom(data);
+  fused_net->input_blobs()[0]->CopyFrom(data);
+  unfused_net->ForwardPrefilled();
+  fused_net->ForwardPrefilled();
+  const char* blob_names[] = {"conv1", "ip1", "prob"};
+  for (int b = 0; b < 3; ++b) {
+    const Blob<Dtype>* expected =
+        unfused_net->blob_by_name(blob_names[b]).get();
+    const Blob<Dtype>* actual = fused_net->blob_by_name(blob_names[b]).get();
+    ASSERT_EQ(expected->count(), actual->count());
+    for (int i = 0; i < expected->count(); ++i) {
+      EXPECT_NEAR(expected->cpu_data()[i], actual->cpu_data()[i], 1e-5)
+          << blob_names[b];
+    }
+  }
+}
+
 TYPED_TEST(NetTest, TestSkipPropagateDown) {
   // check bottom_need_backward if propagate_down is true
   this->InitSkipPropNet(false);
@@ -259,6 +259,20 @@ TYPED_TEST(NeuronLayerTest, TestSigmoid) {
   }
 }
 
+TYPED_TEST(NeuronLayerTest, TestSigmoidTanHEmpty) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  SigmoidLayer<Dtype> sigmoid_layer(layer_param);
+  TanHLayer<Dtype> tanh_layer(layer_param);
+  sigmoid_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  tanh_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // A batch of no images.
+  this->blob_bottom_->Reshape(0, 3, 4, 5);
+  sigmoid_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  tanh_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(0, this->blob_top_->count());
+}
+
 TYPED_TEST(NeuronLayerTest, TestSigmoidGradient) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cfloat>
 #include <cstring>
 #include <vector>
 
@@ -6,6 +8,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/math_functions.hpp"
 #include "caffe/vision_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -606,6 +609,155 @@ TYPED_TEST(PoolingLayerTest, TestGradientAvePadded) {
   }
 }
 
+TYPED_TEST(PoolingLayerTest, TestForwardStride2) {
+  typedef typename TypeParam::Dtype Dtype;
+  // The last row of 2x2 windows and column of 3x3 windows are clipped.
+  const int height = 7;
+  const int width = 10;
+  this->blob_bottom_->Reshape(2, 3, height, width);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  for (int kernel_size = 2; kernel_size <= 3; ++kernel_size) {
+    for (int pool = PoolingParameter_PoolMethod_MAX;
+         pool <= PoolingParameter_PoolMethod_AVE; ++pool) {
+      LayerParameter layer_param;
+      PoolingParameter* pooling_param = layer_param.mutable_pooling_param();
+      pooling_param->set_kernel_size(kernel_size);
+      pooling_param->set_stride(2);
+      pooling_param->set_pool(
+          static_cast<PoolingParameter_PoolMethod>(pool));
+      PoolingLayer<Dtype> layer(layer_param);
+      layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+      layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      const int pooled_height = this->blob_top_->height();
+      const int pooled_width = this->blob_top_->width();
+      EXPECT_EQ(kernel_size == 2 ? 4 : 3, pooled_height);
+      EXPECT_EQ(5, pooled_width);
+      for (int n = 0; n < 2; ++n) {
+        for (int c = 0; c < 3; ++c) {
+          for (int ph = 0; ph < pooled_height; ++ph) {
+            for (int pw = 0; pw < pooled_width; ++pw) {
+              const int hend = std::min(ph * 2 + kernel_size, height);
+              const int wend = std::min(pw * 2 + kernel_size, width);
+              Dtype expected = pool == PoolingParameter_PoolMethod_MAX ?
+                  -FLT_MAX : 0;
+              for (int h = ph * 2; h < hend; ++h) {
+                for (int w = pw * 2; w < wend; ++w) {
+                  const Dtype value = this->blob_bottom_->data_at(n, c, h, w);
+                  if (pool == PoolingParameter_PoolMethod_MAX) {
+                    expected = std::max(expected, value);
+                  } else {
+                    expected += value;
+                  }
+                }
+              }
+              if (pool == PoolingParameter_PoolMethod_AVE) {
+                expected /= (hend - ph * 2) * (wend - pw * 2);
+              }
+              EXPECT_NEAR(expected, this->blob_top_->data_at(n, c, ph, pw),
+                  1e-6);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(PoolingLayerTest, TestMaskFreeMax) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->blob_bottom_->Reshape(2, 3, 7, 9);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  vector<bool> propagate_down(1, true);
+  for (int kernel_size = 2; kernel_size <= 4; ++kernel_size) {
+    LayerParameter layer_param;
+    PoolingParameter* pooling_param = layer_param.mutable_pooling_param();
+    pooling_param->set_kernel_size(kernel_size);
+    pooling_param->set_stride(2);
+    pooling_param->set_pool(PoolingParameter_PoolMethod_MAX);
+    // The TRAIN phase keeps the mask, the TEST phase does not.
+    layer_param.set_phase(TRAIN);
+    PoolingLayer<Dtype> train_layer(layer_param);
+    Blob<Dtype> train_top;
+    vector<Blob<Dtype>*> train_top_vec(1, &train_top);
+    train_layer.SetUp(this->blob_bottom_vec_, train_top_vec);
+    train_layer.Forward(this->blob_bottom_vec_, train_top_vec);
+    layer_param.set_phase(TEST);
+    PoolingLayer<Dtype> test_layer(layer_param);
+    test_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    test_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    ASSERT_EQ(train_top.count(), this->blob_top_->count());
+    for (int i = 0; i < train_top.count(); ++i) {
+      EXPECT_EQ(train_top.cpu_data()[i], this->blob_top_->cpu_data()[i]);
+    }
+    // Backward finds the argmax again.
+    Blob<Dtype> top_diff(train_top.shape());
+    filler.Fill(&top_diff);
+    caffe_copy(top_diff.count(), top_diff.cpu_data(),
+        train_top.mutable_cpu_diff());
+    caffe_copy(top_diff.count(), top_diff.cpu_data(),
+        this->blob_top_->mutable_cpu_diff());
+    train_layer.Backward(train_top_vec, propagate_down,
+        this->blob_bottom_vec_);
+    Blob<Dtype> train_bottom;
+    train_bottom.CopyFrom(*this->blob_bottom_, true, true);
+    test_layer.Backward(this->blob_top_vec_, propagate_down,
+        this->blob_bottom_vec_);
+    for (int i = 0; i < this->blob_bottom_->count(); ++i) {
+      EXPECT_EQ(train_bottom.cpu_diff()[i],
+          this->blob_bottom_->cpu_diff()[i]);
+    }
+  }
+}
+
+TYPED_TEST(PoolingLayerTest, TestMultithreaded) {
+  typedef typename TypeParam::Dtype Dtype;
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  vector<bool> propagate_down(1, true);
+  for (int pool = PoolingParameter_PoolMethod_MAX;
+       pool <= PoolingParameter_PoolMethod_AVE; ++pool) {
+    LayerParameter layer_param;
+    layer_param.set_phase(TRAIN);
+    PoolingParameter* pooling_param = layer_param.mutable_pooling_param();
+    pooling_param->set_kernel_size(3);
+    pooling_param->set_stride(2);
+    pooling_param->set_pad(1);
+    pooling_param->set_pool(static_cast<PoolingParameter_PoolMethod>(pool));
+    PoolingLayer<Dtype> layer(layer_param);
+    Blob<Dtype> top;
+    vector<Blob<Dtype>*> top_vec(1, &top);
+    layer.SetUp(this->blob_bottom_vec_, top_vec);
+    layer.Forward(this->blob_bottom_vec_, top_vec);
+    Blob<Dtype> top_diff(top.shape());
+    filler.Fill(&top_diff);
+    caffe_copy(top_diff.count(), top_diff.cpu_data(), top.mutable_cpu_diff());
+    layer.Backward(top_vec, propagate_down, this->blob_bottom_vec_);
+    Blob<Dtype> bottom;
+    bottom.CopyFrom(*this->blob_bottom_, true, true);
+    // More threads than planes leaves some of them without work.
+    for (int num_threads = 3; num_threads <= 8; num_threads += 5) {
+      pooling_param->set_num_threads(num_threads);
+      PoolingLayer<Dtype> threaded_layer(layer_param);
+      threaded_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+      threaded_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      for (int i = 0; i < top.count(); ++i) {
+        EXPECT_EQ(top.cpu_data()[i], this->blob_top_->cpu_data()[i]);
+      }
+      caffe_copy(top_diff.count(), top_diff.cpu_data(),
+          this->blob_top_->mutable_cpu_diff());
+      threaded_layer.Backward(this->blob_top_vec_, propagate_down,
+          this->blob_bottom_vec_);
+      for (int i = 0; i < this->blob_bottom_->count(); ++i) {
+        EXPECT_EQ(bottom.cpu_diff()[i], this->blob_bottom_->cpu_diff()[i]);
+      }
+    }
+  }
+}
+
 #ifdef USE_CUDNN
 template <typename Dtype>
 class CuDNNPoolingLayerTest : public GPUDeviceTest<Dtype> {
@@ -0,0 +1,90 @@
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/util/quantize.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class QuantizeTest : public CPUDeviceTest<Dtype> {};
+
+TYPED_TEST_CASE(QuantizeTest, TestDtypes);
+
+TYPED_TEST(QuantizeTest, TestQuantize) {
+  const TypeParam x[] = {0, 1, -1, 0.4, 0.6, -0.6, 127, -127, 200, -200};
+  const int8_t expected[] = {0, 1, -1, 0, 1, -1, 127, -127, 127, -127};
+  int8_t q[10];
+  quantize_int8_cpu(10, x, TypeParam(1), q);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(expected[i], q[i]) << "x " << x[i];
+  }
+  EXPECT_EQ(TypeParam(1), int8_scale(TypeParam(0)));
+  EXPECT_EQ(TypeParam(2), int8_scale(TypeParam(254)));
+}
+
+TYPED_TEST(QuantizeTest, TestGemm) {
+  // Neither M nor N a multiple of the blocks, K longer than a chunk.
+  const int M = 5, N = 603, K = 70;
+  vector<int8_t> A(M * K), B(N * K);
+  for (int i = 0; i < M * K; ++i) {
+    A[i] = static_cast<int8_t>(i * 37 % 255 - 127);
+  }
+  for (int i = 0; i < N * K; ++i) {
+    B[i] = static_cast<int8_t>(i * 91 % 255 - 127);
+  }
+  vector<int32_t> C(M * N);
+  int8_gemm_cpu(M, N, K, &A[0], &B[0], &C[0]);
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      int32_t expected = 0;
+      for (int k = 0; k < K; ++k) {
+        expected += A[i * K + k] * B[j * K + k];
+      }
+      EXPECT_EQ(expected, C[i * N + j]);
+    }
+  }
+}
+
+TYPED_TEST(QuantizeTest, TestBlobProtoRoundTrip) {
+  Blob<TypeParam> blob(4, 3, 2, 5);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(&blob);
+  BlobProto proto;
+  QuantizeBlobProto(blob, &proto);
+  EXPECT_EQ(0, proto.data_size());
+  EXPECT_EQ(4, proto.int8_scale_size());
+  Blob<TypeParam> blob_quantized;
+  blob_quantized.FromProto(proto);
+  ASSERT_TRUE(blob_quantized.shape() == blob.shape());
+  // The int8 data is kept as it is, and written back as it is.
+  ASSERT_TRUE(blob_quantized.cpu_int8_data() != NULL);
+  BlobProto proto_again;
+  blob_quantized.ToProto(&proto_again);
+  EXPECT_EQ(proto.int8_data(), proto_again.int8_data());
+  EXPECT_EQ(4, proto_again.int8_scale_size());
+  EXPECT_EQ(0, proto_again.data_size());
+  // Every value is within half a step of its row.
+  blob_quantized.Widen();
+  EXPECT_TRUE(blob_quantized.cpu_int8_data() == NULL);
+  const int row_count = blob.count(1);
+  for (int i = 0; i < blob.count(); ++i) {
+    EXPECT_NEAR(blob.cpu_data()[i], blob_quantized.cpu_data()[i],
+        proto.int8_scale(i / row_count) / 2 + 1e-6);
+  }
+  blob_quantized.ToInt8(4);
+  for (int r = 0; r < 4; ++r) {
+    EXPECT_NEAR(proto.int8_scale(r), blob_quantized.cpu_int8_scales()[r],
+        1e-6);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/data_layers.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+#include "caffe/util/raw_dataset.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class RawDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  RawDataLayerTest()
+      : seed_(1701),
+        num_(5),
+        channels_(2),
+        height_(3),
+        width_(4),
+        blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    Caffe::set_random_seed(seed_);
+    MakeTempFilename(&filename_);
+  }
+
+  virtual ~RawDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  // Writes num_ samples; every element of sample i is i * 10 plus its index
+  // within the sample, and the label of sample i is i.
+  void WriteDataset(RawDatasetHeader::DataType data_type) {
+    const int count = channels_ * height_ * width_;
+    RawDatasetWriter writer(filename_, data_type, channels_, height_, width_);
+    vector<uint8_t> uint8_data(count);
+    vector<float> float_data(count);
+    for (int i = 0; i < num_; ++i) {
+      for (int j = 0; j < count; ++j) {
+        uint8_data[j] = i * 10 + j;
+        float_data[j] = i * 10 + j;
+      }
+      if (data_type == RawDatasetHeader::UINT8) {
+        writer.Write(&uint8_data[0], i);
+      } else {
+        writer.Write(&float_data[0], i);
+      }
+    }
+    writer.Close();
+  }
+
+  void TestRead(RawDatasetHeader::DataType data_type) {
+    const int batch_size = 3;
+    WriteDataset(data_type);
+    LayerParameter param;
+    RawDataParameter* raw_data_param = param.mutable_raw_data_param();
+    raw_data_param->set_source(filename_);
+    raw_data_param->set_batch_size(batch_size);
+    RawDataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(blob_top_data_->num(), batch_size);
+    EXPECT_EQ(blob_top_data_->channels(), channels_);
+    EXPECT_EQ(blob_top_data_->height(), height_);
+    EXPECT_EQ(blob_top_data_->width(), width_);
+    EXPECT_EQ(blob_top_label_->num(), batch_size);
+
+    const int count = channels_ * height_ * width_;
+    int sample = 0;
+    for (int iter = 0; iter < 4; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      for (int i = 0; i < batch_size; ++i) {
+        EXPECT_EQ(sample, blob_top_label_->cpu_data()[i]);
+        for (int j = 0; j < count; ++j) {
+          EXPECT_EQ(sample * 10 + j, blob_top_data_->cpu_data()[i * count + j])
+              << "debug: iter " << iter << " i " << i << " j " << j;
+        }
+        sample = (sample + 1) % num_;
+      }
+    }
+  }
+
+  int seed_;
+  int num_;
+  int channels_;
+  int height_;
+  int width_;
+  string filename_;
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(RawDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(RawDataLayerTest, TestDatasetRoundTrip) {
+  this->WriteDataset(RawDatasetHeader::UINT8);
+  RawDataset dataset;
+  dataset.Open(this->filename_);
+  EXPECT_EQ(this->num_, dataset.num());
+  EXPECT_EQ(this->channels_, dataset.channels());
+  EXPECT_EQ(this->height_, dataset.height());
+  EXPECT_EQ(this->width_, dataset.width());
+  EXPECT_EQ(RawDatasetHeader::UINT8, dataset.data_type());
+  EXPECT_EQ(0, dataset.header().record_stride % kRawDatasetRecordAlignment);
+  for (int i = 0; i < this->num_; ++i) {
+    EXPECT_EQ(0, reinterpret_cast<size_t>(dataset.record(i)) %
+        kRawDatasetRecordAlignment);
+    EXPECT_EQ(i, dataset.label(i));
+    const uint8_t* record = static_cast<const uint8_t*>(dataset.record(i));
+    for (int j = 0; j < dataset.sample_count(); ++j) {
+      EXPECT_EQ(i * 10 + j, record[j]);
+    }
+  }
+}
+
+TYPED_TEST(RawDataLayerTest, TestReadUInt8) {
+  this->TestRead(RawDatasetHeader::UINT8);
+}
+
+TYPED_TEST(RawDataLayerTest, TestReadFloat) {
+  this->TestRead(RawDatasetHeader::FLOAT32);
+}
+
+TYPED_TEST(RawDataLayerTest, TestMeanValueAndScale) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->WriteDataset(RawDatasetHeader::UINT8);
+  LayerParameter param;
+  RawDataParameter* raw_data_param = param.mutable_raw_data_param();
+  raw_data_param->set_source(this->filename_);
+  raw_data_param->set_batch_size(1);
+  TransformationParameter* transform_param = param.mutable_transform_param();
+  transform_param->set_scale(0.5);
+  transform_param->add_mean_value(1);
+  transform_param->add_mean_value(3);
+  RawDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const int dim = this->height_ * this->width_;
+  for (int c = 0; c < this->channels_; ++c) {
+    for (int j = 0; j < dim; ++j) {
+      const Dtype mean = c == 0 ? 1 : 3;
+      EXPECT_EQ((c * dim + j - mean) * Dtype(0.5),
+          this->blob_top_data_->cpu_data()[c * dim + j]);
+    }
+  }
+}
+
+TYPED_TEST(RawDataLayerTest, TestShuffle) {
+  typedef typename TypeParam::Dtype Dtype;
+  this->WriteDataset(RawDatasetHeader::FLOAT32);
+  LayerParameter param;
+  RawDataParameter* raw_data_param = param.mutable_raw_data_param();
+  raw_data_param->set_source(this->filename_);
+  raw_data_param->set_batch_size(this->num_);
+  raw_data_param->set_shuffle(true);
+  RawDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  const int count = this->channels_ * this->height_ * this->width_;
+  // Every epoch visits each sample once, with its own data.
+  for (int iter = 0; iter < 3; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    vector<int> labels;
+    for (int i = 0; i < this->num_; ++i) {
+      const int label = this->blob_top_label_->cpu_data()[i];
+      labels.push_back(label);
+      EXPECT_EQ(label * 10, this->blob_top_data_->cpu_data()[i * count]);
+    }
+    std::sort(labels.begin(), labels.end());
+    for (int i = 0; i < this->num_; ++i) {
+      EXPECT_EQ(i, labels[i]);
+    }
+  }
+}
+
+}  // namespace caffe
@@ -7,6 +7,7 @@
 #include "caffe/blob.hpp"
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
+#include "caffe/util/softmax.hpp"
 #include "caffe/vision_layers.hpp"
 
 #include "caffe/test/test_caffe_main.hpp"
@@ -80,6 +81,76 @@ TYPED_TEST(SoftmaxLayerTest, TestGradient) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(SoftmaxLayerTest, TestForwardMultithreaded) {
+  typedef typename TypeParam::Dtype Dtype;
+  // More positions than are processed in a block, split over threads; then
+  // one row of channels per position.
+  for (int axis = 1; axis <= 3; axis += 2) {
+    this->blob_bottom_->Reshape(3, 7, 9, 11);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(this->blob_bottom_);
+    LayerParameter layer_param;
+    layer_param.mutable_softmax_param()->set_axis(axis);
+    layer_param.mutable_softmax_param()->set_num_threads(3);
+    SoftmaxLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const int outer_num = this->blob_bottom_->count(0, axis);
+    const int channels = this->blob_bottom_->shape(axis);
+    const int inner_num = this->blob_bottom_->count(axis + 1);
+    const Dtype* bottom_data = this->blob_bottom_->cpu_data();
+    const Dtype* top_data = this->blob_top_->cpu_data();
+    for (int i = 0; i < outer_num; ++i) {
+      for (int k = 0; k < inner_num; ++k) {
+        const int offset = i * channels * inner_num + k;
+        Dtype scale = 0;
+        for (int j = 0; j < channels; ++j) {
+          scale += exp(bottom_data[offset + j * inner_num]);
+        }
+        for (int j = 0; j < channels; ++j) {
+          EXPECT_NEAR(exp(bottom_data[offset + j * inner_num]) / scale,
+              top_data[offset + j * inner_num], 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(SoftmaxLayerTest, TestLogSoftmax) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Positions in a block, and rows longer than a block.
+  const int shapes[][3] = {{2, 10, 70}, {3, 100, 1}};
+  for (int s = 0; s < 2; ++s) {
+    const int outer_num = shapes[s][0];
+    const int channels = shapes[s][1];
+    const int inner_num = shapes[s][2];
+    Blob<Dtype> input(outer_num, channels, inner_num, 1);
+    FillerParameter filler_param;
+    filler_param.set_std(10);
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(&input);
+    Blob<Dtype> prob(input.shape());
+    Blob<Dtype> log_norm(outer_num, inner_num, 1, 1);
+    caffe_cpu_softmax(outer_num, channels, inner_num, input.cpu_data(),
+        prob.mutable_cpu_data(), log_norm.mutable_cpu_data());
+    Blob<Dtype> log_prob(input.shape());
+    caffe_cpu_log_softmax(outer_num, channels, inner_num, input.cpu_data(),
+        log_prob.mutable_cpu_data());
+    for (int i = 0; i < outer_num; ++i) {
+      for (int j = 0; j < channels; ++j) {
+        for (int k = 0; k < inner_num; ++k) {
+          const int index = (i * channels + j) * inner_num + k;
+          const Dtype expected = input.cpu_data()[index] -
+              log_norm.cpu_data()[i * inner_num + k];
+          EXPECT_NEAR(expected, log_prob.cpu_data()[index], 1e-4);
+          EXPECT_NEAR(exp(expected), prob.cpu_data()[index], 1e-5);
+        }
+      }
+    }
+  }
+}
+
 #ifdef USE_CUDNN
 template <typename Dtype>
 class CuDNNSoftmaxLayerTest : public GPUDeviceTest<Dtype> {
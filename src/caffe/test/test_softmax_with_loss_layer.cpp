@@ -63,6 +63,34 @@ TYPED_TEST(SoftmaxWithLossLayerTest, TestGradient) {
       this->blob_top_vec_, 0);
 }
 
+TYPED_TEST(SoftmaxWithLossLayerTest, TestForward) {
+  typedef typename TypeParam::Dtype Dtype;
+  Dtype expected_loss = 0;
+  for (int n = 0; n < 10; ++n) {
+    for (int h = 0; h < 2; ++h) {
+      for (int w = 0; w < 3; ++w) {
+        Dtype scale = 0;
+        for (int c = 0; c < 5; ++c) {
+          scale += exp(this->blob_bottom_data_->data_at(n, c, h, w));
+        }
+        const int label = this->blob_bottom_label_->data_at(n, 0, h, w);
+        expected_loss -= log(
+            exp(this->blob_bottom_data_->data_at(n, label, h, w)) / scale);
+      }
+    }
+  }
+  expected_loss /= this->blob_bottom_label_->count();
+  for (int num_threads = 1; num_threads <= 2; ++num_threads) {
+    LayerParameter layer_param;
+    layer_param.mutable_softmax_param()->set_num_threads(num_threads);
+    SoftmaxWithLossLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    EXPECT_NEAR(expected_loss, this->blob_top_loss_->cpu_data()[0],
+        1e-4 * expected_loss);
+  }
+}
+
 TYPED_TEST(SoftmaxWithLossLayerTest, TestForwardIgnoreLabel) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -0,0 +1,42 @@
+#include <boost/bind.hpp>
+
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "caffe/util/thread_pool.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+class ThreadPoolTest : public ::testing::Test {};
+
+void IncrementCount(vector<int>* counts, int index) {
+  ++(*counts)[index];
+}
+
+TEST_F(ThreadPoolTest, TestRunsEveryTaskOnce) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.size(), 4);
+  for (int num_tasks = 0; num_tasks < 20; ++num_tasks) {
+    vector<int> counts(num_tasks, 0);
+    pool.Run(num_tasks, boost::bind(&IncrementCount, &counts, _1));
+    for (int i = 0; i < num_tasks; ++i) {
+      EXPECT_EQ(counts[i], 1) << "num_tasks " << num_tasks << " task " << i;
+    }
+  }
+}
+
+TEST_F(ThreadPoolTest, TestSingleThread) {
+  ThreadPool pool(1);
+  EXPECT_EQ(pool.size(), 1);
+  vector<int> counts(7, 0);
+  pool.Run(7, boost::bind(&IncrementCount, &counts, _1));
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(counts[i], 1);
+  }
+}
+
+}  // namespace caffe
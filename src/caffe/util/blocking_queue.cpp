@@ -0,0 +1,95 @@
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+
+#include "caffe/data_layers.hpp"
+#include "caffe/inference_server.hpp"
+#include "caffe/util/blocking_queue.hpp"
+
+namespace caffe {
+
+template <typename T>
+class BlockingQueue<T>::sync {
+ public:
+  mutable boost::mutex mutex_;
+  boost::condition_variable condition_;
+};
+
+template <typename T>
+BlockingQueue<T>::BlockingQueue()
+    : sync_(new sync()) {
+}
+
+template <typename T>
+void BlockingQueue<T>::push(const T& t) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  queue_.push(t);
+  lock.unlock();
+  sync_->condition_.notify_one();
+}
+
+template <typename T>
+bool BlockingQueue<T>::try_pop(T* t) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+
+  if (queue_.empty()) {
+    return false;
+  }
+
+  *t = queue_.front();
+  queue_.pop();
+  return true;
+}
+
+template <typename T>
+bool BlockingQueue<T>::try_pop_for(T* t, int timeout_us) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  // A steady clock, so that changes to the wall clock do not move the
+  // deadline.
+  const boost::chrono::steady_clock::time_point deadline =
+      boost::chrono::steady_clock::now() +
+      boost::chrono::microseconds(timeout_us);
+  while (queue_.empty()) {
+    if (sync_->condition_.wait_until(lock, deadline) ==
+        boost::cv_status::timeout) {
+      break;
+    }
+  }
+  if (queue_.empty()) {
+    return false;
+  }
+
+  *t = queue_.front();
+  queue_.pop();
+  return true;
+}
+
+template <typename T>
+T BlockingQueue<T>::pop(const string& log_on_wait) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+
+  while (queue_.empty()) {
+    if (!log_on_wait.empty()) {
+      LOG_EVERY_N(INFO, 1000) << log_on_wait;
+    }
+    sync_->condition_.wait(lock);
+  }
+
+  T t = queue_.front();
+  queue_.pop();
+  return t;
+}
+
+template <typename T>
+size_t BlockingQueue<T>::size() const {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  return queue_.size();
+}
+
+template class BlockingQueue<Batch<float>*>;
+template class BlockingQueue<Batch<double>*>;
+template class BlockingQueue<shared_ptr<InferenceFuture<float> > >;
+template class BlockingQueue<shared_ptr<InferenceFuture<double> > >;
+
+}  // namespace caffe
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cstring>
+
+#include "caffe/util/direct_conv.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The number of output channels computed together, so that every input
+// value loaded feeds that many accumulators.
+const int kOutputBlock = 4;
+// The number of output columns computed together. The accumulators of a
+// tile are arrays of constant size on the stack, which the compiler knows
+// not to alias the input and vectorizes over even at -O2.
+const int kTile = 8;
+
+// The range [begin, end) of output columns whose input column
+// ow * stride - pad + offset lies inside [0, width).
+inline void ValidColumns(const int width, const int width_out,
+    const int pad, const int stride, const int offset, int* begin,
+    int* end) {
+  const int before = pad - offset;
+  *begin = before > 0 ? (before + stride - 1) / stride : 0;
+  const int last = width - 1 + pad - offset;
+  *end = last < 0 ? 0 : std::min(width_out, last / stride + 1);
+  *begin = std::min(*begin, *end);
+}
+
+// Adds one input plane convolved with one filter to an output plane.
+template <typename Dtype>
+void ConvPlane(const Dtype* in, const int height, const int width,
+    const Dtype* filter, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w, const int stride_h, const int stride_w,
+    Dtype* out, const int height_out, const int width_out) {
+  for (int kh = 0; kh < kernel_h; ++kh) {
+    for (int kw = 0; kw < kernel_w; ++kw) {
+      const Dtype weight = filter[kh * kernel_w + kw];
+      int ow_begin, ow_end;
+      ValidColumns(width, width_out, pad_w, stride_w, kw, &ow_begin, &ow_end);
+      for (int oh = 0; oh < height_out; ++oh) {
+        const int ih = oh * stride_h - pad_h + kh;
+        if (ih < 0 || ih >= height) {
+          continue;
+        }
+        const Dtype* in_row = in + ih * width + kw - pad_w;
+        Dtype* out_row = out + oh * width_out;
+        if (stride_w == 1) {
+          for (int ow = ow_begin; ow < ow_end; ++ow) {
+            out_row[ow] += weight * in_row[ow];
+          }
+        } else {
+          for (int ow = ow_begin; ow < ow_end; ++ow) {
+            out_row[ow] += weight * in_row[ow * stride_w];
+          }
+        }
+      }
+    }
+  }
+}
+
+// ConvPlane for 3x3 filters with stride 1: the interior of each output row
+// takes all the taps of its valid input rows in one pass.
+template <typename Dtype>
+void ConvPlane3x3(const Dtype* in, const int height, const int width,
+    const Dtype* filter, const int pad_h, const int pad_w, Dtype* out,
+    const int height_out, const int width_out) {
+  // Columns where all three taps of a row are inside the image.
+  int ow_begin, ow_end;
+  ValidColumns(width - 2, width_out, pad_w, 1, 0, &ow_begin, &ow_end);
+  for (int oh = 0; oh < height_out; ++oh) {
+    Dtype* out_row = out + oh * width_out;
+    const Dtype* rows[3];
+    int num_rows = 0;
+    const Dtype* row_filters[3];
+    for (int kh = 0; kh < 3; ++kh) {
+      const int ih = oh - pad_h + kh;
+      if (ih >= 0 && ih < height) {
+        rows[num_rows] = in + ih * width - pad_w;
+        row_filters[num_rows] = filter + kh * 3;
+        ++num_rows;
+      }
+    }
+    if (num_rows == 3) {
+      const Dtype* r0 = rows[0];
+      const Dtype* r1 = rows[1];
+      const Dtype* r2 = rows[2];
+      const Dtype w00 = filter[0], w01 = filter[1], w02 = filter[2];
+      const Dtype w10 = filter[3], w11 = filter[4], w12 = filter[5];
+      const Dtype w20 = filter[6], w21 = filter[7], w22 = filter[8];
+      for (int ow = ow_begin; ow < ow_end; ++ow) {
+        out_row[ow] += w00 * r0[ow] + w01 * r0[ow + 1] + w02 * r0[ow + 2]
+            + w10 * r1[ow] + w11 * r1[ow + 1] + w12 * r1[ow + 2]
+            + w20 * r2[ow] + w21 * r2[ow + 1] + w22 * r2[ow + 2];
+      }
+    } else {
+      for (int r = 0; r < num_rows; ++r) {
+        const Dtype* row = rows[r];
+        const Dtype w0 = row_filters[r][0];
+        const Dtype w1 = row_filters[r][1];
+        const Dtype w2 = row_filters[r][2];
+        for (int ow = ow_begin; ow < ow_end; ++ow) {
+          out_row[ow] += w0 * row[ow] + w1 * row[ow + 1] + w2 * row[ow + 2];
+        }
+      }
+    }
+    // The border columns, tap by tap.
+    for (int r = 0; r < num_rows; ++r) {
+      for (int kw = 0; kw < 3; ++kw) {
+        const Dtype weight = row_filters[r][kw];
+        const Dtype* row = rows[r] + kw;
+        for (int ow = 0; ow < ow_begin; ++ow) {
+          const int iw = ow - pad_w + kw;
+          if (iw >= 0 && iw < width) {
+            out_row[ow] += weight * row[ow];
+          }
+        }
+        for (int ow = ow_end; ow < width_out; ++ow) {
+          const int iw = ow - pad_w + kw;
+          if (iw >= 0 && iw < width) {
+            out_row[ow] += weight * row[ow];
+          }
+        }
+      }
+    }
+  }
+}
+
+// The range [begin, end) of output columns all of whose kernel_w taps,
+// ow * stride - pad + kw, lie inside [0, width).
+inline void InteriorColumns(const int width, const int width_out,
+    const int kernel_w, const int pad, const int stride, int* begin,
+    int* end) {
+  *begin = (pad + stride - 1) / stride;
+  const int last = width - kernel_w + pad;
+  *end = last < 0 ? 0 : std::min(width_out, last / stride + 1);
+  *begin = std::min(*begin, *end);
+}
+
+struct ConvGeometry {
+  int channels;  // per group
+  int height;
+  int width;
+  int kernel_h;
+  int kernel_w;
+  int pad_h;
+  int pad_w;
+  int stride_h;
+  int stride_w;
+  int height_out;
+  int width_out;
+};
+
+// Output row oh of the kOutputBlock outputs whose filters are filter_stride
+// apart and whose planes are out_stride apart, from the channels of a group.
+template <typename Dtype>
+void ConvRow(const ConvGeometry& geo, const Dtype* in, const Dtype* filters,
+    const int filter_stride, const int oh, Dtype* out, const int out_stride) {
+  const int kernel_size = geo.kernel_h * geo.kernel_w;
+  const int ih0 = oh * geo.stride_h - geo.pad_h;
+  const int kh_begin = std::max(0, -ih0);
+  const int kh_end = std::min(geo.kernel_h, geo.height - ih0);
+  Dtype* out_row = out + oh * geo.width_out;
+  int col_begin, col_end;
+  InteriorColumns(geo.width, geo.width_out, geo.kernel_w, geo.pad_w,
+      geo.stride_w, &col_begin, &col_end);
+  int ow0 = col_begin;
+  for (; ow0 + kTile <= col_end; ow0 += kTile) {
+    Dtype acc[kOutputBlock][kTile];
+    for (int b = 0; b < kOutputBlock; ++b) {
+      for (int k = 0; k < kTile; ++k) {
+        acc[b][k] = 0;
+      }
+    }
+    for (int c = 0; c < geo.channels; ++c) {
+      for (int kh = kh_begin; kh < kh_end; ++kh) {
+        const Dtype* row = in + (c * geo.height + ih0 + kh) * geo.width +
+            ow0 * geo.stride_w - geo.pad_w;
+        const Dtype* filter = filters + c * kernel_size + kh * geo.kernel_w;
+        for (int kw = 0; kw < geo.kernel_w; ++kw) {
+          Dtype x[kTile];
+          if (geo.stride_w == 1) {
+            memcpy(x, row + kw, sizeof(x));
+          } else {
+            for (int k = 0; k < kTile; ++k) {
+              x[k] = row[k * geo.stride_w + kw];
+            }
+          }
+          for (int b = 0; b < kOutputBlock; ++b) {
+            const Dtype weight = filter[b * filter_stride + kw];
+            for (int k = 0; k < kTile; ++k) {
+              acc[b][k] += weight * x[k];
+            }
+          }
+        }
+      }
+    }
+    for (int b = 0; b < kOutputBlock; ++b) {
+      memcpy(out_row + b * out_stride + ow0, acc[b], sizeof(acc[b]));
+    }
+  }
+  // The border columns and those left over from the tiles, one at a time.
+  for (int ow = 0; ow < geo.width_out; ++ow) {
+    if (ow == col_begin) {
+      ow = ow0;
+      if (ow == geo.width_out) {
+        break;
+      }
+    }
+    const int iw0 = ow * geo.stride_w - geo.pad_w;
+    const int kw_begin = std::max(0, -iw0);
+    const int kw_end = std::min(geo.kernel_w, geo.width - iw0);
+    for (int b = 0; b < kOutputBlock; ++b) {
+      const Dtype* filter_b = filters + b * filter_stride;
+      Dtype sum = 0;
+      for (int c = 0; c < geo.channels; ++c) {
+        for (int kh = kh_begin; kh < kh_end; ++kh) {
+          const Dtype* row = in + (c * geo.height + ih0 + kh) * geo.width +
+              iw0;
+          const Dtype* filter = filter_b + c * kernel_size +
+              kh * geo.kernel_w;
+          for (int kw = kw_begin; kw < kw_end; ++kw) {
+            sum += filter[kw] * row[kw];
+          }
+        }
+      }
+      out_row[b * out_stride + ow] = sum;
+    }
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+void conv_direct_cpu(const Dtype* data_im, const int channels,
+    const int height, const int width, const int num_output, const int group,
+    const int kernel_h, const int kernel_w, const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w, const Dtype* weights,
+    Dtype* data_out) {
+  ConvGeometry geo;
+  geo.channels = channels / group;
+  geo.height = height;
+  geo.width = width;
+  geo.kernel_h = kernel_h;
+  geo.kernel_w = kernel_w;
+  geo.pad_h = pad_h;
+  geo.pad_w = pad_w;
+  geo.stride_h = stride_h;
+  geo.stride_w = stride_w;
+  geo.height_out = (height + 2 * pad_h - kernel_h) / stride_h + 1;
+  geo.width_out = (width + 2 * pad_w - kernel_w) / stride_w + 1;
+  const int outputs_per_group = num_output / group;
+  const int kernel_size = kernel_h * kernel_w;
+  const int filter_size = geo.channels * kernel_size;
+  const int out_size = geo.height_out * geo.width_out;
+  const bool is_3x3s1 = kernel_h == 3 && kernel_w == 3 && stride_h == 1 &&
+      stride_w == 1;
+  for (int g = 0; g < group; ++g) {
+    const Dtype* in = data_im + g * geo.channels * height * width;
+    const int o_end = (g + 1) * outputs_per_group;
+    int o = g * outputs_per_group;
+    // Blocks of outputs, tile by tile.
+    for (; o + kOutputBlock <= o_end; o += kOutputBlock) {
+      for (int oh = 0; oh < geo.height_out; ++oh) {
+        ConvRow(geo, in, weights + o * filter_size, filter_size, oh,
+            data_out + o * out_size, out_size);
+      }
+    }
+    // The remaining outputs (all of them when there are few per group, as
+    // in depthwise convolutions) plane by plane.
+    for (; o < o_end; ++o) {
+      Dtype* out = data_out + o * out_size;
+      caffe_set(out_size, Dtype(0), out);
+      for (int c = 0; c < geo.channels; ++c) {
+        const Dtype* in_c = in + c * height * width;
+        const Dtype* filter = weights + o * filter_size + c * kernel_size;
+        if (is_3x3s1) {
+          ConvPlane3x3(in_c, height, width, filter, pad_h, pad_w, out,
+              geo.height_out, geo.width_out);
+        } else {
+          ConvPlane(in_c, height, width, filter, kernel_h, kernel_w, pad_h,
+              pad_w, stride_h, stride_w, out, geo.height_out, geo.width_out);
+        }
+      }
+    }
+  }
+}
+
+// Explicit instantiation
+template void conv_direct_cpu<float>(const float* data_im,
+    const int channels, const int height, const int width,
+    const int num_output, const int group, const int kernel_h,
+    const int kernel_w, const int pad_h, const int pad_w, const int stride_h,
+    const int stride_w, const float* weights, float* data_out);
+template void conv_direct_cpu<double>(const double* data_im,
+    const int channels, const int height, const int width,
+    const int num_output, const int group, const int kernel_h,
+    const int kernel_w, const int pad_h, const int pad_w, const int stride_h,
+    const int stride_w, const double* weights, double* data_out);
+
+bool conv_direct_cpu_preferred(const int channels_per_group,
+    const int outputs_per_group, const int kernel_h, const int kernel_w,
+    const int stride_h, const int stride_w) {
+  return channels_per_group <= 2 && outputs_per_group <= 2 &&
+      kernel_h <= 5 && kernel_w <= 5 && stride_h == 1 && stride_w == 1;
+}
+
+}  // namespace caffe
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/fft.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The twiddle factors exp(-2 pi i k / n) for k < n / 2, and the bit reversal
+// permutation of [0, n).
+template <typename Dtype>
+void InitTransform(const int n, std::vector<std::complex<Dtype> >* twiddles,
+    std::vector<int>* reversal) {
+  twiddles->resize(n / 2);
+  for (int k = 0; k < n / 2; ++k) {
+    const double angle = -2. * M_PI * k / n;
+    (*twiddles)[k] = std::complex<Dtype>(cos(angle), sin(angle));
+  }
+  int bits = 0;
+  while ((1 << bits) < n) {
+    ++bits;
+  }
+  reversal->resize(n);
+  for (int i = 0; i < n; ++i) {
+    int reversed = 0;
+    for (int b = 0; b < bits; ++b) {
+      reversed |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    (*reversal)[i] = reversed;
+  }
+}
+
+}  // namespace
+
+int fft_size(const int n) {
+  int size = 1;
+  while (size < n) {
+    size <<= 1;
+  }
+  return size;
+}
+
+template <typename Dtype>
+FFT2D<Dtype>::FFT2D(const int height, const int width)
+    : height_(height), width_(width) {
+  CHECK_EQ(height, fft_size(height)) << "FFT height must be a power of 2";
+  CHECK_EQ(width, fft_size(width)) << "FFT width must be a power of 2";
+  InitTransform(width_, &row_twiddles_, &row_reversal_);
+  InitTransform(height_, &col_twiddles_, &col_reversal_);
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::Transform1D(Complex* data, const int n, const int stride,
+    const std::vector<Complex>& twiddles, const std::vector<int>& reversal,
+    const bool inverse) const {
+  for (int i = 0; i < n; ++i) {
+    const int j = reversal[i];
+    if (i < j) {
+      std::swap(data[i * stride], data[j * stride]);
+    }
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    const int half = len / 2;
+    const int step = n / len;
+    for (int i = 0; i < n; i += len) {
+      for (int k = 0; k < half; ++k) {
+        const Complex w = twiddles[k * step];
+        const Dtype w_imag = inverse ? -w.imag() : w.imag();
+        Complex* a = data + (i + k) * stride;
+        Complex* b = a + half * stride;
+        // Spelled out, as the complex operator* guards against infinities
+        // and NaNs at a high cost.
+        const Complex t(b->real() * w.real() - b->imag() * w_imag,
+            b->real() * w_imag + b->imag() * w.real());
+        *b = *a - t;
+        *a += t;
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::Transform(Complex* data, const bool inverse) const {
+  for (int y = 0; y < height_; ++y) {
+    Transform1D(data + y * width_, width_, 1, row_twiddles_, row_reversal_,
+        inverse);
+  }
+  for (int x = 0; x < width_; ++x) {
+    Transform1D(data + x, height_, width_, col_twiddles_, col_reversal_,
+        inverse);
+  }
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::Forward(Complex* data) const {
+  Transform(data, false);
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::Inverse(Complex* data) const {
+  Transform(data, true);
+  const Dtype scale = Dtype(1) / (height_ * width_);
+  for (int i = 0; i < height_ * width_; ++i) {
+    data[i] *= scale;
+  }
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::ForwardReal(Complex* data, Complex* half_a,
+    Complex* half_b) const {
+  Forward(data);
+  // With Z the spectrum of a + i b, the spectra of the real a and b are
+  // (Z(k) + conj(Z(-k))) / 2 and (Z(k) - conj(Z(-k))) / 2i.
+  const int half_width = width_ / 2 + 1;
+  for (int u = 0; u < height_; ++u) {
+    const Complex* row = data + u * width_;
+    const Complex* mirror_row = data + ((height_ - u) % height_) * width_;
+    for (int v = 0; v < half_width; ++v) {
+      const Complex z = row[v];
+      const Complex z_mirror = std::conj(mirror_row[(width_ - v) % width_]);
+      half_a[u * half_width + v] = (z + z_mirror) * Dtype(0.5);
+      if (half_b) {
+        const Complex d = z - z_mirror;
+        half_b[u * half_width + v] = Complex(d.imag(), -d.real()) * Dtype(0.5);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void FFT2D<Dtype>::InverseReal(const Complex* half_a, const Complex* half_b,
+    Complex* data) const {
+  // The spectra of real arrays are Hermitian: the missing half is the
+  // conjugate of the given one, mirrored.
+  const int half_width = width_ / 2 + 1;
+  for (int u = 0; u < height_; ++u) {
+    const int mirror_u = (height_ - u) % height_;
+    for (int v = 0; v < width_; ++v) {
+      Complex a, b;
+      if (v < half_width) {
+        a = half_a[u * half_width + v];
+        b = half_b ? half_b[u * half_width + v] : Complex();
+      } else {
+        const int mirror = mirror_u * half_width + width_ - v;
+        a = std::conj(half_a[mirror]);
+        b = half_b ? std::conj(half_b[mirror]) : Complex();
+      }
+      data[u * width_ + v] = Complex(a.real() - b.imag(), a.imag() + b.real());
+    }
+  }
+  Inverse(data);
+}
+
+INSTANTIATE_CLASS(FFT2D);
+
+}  // namespace caffe
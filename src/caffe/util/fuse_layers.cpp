@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "caffe/common.hpp"
+#include "caffe/util/fuse_layers.hpp"
+
+namespace caffe {
+
+namespace {
+
+// Whether the layer is created as one that applies a fused_activation.
+bool AppliesFusedActivation(const LayerParameter& layer_param) {
+  if (layer_param.type() == "InnerProduct") {
+    return !layer_param.inner_product_param().has_fused_activation();
+  }
+  if (layer_param.type() != "Convolution" ||
+      layer_param.convolution_param().has_fused_activation()) {
+    return false;
+  }
+  switch (layer_param.convolution_param().engine()) {
+  case ConvolutionParameter_Engine_DEFAULT:
+#ifdef USE_CUDNN
+    return false;
+#else
+    return true;
+#endif
+  case ConvolutionParameter_Engine_CAFFE:
+  case ConvolutionParameter_Engine_FFT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Whether the layer is an in-place activation that can be fused, and which.
+bool GetFusableActivation(const LayerParameter& layer_param,
+    FusedActivationParameter* activation) {
+  if (layer_param.bottom_size() != 1 || layer_param.top_size() != 1 ||
+      layer_param.bottom(0) != layer_param.top(0) ||
+      layer_param.loss_weight_size() > 0) {
+    return false;
+  }
+  if (layer_param.type() == "ReLU") {
+    activation->set_type(FusedActivationParameter_Type_RELU);
+    activation->set_negative_slope(layer_param.relu_param().negative_slope());
+  } else if (layer_param.type() == "TanH") {
+    activation->set_type(FusedActivationParameter_Type_TANH);
+  } else if (layer_param.type() == "Sigmoid") {
+    activation->set_type(FusedActivationParameter_Type_SIGMOID);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+template <typename Dtype>
+inline Dtype sigmoid(Dtype x) {
+  return 1. / (1. + exp(-x));
+}
+
+}  // namespace
+
+void FuseLayers(const NetParameter& param, NetParameter* param_fused) {
+  param_fused->CopyFrom(param);
+  param_fused->clear_layer();
+  vector<bool> fused(param.layer_size(), false);
+  for (int i = 0; i < param.layer_size(); ++i) {
+    if (fused[i]) {
+      continue;
+    }
+    LayerParameter* layer_param = param_fused->add_layer();
+    layer_param->CopyFrom(param.layer(i));
+    if (!AppliesFusedActivation(*layer_param) ||
+        layer_param->top_size() != 1) {
+      continue;
+    }
+    // The first later layer that reads the output takes it if it is an
+    // in-place activation.
+    const string& blob_name = layer_param->top(0);
+    for (int j = i + 1; j < param.layer_size(); ++j) {
+      const LayerParameter& next_param = param.layer(j);
+      if (std::find(next_param.bottom().begin(), next_param.bottom().end(),
+          blob_name) == next_param.bottom().end()) {
+        continue;
+      }
+      FusedActivationParameter activation;
+      if (GetFusableActivation(next_param, &activation)) {
+        if (layer_param->type() == "Convolution") {
+          layer_param->mutable_convolution_param()->mutable_fused_activation()
+              ->CopyFrom(activation);
+        } else {
+          layer_param->mutable_inner_product_param()
+              ->mutable_fused_activation()->CopyFrom(activation);
+        }
+        fused[j] = true;
+        LOG(INFO) << "Fusing " << next_param.type() << " layer "
+            << next_param.name() << " into " << layer_param->type()
+            << " layer " << layer_param->name();
+      }
+      break;
+    }
+  }
+}
+
+template <typename Dtype>
+void bias_activation_cpu(const FusedActivationParameter& activation,
+    const int outer, const int channels, const int inner, const Dtype* bias,
+    Dtype* data) {
+  const Dtype negative_slope = activation.negative_slope();
+  for (int n = 0; n < outer; ++n) {
+    for (int c = 0; c < channels; ++c) {
+      const Dtype b = bias ? bias[c] : Dtype(0);
+      Dtype* x = data + (n * channels + c) * inner;
+      switch (activation.type()) {
+      case FusedActivationParameter_Type_RELU:
+        for (int i = 0; i < inner; ++i) {
+          const Dtype v = x[i] + b;
+          x[i] = std::max(v, Dtype(0)) + negative_slope * std::min(v, Dtype(0));
+        }
+        break;
+      case FusedActivationParameter_Type_TANH:
+        for (int i = 0; i < inner; ++i) {
+          x[i] = tanh(x[i] + b);
+        }
+        break;
+      case FusedActivationParameter_Type_SIGMOID:
+        for (int i = 0; i < inner; ++i) {
+          x[i] = sigmoid(x[i] + b);
+        }
+        break;
+      default:
+        for (int i = 0; i < inner; ++i) {
+          x[i] += b;
+        }
+      }
+    }
+  }
+}
+
+template void bias_activation_cpu<float>(
+    const FusedActivationParameter& activation, const int outer,
+    const int channels, const int inner, const float* bias, float* data);
+template void bias_activation_cpu<double>(
+    const FusedActivationParameter& activation, const int outer,
+    const int channels, const int inner, const double* bias, double* data);
+
+}  // namespace caffe
@@ -0,0 +1,49 @@
+#include "caffe/common.hpp"
+#include "caffe/util/fuse_layers.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+__global__ void BiasActivationForward(const int n, const int type,
+    const Dtype negative_slope, const int channels, const int inner,
+    const Dtype* bias, Dtype* data) {
+  CUDA_KERNEL_LOOP(index, n) {
+    Dtype v = data[index];
+    if (bias) {
+      v += bias[(index / inner) % channels];
+    }
+    switch (type) {
+    case FusedActivationParameter_Type_RELU:
+      v = v > 0 ? v : v * negative_slope;
+      break;
+    case FusedActivationParameter_Type_TANH:
+      v = tanh(v);
+      break;
+    case FusedActivationParameter_Type_SIGMOID:
+      v = 1. / (1. + exp(-v));
+      break;
+    }
+    data[index] = v;
+  }
+}
+
+template <typename Dtype>
+void bias_activation_gpu(const FusedActivationParameter& activation,
+    const int outer, const int channels, const int inner, const Dtype* bias,
+    Dtype* data) {
+  const int count = outer * channels * inner;
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  BiasActivationForward<Dtype><<<CAFFE_GET_BLOCKS(count),
+      CAFFE_CUDA_NUM_THREADS>>>(count, activation.type(),
+      Dtype(activation.negative_slope()), channels, inner, bias, data);
+  CUDA_POST_KERNEL_CHECK;
+}
+
+template void bias_activation_gpu<float>(
+    const FusedActivationParameter& activation, const int outer,
+    const int channels, const int inner, const float* bias, float* data);
+template void bias_activation_gpu<double>(
+    const FusedActivationParameter& activation, const int outer,
+    const int channels, const int inner, const double* bias, double* data);
+
+}  // namespace caffe
@@ -0,0 +1,142 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "caffe/common.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The number of widened elements of B in one panel, sized to stay in cache
+// while the rows of A stream past it.
+const int kHalfGemmPanel = 1 << 15;
+
+// The rows of the N x K B in one panel.
+inline int panel_rows(const int N, const int K) {
+  return std::min(N, std::max(1, kHalfGemmPanel / K));
+}
+
+inline void gemm_panel(const int M, const int N, const int K,
+    const float alpha, const float* A, const float* B, const float beta,
+    float* C, const int ldc) {
+  cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, M, N, K, alpha, A, K,
+      B, K, beta, C, ldc);
+}
+
+inline void gemm_panel(const int M, const int N, const int K,
+    const double alpha, const double* A, const double* B, const double beta,
+    double* C, const int ldc) {
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, M, N, K, alpha, A, K,
+      B, K, beta, C, ldc);
+}
+
+}  // namespace
+
+uint16_t float_to_half(const float value) {
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  const uint16_t sign = (x >> 16) & 0x8000;
+  x &= 0x7fffffff;
+  if (x >= 0x7f800000) {
+    // Infinity, or NaN kept quiet.
+    return sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0);
+  }
+  if (x >= 0x477ff000) {
+    // Rounds beyond the largest half, 65504.
+    return sign | 0x7c00;
+  }
+  if (x < 0x38800000) {
+    // Below the smallest normal half, 2^-14: count steps of 2^-24.
+    float magnitude;
+    memcpy(&magnitude, &x, sizeof(magnitude));
+    const float steps = magnitude * 16777216.f;
+    int q = static_cast<int>(steps);
+    const float remainder = steps - q;
+    if (remainder > 0.5f || (remainder == 0.5f && (q & 1))) {
+      ++q;
+    }
+    return sign | static_cast<uint16_t>(q);
+  }
+  // Rebias the exponent from 127 to 15 and round the mantissa to 10 bits;
+  // a carry out of the mantissa correctly bumps the exponent.
+  x += 0xfff + ((x >> 13) & 1);
+  return sign | static_cast<uint16_t>((x - 0x38000000) >> 13);
+}
+
+float half_to_float(const uint16_t value) {
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+  if (exponent == 0) {
+    // Zero or subnormal.
+    const float magnitude = mantissa * (1.f / 16777216.f);
+    return sign ? -magnitude : magnitude;
+  }
+  uint32_t x;
+  if (exponent == 0x1f) {
+    x = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float result;
+  memcpy(&result, &x, sizeof(result));
+  return result;
+}
+
+template <typename Dtype>
+void caffe_cpu_float2half(const int n, const Dtype* x, uint16_t* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = float_to_half(static_cast<float>(x[i]));
+  }
+}
+
+template void caffe_cpu_float2half<float>(const int n, const float* x,
+    uint16_t* y);
+template void caffe_cpu_float2half<double>(const int n, const double* x,
+    uint16_t* y);
+
+template <typename Dtype>
+void caffe_cpu_half2float(const int n, const uint16_t* x, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = half_to_float(x[i]);
+  }
+}
+
+template void caffe_cpu_half2float<float>(const int n, const uint16_t* x,
+    float* y);
+template void caffe_cpu_half2float<double>(const int n, const uint16_t* x,
+    double* y);
+
+int caffe_cpu_gemm_half_panel_count(const int N, const int K) {
+  CHECK_GT(K, 0);
+  return panel_rows(N, K) * K;
+}
+
+template <typename Dtype>
+void caffe_cpu_gemm_half(const int M, const int N, const int K,
+    const Dtype alpha, const Dtype* A, const uint16_t* B, const Dtype beta,
+    Dtype* C, Dtype* panel) {
+  CHECK_GT(K, 0);
+  if (N == 0) {
+    return;
+  }
+  const int rows_per_panel = panel_rows(N, K);
+  for (int j = 0; j < N; j += rows_per_panel) {
+    const int rows = std::min(rows_per_panel, N - j);
+    caffe_cpu_half2float(rows * K, B + j * K, panel);
+    gemm_panel(M, rows, K, alpha, A, panel, beta, C + j, N);
+  }
+}
+
+template void caffe_cpu_gemm_half<float>(const int M, const int N,
+    const int K, const float alpha, const float* A, const uint16_t* B,
+    const float beta, float* C, float* panel);
+template void caffe_cpu_gemm_half<double>(const int M, const int N,
+    const int K, const double alpha, const double* A, const uint16_t* B,
+    const double beta, double* C, double* panel);
+
+}  // namespace caffe
@@ -0,0 +1,204 @@
+#include <boost/atomic.hpp>
+#include <boost/thread/tss.hpp>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/host_allocator.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The size classes: kHostAlignment, then kClassesPerDoubling evenly spaced
+// sizes up to each power of two, which wastes at most a quarter of a block.
+const int kClassesPerDoubling = 4;
+// Larger blocks are allocated and freed by the system.
+const size_t kMaxPooledSize = static_cast<size_t>(1) << 28;
+// The default cap on what all threads cache together.
+const size_t kDefaultCacheLimit = static_cast<size_t>(1) << 28;
+
+boost::atomic<size_t> cache_limit(kDefaultCacheLimit);
+// What all threads cache, which cache_limit caps.
+boost::atomic<size_t> total_cached_bytes(0);
+
+// Every block starts with its header, padded to kHostAlignment so that the
+// memory handed out after it stays aligned.
+struct BlockHeader {
+  size_t size;
+  int size_class;
+};
+
+vector<size_t>* MakeClassSizes() {
+  vector<size_t>* sizes = new vector<size_t>(1, kHostAlignment);
+  for (size_t base = kHostAlignment; base < kMaxPooledSize; base *= 2) {
+    for (int i = 1; i <= kClassesPerDoubling; ++i) {
+      sizes->push_back(base + base * i / kClassesPerDoubling);
+    }
+  }
+  return sizes;
+}
+
+const vector<size_t>& ClassSizes() {
+  static const vector<size_t>* sizes = MakeClassSizes();
+  return *sizes;
+}
+
+// The smallest class that holds size, or -1 if it is too large to pool.
+int SizeClass(size_t size) {
+  const vector<size_t>& sizes = ClassSizes();
+  vector<size_t>::const_iterator it =
+      std::lower_bound(sizes.begin(), sizes.end(), size);
+  return it == sizes.end() ? -1 : it - sizes.begin();
+}
+
+class ThreadCache {
+ public:
+  ThreadCache() : free_lists_(ClassSizes().size()), cached_bytes_(0) {}
+  ~ThreadCache() { Release(); }
+
+  char* Pop(int size_class) {
+    vector<char*>& free_list = free_lists_[size_class];
+    if (free_list.empty()) {
+      return NULL;
+    }
+    char* block = free_list.back();
+    free_list.pop_back();
+    const size_t size = ClassSizes()[size_class];
+    cached_bytes_ -= size;
+    total_cached_bytes -= size;
+    return block;
+  }
+
+  bool Push(char* block, int size_class) {
+    const size_t size = ClassSizes()[size_class];
+    const size_t limit = cache_limit.load();
+    if (size > limit) {
+      return false;
+    }
+    Trim(limit - size);
+    // What other threads cache may still leave no room.
+    if (total_cached_bytes.load() + size > limit) {
+      return false;
+    }
+    free_lists_[size_class].push_back(block);
+    cached_bytes_ += size;
+    total_cached_bytes += size;
+    return true;
+  }
+
+  // Frees the largest blocks of this thread until all threads together
+  // cache at most target bytes, or this thread caches nothing.
+  void Trim(size_t target) {
+    for (int i = free_lists_.size() - 1; i >= 0 && cached_bytes_ > 0 &&
+         total_cached_bytes.load() > target; --i) {
+      vector<char*>& free_list = free_lists_[i];
+      while (!free_list.empty() && total_cached_bytes.load() > target) {
+        free(free_list.back());
+        free_list.pop_back();
+        cached_bytes_ -= ClassSizes()[i];
+        total_cached_bytes -= ClassSizes()[i];
+      }
+    }
+  }
+
+  void Release() {
+    for (int i = 0; i < free_lists_.size(); ++i) {
+      for (int j = 0; j < free_lists_[i].size(); ++j) {
+        free(free_lists_[i][j]);
+      }
+      free_lists_[i].clear();
+    }
+    total_cached_bytes -= cached_bytes_;
+    cached_bytes_ = 0;
+  }
+
+ private:
+  vector<vector<char*> > free_lists_;
+  size_t cached_bytes_;
+
+  DISABLE_COPY_AND_ASSIGN(ThreadCache);
+};
+
+ThreadCache* GetThreadCache() {
+  // Never destroyed, so that memory freed by static destructors finds it.
+  static boost::thread_specific_ptr<ThreadCache>* caches =
+      new boost::thread_specific_ptr<ThreadCache>();
+  if (!caches->get()) {
+    caches->reset(new ThreadCache());
+  }
+  return caches->get();
+}
+
+boost::atomic<size_t> bytes_live(0);
+boost::atomic<size_t> peak_bytes_live(0);
+boost::atomic<size_t> allocations(0);
+boost::atomic<size_t> system_allocations(0);
+
+}  // namespace
+
+void* HostAllocate(size_t size) {
+  const int size_class = SizeClass(size);
+  char* block = size_class >= 0 ? GetThreadCache()->Pop(size_class) : NULL;
+  if (!block) {
+    const size_t class_size =
+        size_class >= 0 ? ClassSizes()[size_class] : size;
+    void* memory = NULL;
+    CHECK_EQ(posix_memalign(&memory, kHostAlignment,
+        kHostAlignment + class_size), 0)
+        << "host allocation of size " << size << " failed";
+    block = static_cast<char*>(memory);
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(block);
+    header->size = class_size;
+    header->size_class = size_class;
+    ++system_allocations;
+  }
+  ++allocations;
+  const size_t block_size = reinterpret_cast<BlockHeader*>(block)->size;
+  const size_t live = bytes_live.fetch_add(block_size) + block_size;
+  size_t peak = peak_bytes_live.load();
+  while (live > peak && !peak_bytes_live.compare_exchange_weak(peak, live)) {
+  }
+  return block + kHostAlignment;
+}
+
+void HostFree(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  char* block = static_cast<char*>(ptr) - kHostAlignment;
+  const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+  bytes_live.fetch_sub(header->size);
+  if (header->size_class >= 0 &&
+      GetThreadCache()->Push(block, header->size_class)) {
+    return;
+  }
+  free(block);
+}
+
+void HostReleaseCache() {
+  GetThreadCache()->Release();
+}
+
+size_t host_cache_limit() {
+  return cache_limit.load();
+}
+
+void SetHostCacheLimit(size_t bytes) {
+  cache_limit = bytes;
+  GetThreadCache()->Trim(bytes);
+}
+
+HostAllocatorStats host_allocator_stats() {
+  HostAllocatorStats stats;
+  stats.bytes_live = bytes_live.load();
+  stats.peak_bytes_live = peak_bytes_live.load();
+  stats.cached_bytes = total_cached_bytes.load();
+  stats.allocations = allocations.load();
+  stats.system_allocations = system_allocations.load();
+  return stats;
+}
+
+}  // namespace caffe
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -44,6 +46,38 @@ template void im2col_cpu<double>(const double* data_im, const int channels,
     const int pad_h, const int pad_w, const int stride_h,
     const int stride_w, double* data_col);
 
+template <typename Dtype>
+void im2row_cpu(const Dtype* data_im, const int channels,
+    const int height, const int width, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w,
+    Dtype* data_row) {
+  int height_col = (height + 2 * pad_h - kernel_h) / stride_h + 1;
+  int width_col = (width + 2 * pad_w - kernel_w) / stride_w + 1;
+  for (int h = 0; h < height_col; ++h) {
+    for (int w = 0; w < width_col; ++w) {
+      for (int c = 0; c < channels; ++c) {
+        for (int h_offset = 0; h_offset < kernel_h; ++h_offset) {
+          int h_pad = h * stride_h - pad_h + h_offset;
+          for (int w_offset = 0; w_offset < kernel_w; ++w_offset) {
+            int w_pad = w * stride_w - pad_w + w_offset;
+            if (h_pad >= 0 && h_pad < height && w_pad >= 0 && w_pad < width)
+              *data_row++ = data_im[(c * height + h_pad) * width + w_pad];
+            else
+              *data_row++ = 0;
+          }
+        }
+      }
+    }
+  }
+}
+
+// Only the int8 quantized convolution uses rows.
+template void im2row_cpu<int8_t>(const int8_t* data_im, const int channels,
+    const int height, const int width, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w, const int stride_h,
+    const int stride_w, int8_t* data_row);
+
 template <typename Dtype>
 void col2im_cpu(const Dtype* data_col, const int channels,
     const int height, const int width, const int patch_h, const int patch_w,
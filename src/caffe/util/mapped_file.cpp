@@ -0,0 +1,41 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+void MappedFile::Open(const string& filename, bool copy_on_write) {
+  Close();
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_NE(fd, -1) << "File not found: " << filename;
+  struct stat file_stat;
+  CHECK_EQ(fstat(fd, &file_stat), 0) << "Could not stat " << filename;
+  size_ = file_stat.st_size;
+  CHECK_GT(size_, 0) << "Cannot map empty file " << filename;
+  void* data = copy_on_write ?
+      mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) :
+      mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  CHECK(data != MAP_FAILED) << "Could not map " << filename << ": "
+      << strerror(errno);
+  data_ = static_cast<const char*>(data);
+  copy_on_write_ = copy_on_write;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    munmap(const_cast<char*>(data_), size_);
+    data_ = NULL;
+    size_ = 0;
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,157 @@
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/util/mapped_weights.hpp"
+
+namespace caffe {
+
+namespace {
+
+uint64_t AlignUp(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Copies the shape of proto to index_blob, in the legacy num, channels,
+// height and width if proto has them so that Blob::ShapeEquals compares
+// them the same way.
+void CopyBlobProtoShape(const BlobProto& proto, BlobProto* index_blob) {
+  if (proto.has_num() || proto.has_channels() ||
+      proto.has_height() || proto.has_width()) {
+    index_blob->set_num(proto.num());
+    index_blob->set_channels(proto.channels());
+    index_blob->set_height(proto.height());
+    index_blob->set_width(proto.width());
+  } else {
+    index_blob->mutable_shape()->CopyFrom(proto.shape());
+  }
+}
+
+// The bytes of the float data of proto, which must be at most limit.
+uint64_t BlobProtoSize(const BlobProto& proto, uint64_t limit,
+    const string& filename) {
+  vector<int> shape;
+  BlobProtoShape(proto, &shape);
+  uint64_t size = sizeof(float);
+  for (int i = 0; i < shape.size(); ++i) {
+    CHECK_GE(shape[i], 0) << "Malformed index in " << filename;
+    CHECK(shape[i] == 0 || size <= limit / shape[i])
+        << filename << " is truncated";
+    size *= shape[i];
+  }
+  CHECK_LE(size, limit) << filename << " is truncated";
+  return size;
+}
+
+}  // namespace
+
+void BlobProtoShape(const BlobProto& proto, vector<int>* shape) {
+  if (proto.has_num() || proto.has_channels() ||
+      proto.has_height() || proto.has_width()) {
+    shape->resize(4);
+    (*shape)[0] = proto.num();
+    (*shape)[1] = proto.channels();
+    (*shape)[2] = proto.height();
+    (*shape)[3] = proto.width();
+  } else {
+    shape->resize(proto.shape().dim_size());
+    for (int i = 0; i < proto.shape().dim_size(); ++i) {
+      (*shape)[i] = proto.shape().dim(i);
+    }
+  }
+}
+
+bool IsMappedWeightsFile(const string& filename) {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  char magic[sizeof(kMappedWeightsMagic)];
+  return file.read(magic, sizeof(magic)) &&
+      !memcmp(magic, kMappedWeightsMagic, sizeof(magic));
+}
+
+void WriteMappedWeights(const NetParameter& param, const string& filename) {
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary |
+      std::ios::trunc);
+  CHECK(file.is_open()) << "Could not open " << filename;
+  NetParameter index;
+  index.set_name(param.name());
+  for (int i = 0; i < param.layer_size(); ++i) {
+    const LayerParameter& layer_param = param.layer(i);
+    LayerParameter* index_layer = index.add_layer();
+    index_layer->set_name(layer_param.name());
+    index_layer->set_type(layer_param.type());
+    for (int j = 0; j < layer_param.blobs_size(); ++j) {
+      CopyBlobProtoShape(layer_param.blobs(j), index_layer->add_blobs());
+    }
+  }
+  string index_data;
+  CHECK(index.SerializeToString(&index_data));
+  MappedWeightsHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMappedWeightsMagic, sizeof(header.magic));
+  header.version = kMappedWeightsVersion;
+  header.index_offset = sizeof(header);
+  header.index_size = index_data.size();
+  header.data_offset = AlignUp(header.index_offset + header.index_size,
+      kMappedWeightsDataAlignment);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(index_data.data(), index_data.size());
+  // Decode one blob at a time, whatever its encoding.
+  uint64_t offset = header.index_offset + header.index_size;
+  uint64_t blob_offset = header.data_offset;
+  vector<char> padding(kMappedWeightsDataAlignment, 0);
+  Blob<float> blob;
+  for (int i = 0; i < param.layer_size(); ++i) {
+    for (int j = 0; j < param.layer(i).blobs_size(); ++j) {
+      blob_offset = AlignUp(blob_offset, kMappedWeightsBlobAlignment);
+      file.write(&padding[0], blob_offset - offset);
+      blob.FromProto(param.layer(i).blobs(j));
+      const uint64_t size = blob.count() * sizeof(float);
+      file.write(reinterpret_cast<const char*>(blob.cpu_data()), size);
+      offset = blob_offset = blob_offset + size;
+    }
+  }
+  CHECK(file.good()) << "Failed writing mapped weights to " << filename;
+}
+
+void MappedWeights::Open(const string& filename) {
+  const bool kCopyOnWrite = true;
+  file_.Open(filename, kCopyOnWrite);
+  CHECK_GE(file_.size(), sizeof(MappedWeightsHeader))
+      << filename << " is too small for mapped weights";
+  MappedWeightsHeader header;
+  memcpy(&header, file_.data(), sizeof(header));
+  CHECK(!memcmp(header.magic, kMappedWeightsMagic, sizeof(header.magic)))
+      << filename << " is not mapped weights";
+  CHECK_EQ(header.version, kMappedWeightsVersion)
+      << "Unsupported mapped weights version in " << filename;
+  // Every offset + size is compared as size <= file size - offset, as the
+  // sum may overflow.
+  const uint64_t file_size = file_.size();
+  CHECK(header.index_offset <= file_size &&
+      header.index_size <= file_size - header.index_offset)
+      << filename << " is truncated";
+  CHECK_LE(header.index_size, static_cast<uint64_t>(INT_MAX))
+      << "Malformed index in " << filename;
+  CHECK_GE(header.data_offset, header.index_offset + header.index_size)
+      << "Malformed header in " << filename;
+  CHECK(index_.ParseFromArray(file_.data() + header.index_offset,
+      header.index_size)) << "Malformed index in " << filename;
+  offsets_.clear();
+  offsets_.resize(index_.layer_size());
+  uint64_t offset = header.data_offset;
+  for (int i = 0; i < index_.layer_size(); ++i) {
+    const LayerParameter& layer_param = index_.layer(i);
+    for (int j = 0; j < layer_param.blobs_size(); ++j) {
+      CHECK_LE(offset, file_size) << filename << " is truncated";
+      offset = AlignUp(offset, kMappedWeightsBlobAlignment);
+      CHECK_LE(offset, file_size) << filename << " is truncated";
+      offsets_[i].push_back(offset);
+      offset += BlobProtoSize(layer_param.blobs(j), file_size - offset,
+          filename);
+    }
+  }
+}
+
+}  // namespace caffe
@@ -216,6 +216,26 @@ void caffe_log<double>(const int n, const double* a, double* y) {
   vdLn(n, a, y);
 }
 
+template <>
+void caffe_log1p<float>(const int n, const float* a, float* y) {
+  vsLog1p(n, a, y);
+}
+
+template <>
+void caffe_log1p<double>(const int n, const double* a, double* y) {
+  vdLog1p(n, a, y);
+}
+
+template <>
+void caffe_tanh<float>(const int n, const float* a, float* y) {
+  vsTanh(n, a, y);
+}
+
+template <>
+void caffe_tanh<double>(const int n, const double* a, double* y) {
+  vdTanh(n, a, y);
+}
+
 template <>
 void caffe_abs<float>(const int n, const float* a, float* y) {
     vsAbs(n, a, y);
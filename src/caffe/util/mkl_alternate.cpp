@@ -0,0 +1,297 @@
+#ifndef USE_MKL
+
+#include <glog/logging.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "caffe/util/mkl_alternate.hpp"
+
+namespace {
+
+// The kernels work on blocks of kLanes values held on the stack. Each is a
+// few loops of constant trip count: one that clamps the inputs to the range
+// of the approximation, a branch-free polynomial one, and one that patches
+// in the special cases. Loops of this shape are vectorized by the compiler
+// even at -O2 and with the default -ftrapping-math, where a select inside
+// the polynomial loop would not be.
+const int kLanes = 16;
+
+const float kInf = std::numeric_limits<float>::infinity();
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+inline float from_bits(const int32_t i) {
+  float f;
+  memcpy(&f, &i, sizeof(f));
+  return f;
+}
+
+inline int32_t to_bits(const float f) {
+  int32_t i;
+  memcpy(&i, &f, sizeof(i));
+  return i;
+}
+
+// exp(x) = 2^n exp(r) with n the integer nearest to x / ln 2, so that
+// |r| <= ln(2) / 2, and exp(r) the polynomial of the Cephes expf. Results
+// past FLT_MAX are inf and results below FLT_MIN are flushed to zero; the
+// error is below 1 ulp in between.
+const float kExpHi = 88.7228391f;   // ln(FLT_MAX)
+const float kExpLo = -87.3365448f;  // ln(FLT_MIN)
+
+inline float exp_core(const float x) {
+  // Adding 1.5 * 2^23 rounds to an integer that lands in the low bits.
+  const float kRound = 12582912.0f;
+  const float rounded = x * 1.44269504f + kRound;
+  const int32_t n = to_bits(rounded) - to_bits(kRound);
+  const float fn = rounded - kRound;
+  // ln 2 in two parts, the first of which fn multiplies exactly.
+  const float r = (x - fn * 0.693359375f) + fn * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  // 2^n in two factors, as n = 128 is past the exponent range.
+  const int32_t half = n >> 1;
+  return p * from_bits((half + 127) << 23) *
+      from_bits((n - half + 127) << 23);
+}
+
+inline void exp_block(const float* x, float* y) {
+  float clamped[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    const float v = x[k] < kExpHi ? x[k] : kExpHi;
+    clamped[k] = v > kExpLo ? v : kExpLo;
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    y[k] = exp_core(clamped[k]);
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    float v = x[k] > kExpHi ? kInf : y[k];
+    v = x[k] < kExpLo ? 0.0f : v;
+    y[k] = x[k] == x[k] ? v : x[k];
+  }
+}
+
+// log(x) = e ln 2 + log(1 + f) with 1 + f in [sqrt(1/2), sqrt(2)), as in
+// the musl logf, and log(1 + f) the polynomial of the Cephes logf. The
+// error is below 1 ulp, and below 2^-24 in absolute terms around x = 1.
+// Denormals are scaled up first; log(0) is -inf, log(inf) inf and the log
+// of a negative number NaN.
+inline float log_core(const float x, const float exponent_offset) {
+  // Moving sqrt(1/2) to 1 puts the split in the exponent bits.
+  const int32_t kSqrtHalf = 0x3f3504f3;
+  const int32_t bits = to_bits(x) + (0x3f800000 - kSqrtHalf);
+  const float e = static_cast<float>((bits >> 23) - 127) - exponent_offset;
+  const float f = from_bits((bits & 0x007fffff) + kSqrtHalf) - 1.0f;
+  const float z = f * f;
+  float p = 7.0376836292e-2f;
+  p = p * f - 1.1514610310e-1f;
+  p = p * f + 1.1676998740e-1f;
+  p = p * f - 1.2420140846e-1f;
+  p = p * f + 1.4249322787e-1f;
+  p = p * f - 1.6668057665e-1f;
+  p = p * f + 2.0000714765e-1f;
+  p = p * f - 2.4999993993e-1f;
+  p = p * f + 3.3333331174e-1f;
+  p = p * f * z + e * -2.12194440e-4f - 0.5f * z;
+  return f + p + e * 0.693359375f;
+}
+
+inline void log_block(const float* x, float* y) {
+  const float kMinNormal = std::numeric_limits<float>::min();
+  // The scaling of denormals is kept out of the selecting loop, where the
+  // compiler would make it conditional.
+  float scaled[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    scaled[k] = x[k] * 8388608.0f;
+  }
+  float base[kLanes];
+  float offset[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    const bool denormal = x[k] < kMinNormal;
+    base[k] = denormal ? scaled[k] : x[k];
+    offset[k] = denormal ? 23.0f : 0.0f;
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    y[k] = log_core(base[k], offset[k]);
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    float v = x[k] == 0 ? -kInf : y[k];
+    v = x[k] < 0 ? kNaN : v;
+    v = x[k] == kInf ? kInf : v;
+    y[k] = x[k] == x[k] ? v : x[k];
+  }
+}
+
+// log(1 + x) is log(u) for u = 1 + x, less the rounding error of u over u:
+// below 2 ulp, and exactly x where u rounds to 1.
+inline void log1p_block(const float* x, float* y) {
+  float u[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    u[k] = 1.0f + x[k];
+  }
+  log_block(u, y);
+  for (int k = 0; k < kLanes; ++k) {
+    y[k] -= ((u[k] - 1.0f) - x[k]) / u[k];
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    float v = u[k] == 0 ? -kInf : y[k];
+    y[k] = u[k] == kInf ? kInf : v;
+  }
+}
+
+// tanh(x) is the odd polynomial of the Cephes tanhf below |x| = 0.625 and
+// 1 - 2 / (exp(2 |x|) + 1), with the sign of x, above: below 2 ulp.
+inline void tanh_block(const float* x, float* y) {
+  float twice[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    const float v = 2.0f * std::fabs(x[k]);
+    // tanh is 1 in float well before exp(2 |x|) overflows.
+    twice[k] = v < 40.0f ? v : 40.0f;
+  }
+  float small[kLanes];
+  for (int k = 0; k < kLanes; ++k) {
+    const float z = x[k] * x[k];
+    float p = -5.70498872745e-3f;
+    p = p * z + 2.06390887954e-2f;
+    p = p * z - 5.37397155531e-2f;
+    p = p * z + 1.33314422036e-1f;
+    p = p * z - 3.33332819422e-1f;
+    small[k] = p * z * x[k] + x[k];
+    y[k] = 1.0f - 2.0f / (exp_core(twice[k]) + 1.0f);
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    const float v = x[k] < 0 ? -y[k] : y[k];
+    y[k] = std::fabs(x[k]) < 0.625f ? small[k] : v;
+    y[k] = x[k] == x[k] ? y[k] : x[k];
+  }
+}
+
+// x^b = exp(b log x), in which the error of log x is scaled by |b log x|:
+// the result is within 1 + |b log x| ulp. A negative x has a real power
+// only for an integer b, whose sign is that of x for an odd b.
+template <bool integer, bool odd>
+inline void pow_block(const float* x, const float b, float* y) {
+  float exponent[kLanes];
+  if (integer) {
+    float base[kLanes];
+    for (int k = 0; k < kLanes; ++k) {
+      base[k] = std::fabs(x[k]);
+    }
+    log_block(base, exponent);
+  } else {
+    log_block(x, exponent);
+  }
+  for (int k = 0; k < kLanes; ++k) {
+    exponent[k] *= b;
+  }
+  exp_block(exponent, y);
+  if (odd) {
+    for (int k = 0; k < kLanes; ++k) {
+      y[k] = x[k] < 0 ? -y[k] : y[k];
+    }
+  }
+}
+
+// Applies block to a in blocks of kLanes values, the last of them padded.
+// The blocks go through arrays on the stack, which the compiler knows not
+// to overlap.
+template <typename Block>
+void map_blocks(const int n, const float* a, const Block& block, float* y) {
+  int i = 0;
+  for (; i + kLanes <= n; i += kLanes) {
+    float x[kLanes];
+    float out[kLanes];
+    memcpy(x, a + i, sizeof(x));
+    block(x, out);
+    memcpy(y + i, out, sizeof(out));
+  }
+  if (i < n) {
+    float x[kLanes] = {0};
+    float out[kLanes];
+    memcpy(x, a + i, (n - i) * sizeof(float));
+    block(x, out);
+    memcpy(y + i, out, (n - i) * sizeof(float));
+  }
+}
+
+// The blocks as function objects, whose calls the compiler inlines.
+template <void (*block)(const float*, float*)>
+struct Block {
+  void operator()(const float* x, float* y) const {
+    block(x, y);
+  }
+};
+
+template <bool integer, bool odd>
+struct PowBlock {
+  explicit PowBlock(const float b) : b(b) {}
+  void operator()(const float* x, float* y) const {
+    pow_block<integer, odd>(x, b, y);
+  }
+  const float b;
+};
+
+}  // namespace
+
+void vsExp(const int n, const float* a, float* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  map_blocks(n, a, Block<exp_block>(), y);
+}
+
+void vsLn(const int n, const float* a, float* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  map_blocks(n, a, Block<log_block>(), y);
+}
+
+void vsLog1p(const int n, const float* a, float* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  map_blocks(n, a, Block<log1p_block>(), y);
+}
+
+void vsTanh(const int n, const float* a, float* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  map_blocks(n, a, Block<tanh_block>(), y);
+}
+
+void vsPowx(const int n, const float* a, const float b, float* y) {
+  CHECK_GT(n, 0); CHECK(a); CHECK(y);
+  // The exponents that the solvers and layers use most are exact.
+  if (b == 0) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = 1;
+    }
+  } else if (b == 1) {
+    if (y != a) {
+      memmove(y, a, n * sizeof(float));
+    }
+  } else if (b == 2) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = a[i] * a[i];
+    }
+  } else if (b == 0.5f) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = std::sqrt(a[i]);
+    }
+  } else if (b == -1) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = 1 / a[i];
+    }
+  } else if (b == std::floor(b)) {
+    if (std::fmod(b, 2.0f) != 0) {
+      map_blocks(n, a, PowBlock<true, true>(b), y);
+    } else {
+      map_blocks(n, a, PowBlock<true, false>(b), y);
+    }
+  } else {
+    map_blocks(n, a, PowBlock<false, false>(b), y);
+  }
+}
+
+#endif  // USE_MKL
@@ -0,0 +1,36 @@
+#include <boost/thread.hpp>
+
+#include <string>
+
+#include "caffe/util/param_cache.hpp"
+
+namespace caffe {
+
+template <typename Dtype>
+class ParamCache<Dtype>::sync {
+ public:
+  mutable boost::mutex mutex_;
+};
+
+template <typename Dtype>
+ParamCache<Dtype>::ParamCache()
+    : sync_(new sync()) {
+}
+
+template <typename Dtype>
+shared_ptr<const Blob<Dtype> > ParamCache<Dtype>::Get(const string& key,
+    size_t version, const ComputeFn& compute) {
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  pair<size_t, shared_ptr<const Blob<Dtype> > >& entry = entries_[key];
+  if (!entry.second || entry.first != version) {
+    shared_ptr<Blob<Dtype> > blob(new Blob<Dtype>());
+    compute(blob.get());
+    entry.first = version;
+    entry.second = blob;
+  }
+  return entry.second;
+}
+
+INSTANTIATE_CLASS(ParamCache);
+
+}  // namespace caffe
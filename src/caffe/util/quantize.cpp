@@ -0,0 +1,159 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/quantize.hpp"
+
+namespace caffe {
+
+namespace {
+
+// int8_gemm_cpu computes blocks of kInt8GemmBlock x kInt8GemmBlock outputs,
+// reading each row of A and of B once per block, kInt8GemmChunk values at a
+// time: a dot product of constant length the compiler vectorizes.
+const int kInt8GemmBlock = 4;
+const int kInt8GemmChunk = 64;
+
+template <typename Dtype>
+inline int8_t QuantizeInt8(const Dtype x, const Dtype inverse_scale) {
+  const Dtype v = x * inverse_scale;
+  const int q = static_cast<int>(v >= 0 ? v + Dtype(0.5) : v - Dtype(0.5));
+  return static_cast<int8_t>(std::max(-127, std::min(127, q)));
+}
+
+// C[r * ldc + c] = the dot product of rows r of A and c of B, which are K
+// long.
+template <int kRows, int kCols>
+inline void Int8DotBlock(const int K, const int8_t* A, const int8_t* B,
+    int32_t* C, const int ldc) {
+  int32_t acc[kRows][kCols];
+  for (int r = 0; r < kRows; ++r) {
+    for (int c = 0; c < kCols; ++c) {
+      acc[r][c] = 0;
+    }
+  }
+  int k0 = 0;
+  for (; k0 + kInt8GemmChunk <= K; k0 += kInt8GemmChunk) {
+    for (int r = 0; r < kRows; ++r) {
+      const int8_t* a = A + r * K + k0;
+      for (int c = 0; c < kCols; ++c) {
+        const int8_t* b = B + c * K + k0;
+        int32_t sum = 0;
+        for (int k = 0; k < kInt8GemmChunk; ++k) {
+          sum += static_cast<int32_t>(a[k]) * b[k];
+        }
+        acc[r][c] += sum;
+      }
+    }
+  }
+  for (int r = 0; r < kRows; ++r) {
+    const int8_t* a = A + r * K;
+    for (int c = 0; c < kCols; ++c) {
+      const int8_t* b = B + c * K;
+      int32_t sum = acc[r][c];
+      for (int k = k0; k < K; ++k) {
+        sum += static_cast<int32_t>(a[k]) * b[k];
+      }
+      C[r * ldc + c] = sum;
+    }
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+Dtype int8_scale(const Dtype max_abs) {
+  return max_abs > 0 ? max_abs / 127 : Dtype(1);
+}
+
+template float int8_scale<float>(const float max_abs);
+template double int8_scale<double>(const double max_abs);
+
+template <typename Dtype>
+void quantize_int8_cpu(const int count, const Dtype* x, const Dtype scale,
+    int8_t* q) {
+  const Dtype inverse_scale = 1 / scale;
+  for (int i = 0; i < count; ++i) {
+    q[i] = QuantizeInt8(x[i], inverse_scale);
+  }
+}
+
+template void quantize_int8_cpu<float>(const int count, const float* x,
+    const float scale, int8_t* q);
+template void quantize_int8_cpu<double>(const int count, const double* x,
+    const double scale, int8_t* q);
+
+template <typename Dtype>
+void quantize_rows_int8_cpu(const int rows, const int cols, const Dtype* x,
+    int8_t* q, Dtype* scales) {
+  for (int r = 0; r < rows; ++r) {
+    const Dtype* row = x + r * cols;
+    Dtype max_abs = 0;
+    for (int c = 0; c < cols; ++c) {
+      max_abs = std::max(max_abs, std::abs(row[c]));
+    }
+    scales[r] = int8_scale(max_abs);
+    quantize_int8_cpu(cols, row, scales[r], q + r * cols);
+  }
+}
+
+template void quantize_rows_int8_cpu<float>(const int rows, const int cols,
+    const float* x, int8_t* q, float* scales);
+template void quantize_rows_int8_cpu<double>(const int rows, const int cols,
+    const double* x, int8_t* q, double* scales);
+
+void int8_gemm_cpu(const int M, const int N, const int K, const int8_t* A,
+    const int8_t* B, int32_t* C) {
+  const int kBlock = kInt8GemmBlock;
+  int i = 0;
+  for (; i + kBlock <= M; i += kBlock) {
+    int j = 0;
+    for (; j + kBlock <= N; j += kBlock) {
+      Int8DotBlock<kBlock, kBlock>(K, A + i * K, B + j * K, C + i * N + j, N);
+    }
+    for (; j < N; ++j) {
+      Int8DotBlock<kBlock, 1>(K, A + i * K, B + j * K, C + i * N + j, N);
+    }
+  }
+  for (; i < M; ++i) {
+    int j = 0;
+    for (; j + kBlock <= N; j += kBlock) {
+      Int8DotBlock<1, kBlock>(K, A + i * K, B + j * K, C + i * N + j, N);
+    }
+    for (; j < N; ++j) {
+      Int8DotBlock<1, 1>(K, A + i * K, B + j * K, C + i * N + j, N);
+    }
+  }
+}
+
+template <typename Dtype>
+void QuantizeBlobProto(const Blob<Dtype>& blob, BlobProto* proto) {
+  proto->clear_shape();
+  for (int i = 0; i < blob.num_axes(); ++i) {
+    proto->mutable_shape()->add_dim(blob.shape(i));
+  }
+  proto->clear_data();
+  proto->clear_diff();
+  const int rows = blob.num_axes() > 0 ? blob.shape(0) : 1;
+  const int cols = rows > 0 ? blob.count() / rows : 0;
+  string data(blob.count(), '\0');
+  vector<Dtype> scales(rows);
+  quantize_rows_int8_cpu(rows, cols, blob.cpu_data(),
+      reinterpret_cast<int8_t*>(&data[0]), &scales[0]);
+  proto->set_int8_data(data);
+  proto->clear_int8_scale();
+  for (int r = 0; r < rows; ++r) {
+    proto->add_int8_scale(scales[r]);
+  }
+}
+
+template void QuantizeBlobProto<float>(const Blob<float>& blob,
+    BlobProto* proto);
+template void QuantizeBlobProto<double>(const Blob<double>& blob,
+    BlobProto* proto);
+
+}  // namespace caffe
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "caffe/util/raw_dataset.hpp"
+
+namespace caffe {
+
+namespace {
+
+uint64_t AlignUp(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+size_t RawDatasetElementSize(uint32_t data_type) {
+  switch (data_type) {
+  case RawDatasetHeader::UINT8:
+    return sizeof(uint8_t);
+  case RawDatasetHeader::FLOAT32:
+    return sizeof(float);
+  default:
+    LOG(FATAL) << "Unknown raw dataset data type " << data_type;
+  }
+  return 0;
+}
+
+RawDatasetWriter::RawDatasetWriter(const string& filename,
+    RawDatasetHeader::DataType data_type, int channels, int height,
+    int width)
+    : file_(filename.c_str(), std::ios::out | std::ios::binary |
+        std::ios::trunc) {
+  CHECK(file_.is_open()) << "Could not open " << filename;
+  CHECK_GT(channels, 0);
+  CHECK_GT(height, 0);
+  CHECK_GT(width, 0);
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, kRawDatasetMagic, sizeof(header_.magic));
+  header_.version = kRawDatasetVersion;
+  header_.data_type = data_type;
+  header_.channels = channels;
+  header_.height = height;
+  header_.width = width;
+  header_.record_stride = AlignUp(
+      RawDatasetElementSize(data_type) * channels * height * width,
+      kRawDatasetRecordAlignment);
+  header_.data_offset = AlignUp(sizeof(header_), kRawDatasetDataAlignment);
+  padding_.resize(std::max(header_.data_offset, header_.record_stride), 0);
+  // Reserve room for the header, which is written on Close().
+  file_.write(&padding_[0], header_.data_offset);
+}
+
+void RawDatasetWriter::Write(const void* data, int label) {
+  CHECK(file_.is_open()) << "Writer is closed";
+  const size_t sample_size = RawDatasetElementSize(header_.data_type) *
+      header_.channels * header_.height * header_.width;
+  file_.write(static_cast<const char*>(data), sample_size);
+  file_.write(&padding_[0], header_.record_stride - sample_size);
+  CHECK(file_.good()) << "Failed writing record " << header_.num;
+  labels_.push_back(label);
+  ++header_.num;
+}
+
+void RawDatasetWriter::Close() {
+  if (!file_.is_open()) {
+    return;
+  }
+  header_.label_offset =
+      header_.data_offset + header_.num * header_.record_stride;
+  if (labels_.size()) {
+    file_.write(reinterpret_cast<const char*>(&labels_[0]),
+        labels_.size() * sizeof(labels_[0]));
+  }
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  CHECK(file_.good()) << "Failed writing raw dataset";
+  file_.close();
+}
+
+void RawDataset::Open(const string& filename) {
+  file_.Open(filename);
+  CHECK_GE(file_.size(), sizeof(header_)) << filename
+      << " is too short to be a raw dataset";
+  memcpy(&header_, file_.data(), sizeof(header_));
+  CHECK_EQ(memcmp(header_.magic, kRawDatasetMagic, sizeof(header_.magic)), 0)
+      << filename << " is not a raw dataset";
+  CHECK_EQ(header_.version, kRawDatasetVersion)
+      << "Unsupported raw dataset version";
+  CHECK_GE(header_.record_stride,
+      RawDatasetElementSize(header_.data_type) * sample_count());
+  CHECK_EQ(header_.label_offset,
+      header_.data_offset + header_.num * header_.record_stride);
+  CHECK_EQ(file_.size(), header_.label_offset + header_.num * sizeof(int32_t))
+      << filename << " is truncated";
+}
+
+}  // namespace caffe
@@ -0,0 +1,223 @@
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/softmax.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The number of positions that are processed together when they are
+// contiguous (inner_num > 1), and of channels that are exponentiated at a
+// time for the log-softmax; their per-position state stays on the stack.
+const int kBlock = 64;
+
+template <typename Dtype>
+struct SoftmaxArgs {
+  int outer_num;
+  int channels;
+  int inner_num;
+  const Dtype* input;
+  Dtype* output;
+  Dtype* log_norm;
+  bool log;
+};
+
+// One distribution whose channels are contiguous.
+template <typename Dtype>
+void SoftmaxRow(const SoftmaxArgs<Dtype>& args, const Dtype* in, Dtype* out,
+    Dtype* log_norm) {
+  const int channels = args.channels;
+  Dtype max_value = in[0];
+  for (int c = 1; c < channels; ++c) {
+    max_value = std::max(max_value, in[c]);
+  }
+  Dtype sum = 0;
+  if (args.log) {
+    Dtype buffer[kBlock];
+    for (int c0 = 0; c0 < channels; c0 += kBlock) {
+      const int n = std::min(kBlock, channels - c0);
+      for (int c = 0; c < n; ++c) {
+        buffer[c] = in[c0 + c] - max_value;
+      }
+      caffe_exp(n, buffer, buffer);
+      for (int c = 0; c < n; ++c) {
+        sum += buffer[c];
+      }
+    }
+    const Dtype norm = max_value + std::log(sum);
+    for (int c = 0; c < channels; ++c) {
+      out[c] = in[c] - norm;
+    }
+  } else {
+    for (int c = 0; c < channels; ++c) {
+      out[c] = in[c] - max_value;
+    }
+    caffe_exp(channels, out, out);
+    for (int c = 0; c < channels; ++c) {
+      sum += out[c];
+    }
+    const Dtype scale = Dtype(1) / sum;
+    for (int c = 0; c < channels; ++c) {
+      out[c] *= scale;
+    }
+  }
+  if (log_norm) {
+    *log_norm = max_value + std::log(sum);
+  }
+}
+
+// The n <= kBlock contiguous distributions of outer index i from position
+// k0 on, whose channels are inner_num apart.
+template <typename Dtype>
+void SoftmaxBlock(const SoftmaxArgs<Dtype>& args, const int i, const int k0,
+    const int n) {
+  const int channels = args.channels;
+  const int inner_num = args.inner_num;
+  const int offset = i * channels * inner_num + k0;
+  const Dtype* in = args.input + offset;
+  Dtype* out = args.output + offset;
+  Dtype max_value[kBlock];
+  Dtype sum[kBlock];
+  for (int k = 0; k < n; ++k) {
+    max_value[k] = in[k];
+    sum[k] = 0;
+  }
+  for (int c = 1; c < channels; ++c) {
+    const Dtype* in_c = in + c * inner_num;
+    for (int k = 0; k < n; ++k) {
+      max_value[k] = std::max(max_value[k], in_c[k]);
+    }
+  }
+  if (args.log) {
+    Dtype buffer[kBlock];
+    for (int c = 0; c < channels; ++c) {
+      const Dtype* in_c = in + c * inner_num;
+      for (int k = 0; k < n; ++k) {
+        buffer[k] = in_c[k] - max_value[k];
+      }
+      caffe_exp(n, buffer, buffer);
+      for (int k = 0; k < n; ++k) {
+        sum[k] += buffer[k];
+      }
+    }
+  } else {
+    for (int c = 0; c < channels; ++c) {
+      const Dtype* in_c = in + c * inner_num;
+      Dtype* out_c = out + c * inner_num;
+      for (int k = 0; k < n; ++k) {
+        out_c[k] = in_c[k] - max_value[k];
+      }
+      caffe_exp(n, out_c, out_c);
+      for (int k = 0; k < n; ++k) {
+        sum[k] += out_c[k];
+      }
+    }
+  }
+  // max_value becomes the log of the normalizer.
+  for (int k = 0; k < n; ++k) {
+    max_value[k] += std::log(sum[k]);
+  }
+  if (args.log_norm) {
+    Dtype* log_norm = args.log_norm + i * inner_num + k0;
+    for (int k = 0; k < n; ++k) {
+      log_norm[k] = max_value[k];
+    }
+  }
+  if (args.log) {
+    for (int c = 0; c < channels; ++c) {
+      const Dtype* in_c = in + c * inner_num;
+      Dtype* out_c = out + c * inner_num;
+      for (int k = 0; k < n; ++k) {
+        out_c[k] = in_c[k] - max_value[k];
+      }
+    }
+  } else {
+    for (int k = 0; k < n; ++k) {
+      sum[k] = Dtype(1) / sum[k];
+    }
+    for (int c = 0; c < channels; ++c) {
+      Dtype* out_c = out + c * inner_num;
+      for (int k = 0; k < n; ++k) {
+        out_c[k] *= sum[k];
+      }
+    }
+  }
+}
+
+// The range-th of num_ranges contiguous shares of the work: rows when
+// inner_num == 1, blocks of positions otherwise.
+template <typename Dtype>
+void SoftmaxRange(const SoftmaxArgs<Dtype> args, const int num_ranges,
+    const int range) {
+  const int channels = args.channels;
+  if (args.inner_num == 1) {
+    const int begin = args.outer_num * range / num_ranges;
+    const int end = args.outer_num * (range + 1) / num_ranges;
+    for (int i = begin; i < end; ++i) {
+      SoftmaxRow(args, args.input + i * channels, args.output + i * channels,
+          args.log_norm ? args.log_norm + i : NULL);
+    }
+    return;
+  }
+  const int num_blocks = (args.inner_num + kBlock - 1) / kBlock;
+  const int num_units = args.outer_num * num_blocks;
+  const int begin = num_units * range / num_ranges;
+  const int end = num_units * (range + 1) / num_ranges;
+  for (int unit = begin; unit < end; ++unit) {
+    const int k0 = unit % num_blocks * kBlock;
+    SoftmaxBlock(args, unit / num_blocks, k0,
+        std::min(kBlock, args.inner_num - k0));
+  }
+}
+
+template <typename Dtype>
+void Softmax(const SoftmaxArgs<Dtype>& args, ThreadPool* pool) {
+  if (!pool || pool->size() == 1) {
+    SoftmaxRange(args, 1, 0);
+  } else {
+    pool->Run(pool->size(),
+        boost::bind(&SoftmaxRange<Dtype>, args, pool->size(), _1));
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+void caffe_cpu_softmax(const int outer_num, const int channels,
+    const int inner_num, const Dtype* input, Dtype* output,
+    Dtype* log_norm, ThreadPool* pool) {
+  SoftmaxArgs<Dtype> args = {outer_num, channels, inner_num, input, output,
+      log_norm, false};
+  Softmax(args, pool);
+}
+
+template void caffe_cpu_softmax<float>(const int outer_num,
+    const int channels, const int inner_num, const float* input,
+    float* output, float* log_norm, ThreadPool* pool);
+template void caffe_cpu_softmax<double>(const int outer_num,
+    const int channels, const int inner_num, const double* input,
+    double* output, double* log_norm, ThreadPool* pool);
+
+template <typename Dtype>
+void caffe_cpu_log_softmax(const int outer_num, const int channels,
+    const int inner_num, const Dtype* input, Dtype* output,
+    ThreadPool* pool) {
+  SoftmaxArgs<Dtype> args = {outer_num, channels, inner_num, input, output,
+      NULL, true};
+  Softmax(args, pool);
+}
+
+template void caffe_cpu_log_softmax<float>(const int outer_num,
+    const int channels, const int inner_num, const float* input,
+    float* output, ThreadPool* pool);
+template void caffe_cpu_log_softmax<double>(const int outer_num,
+    const int channels, const int inner_num, const double* input,
+    double* output, ThreadPool* pool);
+
+}  // namespace caffe
@@ -0,0 +1,96 @@
+#include <boost/thread.hpp>
+
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+ThreadPool::ThreadPool(int num_threads)
+    : mutex_(new boost::mutex()),
+      job_ready_(new boost::condition_variable()),
+      job_done_(new boost::condition_variable()),
+      num_tasks_(0), next_task_(0), unfinished_tasks_(0), generation_(0),
+      stop_(false) {
+  CHECK_GE(num_threads, 1) << "A thread pool needs at least one thread";
+  // The thread calling Run() is the first worker.
+  for (int i = 1; i < num_threads; ++i) {
+    workers_.push_back(shared_ptr<boost::thread>(
+        new boost::thread(&ThreadPool::WorkerEntry, this)));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    stop_ = true;
+  }
+  job_ready_->notify_all();
+  for (int i = 0; i < workers_.size(); ++i) {
+    workers_[i]->join();
+  }
+}
+
+void ThreadPool::Run(int num_tasks, const boost::function<void(int)>& task) {
+  if (workers_.empty() || num_tasks <= 1) {
+    for (int i = 0; i < num_tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+  int generation;
+  {
+    boost::mutex::scoped_lock lock(*mutex_);
+    task_ = task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    unfinished_tasks_ = num_tasks;
+    generation = ++generation_;
+  }
+  job_ready_->notify_all();
+  RunPendingTasks(task, generation);
+  boost::mutex::scoped_lock lock(*mutex_);
+  while (unfinished_tasks_ > 0) {
+    job_done_->wait(lock);
+  }
+  task_.clear();
+}
+
+void ThreadPool::RunPendingTasks(boost::function<void(int)> task,
+    int generation) {
+  while (true) {
+    int index;
+    {
+      boost::mutex::scoped_lock lock(*mutex_);
+      if (generation_ != generation || next_task_ >= num_tasks_) {
+        return;
+      }
+      index = next_task_++;
+    }
+    task(index);
+    boost::mutex::scoped_lock lock(*mutex_);
+    if (--unfinished_tasks_ == 0) {
+      job_done_->notify_all();
+    }
+  }
+}
+
+void ThreadPool::WorkerEntry() {
+  int seen_generation = 0;
+  while (true) {
+    boost::function<void(int)> task;
+    int generation;
+    {
+      boost::mutex::scoped_lock lock(*mutex_);
+      while (!stop_ && generation_ == seen_generation) {
+        job_ready_->wait(lock);
+      }
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation = generation_;
+      task = task_;
+    }
+    RunPendingTasks(task, generation);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "caffe/util/top_k.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The number of positions whose running maxima are kept on the stack.
+const int kBlock = 64;
+
+// One contiguous row: the maximum in one sweep, then its last occurrence.
+// Both loops are free of loop-carried branches.
+template <typename Dtype>
+void ArgmaxRow(const int channels, const Dtype* x, int* index,
+    Dtype* value) {
+  Dtype max_value = x[0];
+  for (int c = 1; c < channels; ++c) {
+    max_value = x[c] > max_value ? x[c] : max_value;
+  }
+  int c = channels - 1;
+  while (c > 0 && x[c] != max_value) {
+    --c;
+  }
+  *index = c;
+  if (value) {
+    *value = max_value;
+  }
+}
+
+// Up to kBlock contiguous positions, updated together channel by channel.
+template <typename Dtype>
+void ArgmaxBlock(const int channels, const int inner_num, const int n,
+    const Dtype* x, int* index, Dtype* value) {
+  Dtype max_value[kBlock];
+  int max_index[kBlock];
+  for (int k = 0; k < n; ++k) {
+    max_value[k] = x[k];
+    max_index[k] = 0;
+  }
+  for (int c = 1; c < channels; ++c) {
+    const Dtype* x_c = x + c * inner_num;
+    for (int k = 0; k < n; ++k) {
+      const bool larger = x_c[k] >= max_value[k];
+      max_value[k] = larger ? x_c[k] : max_value[k];
+      max_index[k] = larger ? c : max_index[k];
+    }
+  }
+  for (int k = 0; k < n; ++k) {
+    index[k] = max_index[k];
+  }
+  if (value) {
+    for (int k = 0; k < n; ++k) {
+      value[k] = max_value[k];
+    }
+  }
+}
+
+}  // namespace
+
+template <typename Dtype>
+void caffe_cpu_argmax(const int channels, const int inner_num, const int n,
+    const Dtype* x, int* index, Dtype* value) {
+  if (n == 1) {
+    if (inner_num == 1) {
+      ArgmaxRow(channels, x, index, value);
+    } else {
+      ArgmaxBlock(channels, inner_num, 1, x, index, value);
+    }
+    return;
+  }
+  for (int k0 = 0; k0 < n; k0 += kBlock) {
+    ArgmaxBlock(channels, inner_num, std::min(kBlock, n - k0), x + k0,
+        index + k0, value ? value + k0 : NULL);
+  }
+}
+
+template void caffe_cpu_argmax<float>(const int channels,
+    const int inner_num, const int n, const float* x, int* index,
+    float* value);
+template void caffe_cpu_argmax<double>(const int channels,
+    const int inner_num, const int n, const double* x, int* index,
+    double* value);
+
+template <typename Dtype>
+void caffe_cpu_top_k(const int channels, const int inner_num, const Dtype* x,
+    const int top_k, std::pair<Dtype, int>* top) {
+  if (top_k == 1) {
+    caffe_cpu_argmax(channels, inner_num, 1, x, &top->second, &top->first);
+    return;
+  }
+  // A heap of the best top_k so far with the worst of them on top; a score
+  // enters when it beats that one.
+  std::greater<std::pair<Dtype, int> > greater;
+  for (int c = 0; c < top_k; ++c) {
+    top[c] = std::make_pair(x[c * inner_num], c);
+  }
+  std::make_heap(top, top + top_k, greater);
+  for (int c = top_k; c < channels; ++c) {
+    const std::pair<Dtype, int> candidate(x[c * inner_num], c);
+    if (greater(candidate, top[0])) {
+      std::pop_heap(top, top + top_k, greater);
+      top[top_k - 1] = candidate;
+      std::push_heap(top, top + top_k, greater);
+    }
+  }
+  std::sort_heap(top, top + top_k, greater);
+}
+
+template void caffe_cpu_top_k<float>(const int channels, const int inner_num,
+    const float* x, const int top_k, std::pair<float, int>* top);
+template void caffe_cpu_top_k<double>(const int channels,
+    const int inner_num, const double* x, const int top_k,
+    std::pair<double, int>* top);
+
+}  // namespace caffe
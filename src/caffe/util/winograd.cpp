@@ -0,0 +1,204 @@
+#include <cstring>
+
+#include "caffe/common.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/winograd.hpp"
+
+namespace caffe {
+
+namespace {
+
+// The transforms of Lavin and Gray, "Fast Algorithms for Convolutional
+// Neural Networks": input blocks d become B^T d B, filters g become G g G^T
+// and output blocks m become A^T m A.
+const double kBT2[4 * 4] = {
+  1,  0, -1,  0,
+  0,  1,  1,  0,
+  0, -1,  1,  0,
+  0,  1,  0, -1
+};
+const double kG2[4 * 3] = {
+  1,    0,   0,
+  0.5,  0.5, 0.5,
+  0.5, -0.5, 0.5,
+  0,    0,   1
+};
+const double kAT2[2 * 4] = {
+  1, 1,  1,  0,
+  0, 1, -1, -1
+};
+const double kBT4[6 * 6] = {
+  4,  0, -5,  0, 1, 0,
+  0, -4, -4,  1, 1, 0,
+  0,  4, -4, -1, 1, 0,
+  0, -2, -1,  2, 1, 0,
+  0,  2, -1, -2, 1, 0,
+  0,  4,  0, -5, 0, 1
+};
+const double kG4[6 * 3] = {
+  1. / 4,        0,       0,
+  -1. / 6,  -1. / 6, -1. / 6,
+  -1. / 6,   1. / 6, -1. / 6,
+  1. / 24,  1. / 12,  1. / 6,
+  1. / 24, -1. / 12,  1. / 6,
+  0,              0,       1
+};
+const double kAT4[4 * 6] = {
+  1, 1,  1, 1,  1, 0,
+  0, 1, -1, 2, -2, 0,
+  0, 1,  1, 4,  4, 0,
+  0, 1, -1, 8, -8, 1
+};
+
+const int kMaxBlock = 6;
+
+// Y = L X L^T, where L is rows x cols and X is cols x cols.
+template <typename Dtype>
+void Sandwich(const double* L, const int rows, const int cols,
+    const Dtype* X, Dtype* Y) {
+  Dtype LX[kMaxBlock * kMaxBlock];
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      Dtype sum = 0;
+      for (int k = 0; k < cols; ++k) {
+        sum += L[i * cols + k] * X[k * cols + j];
+      }
+      LX[i * cols + j] = sum;
+    }
+  }
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < rows; ++j) {
+      Dtype sum = 0;
+      for (int k = 0; k < cols; ++k) {
+        sum += LX[i * cols + k] * L[j * cols + k];
+      }
+      Y[i * rows + j] = sum;
+    }
+  }
+}
+
+}  // namespace
+
+int winograd_block_size(const int tile) {
+  CHECK(tile == 2 || tile == 4) << "Winograd tile must be 2 or 4";
+  return tile + 2;
+}
+
+int winograd_num_tiles(const int tile, const int height_out,
+    const int width_out) {
+  return ((height_out + tile - 1) / tile) * ((width_out + tile - 1) / tile);
+}
+
+template <typename Dtype>
+void winograd_transform_filters_cpu(const int tile, const int num_output,
+    const int channels_per_group, const Dtype* weights, Dtype* transformed) {
+  const int block = winograd_block_size(tile);
+  const int block_area = block * block;
+  const double* G = tile == 2 ? kG2 : kG4;
+  const int count = num_output * channels_per_group;
+  Dtype U[kMaxBlock * kMaxBlock];
+  for (int f = 0; f < count; ++f) {
+    Sandwich(G, block, 3, weights + f * 9, U);
+    for (int e = 0; e < block_area; ++e) {
+      transformed[e * count + f] = U[e];
+    }
+  }
+}
+
+template void winograd_transform_filters_cpu<float>(const int tile,
+    const int num_output, const int channels_per_group, const float* weights,
+    float* transformed);
+template void winograd_transform_filters_cpu<double>(const int tile,
+    const int num_output, const int channels_per_group,
+    const double* weights, double* transformed);
+
+template <typename Dtype>
+void winograd_conv_cpu(const int tile, const Dtype* data_im,
+    const int channels, const int height, const int width,
+    const int num_output, const int group, const int pad_h, const int pad_w,
+    const Dtype* transformed, Dtype* input_blocks, Dtype* output_blocks,
+    Dtype* data_out) {
+  const int block = winograd_block_size(tile);
+  const int block_area = block * block;
+  const double* BT = tile == 2 ? kBT2 : kBT4;
+  const double* AT = tile == 2 ? kAT2 : kAT4;
+  const int height_out = height + 2 * pad_h - 2;
+  const int width_out = width + 2 * pad_w - 2;
+  const int tiles_h = (height_out + tile - 1) / tile;
+  const int tiles_w = (width_out + tile - 1) / tile;
+  const int num_tiles = tiles_h * tiles_w;
+  Dtype d[kMaxBlock * kMaxBlock];
+  Dtype V[kMaxBlock * kMaxBlock];
+  // Transform the input blocks, zero padding the image.
+  for (int c = 0; c < channels; ++c) {
+    const Dtype* im = data_im + c * height * width;
+    for (int ty = 0; ty < tiles_h; ++ty) {
+      for (int tx = 0; tx < tiles_w; ++tx) {
+        const int y0 = ty * tile - pad_h;
+        const int x0 = tx * tile - pad_w;
+        for (int i = 0; i < block; ++i) {
+          const int y = y0 + i;
+          for (int j = 0; j < block; ++j) {
+            const int x = x0 + j;
+            d[i * block + j] = (y >= 0 && y < height && x >= 0 && x < width) ?
+                im[y * width + x] : Dtype(0);
+          }
+        }
+        Sandwich(BT, block, block, d, V);
+        const int t = ty * tiles_w + tx;
+        for (int e = 0; e < block_area; ++e) {
+          input_blocks[(e * channels + c) * num_tiles + t] = V[e];
+        }
+      }
+    }
+  }
+  // Reduce over the input channels of each group.
+  const int channels_per_group = channels / group;
+  const int outputs_per_group = num_output / group;
+  for (int e = 0; e < block_area; ++e) {
+    for (int g = 0; g < group; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, outputs_per_group,
+          num_tiles, channels_per_group, (Dtype)1.,
+          transformed + (e * num_output + g * outputs_per_group) *
+              channels_per_group,
+          input_blocks + (e * channels + g * channels_per_group) * num_tiles,
+          (Dtype)0.,
+          output_blocks + (e * num_output + g * outputs_per_group) *
+              num_tiles);
+    }
+  }
+  // Transform the output blocks back, cropping the last row and column of
+  // tiles to the output.
+  Dtype m[kMaxBlock * kMaxBlock];
+  Dtype Y[kMaxBlock * kMaxBlock];
+  for (int o = 0; o < num_output; ++o) {
+    Dtype* out = data_out + o * height_out * width_out;
+    for (int ty = 0; ty < tiles_h; ++ty) {
+      for (int tx = 0; tx < tiles_w; ++tx) {
+        const int t = ty * tiles_w + tx;
+        for (int e = 0; e < block_area; ++e) {
+          m[e] = output_blocks[(e * num_output + o) * num_tiles + t];
+        }
+        Sandwich(AT, tile, block, m, Y);
+        for (int i = 0; i < tile && ty * tile + i < height_out; ++i) {
+          for (int j = 0; j < tile && tx * tile + j < width_out; ++j) {
+            out[(ty * tile + i) * width_out + tx * tile + j] = Y[i * tile + j];
+          }
+        }
+      }
+    }
+  }
+}
+
+template void winograd_conv_cpu<float>(const int tile, const float* data_im,
+    const int channels, const int height, const int width,
+    const int num_output, const int group, const int pad_h, const int pad_w,
+    const float* transformed, float* input_blocks, float* output_blocks,
+    float* data_out);
+template void winograd_conv_cpu<double>(const int tile,
+    const double* data_im, const int channels, const int height,
+    const int width, const int num_output, const int group, const int pad_h,
+    const int pad_w, const double* transformed, double* input_blocks,
+    double* output_blocks, double* data_out);
+
+}  // namespace caffe
@@ -48,7 +48,7 @@ int main(int argc, char** argv) {
   int count = 0;
   // load first datum
   Datum datum;
-  datum.ParseFromString(cursor->value());
+  datum.ParseFromArray(cursor->value_data(), cursor->value_size());
 
   if (DecodeDatumNative(&datum)) {
     LOG(INFO) << "Decoding Datum";
@@ -66,8 +66,8 @@ int main(int argc, char** argv) {
   }
   LOG(INFO) << "Starting Iteration";
   while (cursor->valid()) {
-    Datum datum;
-    datum.ParseFromString(cursor->value());
+    // Parse straight from the cursor, reusing datum's buffers.
+    datum.ParseFromArray(cursor->value_data(), cursor->value_size());
     DecodeDatumNative(&datum);
 
     const std::string& data = datum.data();
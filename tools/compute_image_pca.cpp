@@ -50,7 +50,7 @@ int main(int argc, char** argv) {
   scoped_ptr<db::Cursor> cursor(db->NewCursor());
 
   Datum first_datum;
-  first_datum.ParseFromString(cursor->value());
+  first_datum.ParseFromArray(cursor->value_data(), cursor->value_size());
 
   if (DecodeDatumNative(&first_datum)) {
     LOG(INFO) << "Decoding Datum";
@@ -76,9 +76,10 @@ int main(int argc, char** argv) {
   // see
   // http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
   LOG(INFO) << "Calculating mean and principal components...";
+  Datum datum;
   while (cursor->valid()) {
-    Datum datum;
-    datum.ParseFromString(cursor->value());
+    // Parse straight from the cursor, reusing datum's buffers.
+    datum.ParseFromArray(cursor->value_data(), cursor->value_size());
     DecodeDatumNative(&datum);
 
     size_in_datum = std::max<int>(datum.data().size(),
@@ -0,0 +1,124 @@
+// This program converts a set of equally sized images to a raw dataset: a
+// header followed by fixed-stride records that RawDataLayer reads straight
+// out of a memory mapping (see include/caffe/util/raw_dataset.hpp).
+// Usage:
+//   convert_imageset_raw [FLAGS] ROOTFOLDER/ LISTFILE RAW_FILE
+//
+// where ROOTFOLDER is the root folder that holds all the images, and LISTFILE
+// should be a list of files as well as their labels, in the format as
+//   subfolder1/file1.JPEG 7
+//   ....
+
+#include <algorithm>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/scoped_ptr.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+#include "caffe/util/raw_dataset.hpp"
+#include "caffe/util/rng.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::pair;
+using boost::scoped_ptr;
+
+DEFINE_bool(gray, false,
+    "When this option is on, treat images as grayscale ones");
+DEFINE_bool(shuffle, false,
+    "Randomly shuffle the order of images and their labels");
+DEFINE_int32(resize_width, 0, "Width images are resized to");
+DEFINE_int32(resize_height, 0, "Height images are resized to");
+DEFINE_bool(float_data, false,
+    "When this option is on, store the pixels as float32 instead of uint8, "
+    "so that float nets can copy them without conversion");
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Convert a set of equally sized images to the\n"
+        "memory mapped raw format read by the RawData layer.\n"
+        "Usage:\n"
+        "    convert_imageset_raw [FLAGS] ROOTFOLDER/ LISTFILE RAW_FILE\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 4) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/convert_imageset_raw");
+    return 1;
+  }
+
+  const bool is_color = !FLAGS_gray;
+
+  std::ifstream infile(argv[2]);
+  std::vector<std::pair<std::string, int> > lines;
+  std::string filename;
+  int label;
+  while (infile >> filename >> label) {
+    lines.push_back(std::make_pair(filename, label));
+  }
+  if (FLAGS_shuffle) {
+    // randomly shuffle data
+    LOG(INFO) << "Shuffling data";
+    shuffle(lines.begin(), lines.end());
+  }
+  LOG(INFO) << "A total of " << lines.size() << " images.";
+
+  int resize_height = std::max<int>(0, FLAGS_resize_height);
+  int resize_width = std::max<int>(0, FLAGS_resize_width);
+
+  // The writer is created from the first image, which fixes the sample size.
+  std::string root_folder(argv[1]);
+  scoped_ptr<RawDatasetWriter> writer;
+  Datum datum;
+  std::vector<float> float_data;
+  int data_size = 0;
+  int count = 0;
+
+  for (int line_id = 0; line_id < lines.size(); ++line_id) {
+    if (!ReadImageToDatum(root_folder + lines[line_id].first,
+        lines[line_id].second, resize_height, resize_width, is_color,
+        &datum)) {
+      continue;
+    }
+    if (!writer) {
+      writer.reset(new RawDatasetWriter(argv[3], FLAGS_float_data ?
+          RawDatasetHeader::FLOAT32 : RawDatasetHeader::UINT8,
+          datum.channels(), datum.height(), datum.width()));
+      LOG(INFO) << "Sample shape: " << datum.channels() << " x "
+          << datum.height() << " x " << datum.width();
+      data_size = datum.channels() * datum.height() * datum.width();
+      float_data.resize(data_size);
+    }
+    const std::string& data = datum.data();
+    CHECK_EQ(data.size(), data_size) << "All images must have the same size; "
+        << "set resize_height and resize_width if they do not: "
+        << lines[line_id].first;
+    if (FLAGS_float_data) {
+      for (int i = 0; i < data.size(); ++i) {
+        float_data[i] = static_cast<uint8_t>(data[i]);
+      }
+      writer->Write(&float_data[0], datum.label());
+    } else {
+      writer->Write(data.data(), datum.label());
+    }
+
+    if (++count % 1000 == 0) {
+      LOG(ERROR) << "Processed " << count << " files.";
+    }
+  }
+  if (count % 1000 != 0) {
+    LOG(ERROR) << "Processed " << count << " files.";
+  }
+  CHECK(writer) << "No image could be read";
+  writer->Close();
+  return 0;
+}
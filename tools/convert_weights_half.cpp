@@ -0,0 +1,60 @@
+// This is a script to store the weights of a trained net in fp16, which
+// halves the size of the file. Blob::FromProto widens them back on loading.
+// Usage:
+//    convert_weights_half net_weights_in net_weights_out
+
+#include <stdint.h>
+
+#include <string>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/half.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc != 3) {
+    LOG(ERROR) << "Usage: "
+        << "convert_weights_half net_weights_in net_weights_out";
+    return 1;
+  }
+
+  NetParameter net_param;
+  string input_filename(argv[1]);
+  if (!ReadProtoFromBinaryFile(input_filename, &net_param)) {
+    LOG(ERROR) << "Failed to parse input binary file as NetParameter: "
+               << input_filename;
+    return 2;
+  }
+  if (NetNeedsUpgrade(net_param) &&
+      !UpgradeNetAsNeeded(input_filename, &net_param)) {
+    LOG(ERROR) << "Encountered error(s) while upgrading weights; "
+               << "see details above.";
+    return 2;
+  }
+
+  int count = 0;
+  for (int i = 0; i < net_param.layer_size(); ++i) {
+    LayerParameter* layer_param = net_param.mutable_layer(i);
+    for (int j = 0; j < layer_param->blobs_size(); ++j) {
+      BlobProto* blob_proto = layer_param->mutable_blobs(j);
+      if (blob_proto->data_size() == 0) {
+        continue;
+      }
+      string half_data(blob_proto->data_size() * sizeof(uint16_t), '\0');
+      caffe_cpu_float2half(blob_proto->data_size(), blob_proto->data().data(),
+          reinterpret_cast<uint16_t*>(&half_data[0]));
+      count += blob_proto->data_size();
+      blob_proto->clear_data();
+      blob_proto->set_half_data(half_data);
+    }
+  }
+
+  WriteProtoToBinaryFile(net_param, argv[2]);
+
+  LOG(ERROR) << "Wrote " << count << " weights in fp16 to " << argv[2];
+  return 0;
+}
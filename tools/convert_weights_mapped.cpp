@@ -0,0 +1,41 @@
+// This is a script to convert the weights of a trained net to mapped
+// weights, which Net::CopyTrainedLayersFrom maps instead of reading.
+// Usage:
+//    convert_weights_mapped net_weights_in mapped_weights_out
+
+#include <string>
+
+#include "caffe/caffe.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/mapped_weights.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  if (argc != 3) {
+    LOG(ERROR) << "Usage: "
+        << "convert_weights_mapped net_weights_in mapped_weights_out";
+    return 1;
+  }
+
+  NetParameter net_param;
+  string input_filename(argv[1]);
+  if (!ReadProtoFromBinaryFile(input_filename, &net_param)) {
+    LOG(ERROR) << "Failed to parse input binary file as NetParameter: "
+               << input_filename;
+    return 2;
+  }
+  if (NetNeedsUpgrade(net_param) &&
+      !UpgradeNetAsNeeded(input_filename, &net_param)) {
+    LOG(ERROR) << "Encountered error(s) while upgrading weights; "
+               << "see details above.";
+    return 2;
+  }
+
+  WriteMappedWeights(net_param, argv[2]);
+
+  LOG(ERROR) << "Wrote mapped weights to " << argv[2];
+  return 0;
+}
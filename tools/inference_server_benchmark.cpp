@@ -0,0 +1,126 @@
+// A load generator for InferenceServer: clients each submit single-item
+// requests and wait for them in a loop, and the throughput and latency of
+// the batched server are compared with running every request on its own.
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/inference_server.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/math_functions.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_string(model, "",
+    "The deploy model definition, with one input whose num is the largest "
+    "batch.");
+DEFINE_string(weights, "",
+    "Optional; the trained weights, else the fillers' initialization.");
+DEFINE_int32(clients, 8,
+    "The number of client threads, each with one request in flight.");
+DEFINE_int32(requests, 100,
+    "The number of requests of each client.");
+DEFINE_int32(max_delay_us, 2000,
+    "How long the server waits to fill a batch after its first request.");
+
+// The number of distinct random inputs that the requests cycle through.
+static const int kNumInputs = 16;
+
+static void RunClient(InferenceServer<float>* server,
+    const vector<float>* inputs, int client) {
+  const int input_count = server->input_count();
+  for (int i = 0; i < FLAGS_requests; ++i) {
+    const int input = (client + i) % kNumInputs;
+    server->Submit(&(*inputs)[input * input_count])->Wait();
+  }
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Measures the throughput and latency of batched\n"
+        "inference with InferenceServer against one Forward per request.\n"
+        "Usage:\n"
+        "    inference_server_benchmark [FLAGS]\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 1 || FLAGS_model.empty()) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0],
+        "tools/inference_server_benchmark");
+    return 1;
+  }
+  Caffe::set_mode(Caffe::CPU);
+
+  NetParameter param;
+  ReadNetParamsFromTextFileOrDie(FLAGS_model, &param);
+  param.mutable_state()->set_phase(TEST);
+  shared_ptr<NetWeights<float> > weights;
+  if (FLAGS_weights.empty()) {
+    NetParameter weights_param;
+    Net<float>(param).ToProto(&weights_param);
+    weights.reset(new NetWeights<float>(weights_param));
+  } else {
+    weights.reset(new NetWeights<float>(FLAGS_weights));
+  }
+  vector<shared_ptr<Net<float> > > nets;
+  CreateSharedWeightsNets<float>(param, weights, 2, &nets);
+  CHECK_EQ(nets[0]->input_blobs().size(), 1)
+      << "The model must have exactly one input.";
+  const int input_count = nets[0]->input_blobs()[0]->count(1);
+  vector<float> inputs(kNumInputs * input_count);
+  caffe_rng_gaussian<float>(inputs.size(), 0, 1, &inputs[0]);
+
+  // One Forward per request.
+  Net<float>& single_net = *nets[1];
+  Blob<float>* single_input = single_net.input_blobs()[0];
+  vector<int> shape = single_input->shape();
+  shape[0] = 1;
+  single_input->Reshape(shape);
+  single_net.Reshape();
+  single_net.ForwardPrefilled();
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < FLAGS_requests; ++i) {
+    caffe_copy(input_count, &inputs[(i % kNumInputs) * input_count],
+        single_input->mutable_cpu_data());
+    single_net.ForwardPrefilled();
+  }
+  const float single_ms = timer.MilliSeconds() / FLAGS_requests;
+  LOG(INFO) << "Batch 1: " << single_ms << " ms per request, "
+      << 1000 / single_ms << " requests/s";
+
+  // Batched by the server.
+  InferenceServer<float> server(nets[0], FLAGS_max_delay_us);
+  timer.Start();
+  boost::thread_group clients;
+  for (int i = 0; i < FLAGS_clients; ++i) {
+    clients.create_thread(boost::bind(&RunClient, &server, &inputs, i));
+  }
+  clients.join_all();
+  const float served_ms = timer.MilliSeconds();
+  const InferenceServerStats stats = server.stats();
+  LOG(INFO) << "Server with " << FLAGS_clients << " clients and batches of "
+      << "up to " << server.max_batch_size() << ": "
+      << stats.requests * 1000 / served_ms << " requests/s";
+  LOG(INFO) << "Mean batch size " << stats.mean_batch_size << " over "
+      << stats.batches << " batches";
+  LOG(INFO) << "Latency: mean " << stats.mean_latency_ms << " ms, p50 "
+      << stats.p50_latency_ms << " ms, p99 " << stats.p99_latency_ms
+      << " ms, max " << stats.max_latency_ms << " ms";
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/quantize.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+using std::map;
+using std::max;
+
+DEFINE_string(model, "",
+    "The TEST phase model definition, whose data layers feed calibration.");
+DEFINE_string(weights, "",
+    "The trained float weights.");
+DEFINE_int32(iterations, 10,
+    "The number of batches to calibrate and to compare on.");
+
+// The largest magnitude in count values of x.
+static float MaxAbs(const int count, const float* x) {
+  float max_abs = 0;
+  for (int i = 0; i < count; ++i) {
+    max_abs = max(max_abs, std::fabs(x[i]));
+  }
+  return max_abs;
+}
+
+// The index of the largest of count values of x.
+static int ArgMax(const int count, const float* x) {
+  return std::max_element(x, x + count) - x;
+}
+
+// The Winograd engine transforms Dtype filters, so it has no int8 path.
+static bool IsQuantizable(const LayerParameter& param) {
+  return param.type() == "InnerProduct" || (param.type() == "Convolution" &&
+      param.convolution_param().engine() !=
+      ConvolutionParameter_Engine_WINOGRAD);
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Calibrates a trained net for int8 inference of\n"
+        "its Convolution and InnerProduct layers, writes the quantized net\n"
+        "and reports how far its outputs are from those of the float net.\n"
+        "Usage:\n"
+        "    quantize_net [FLAGS] OUTPUT_MODEL OUTPUT_WEIGHTS\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 3 || FLAGS_model.empty() || FLAGS_weights.empty()) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/quantize_net");
+    return 1;
+  }
+  Caffe::set_mode(Caffe::CPU);
+
+  // Calibrate: record the largest input magnitude of every quantizable
+  // layer, running the net one layer at a time.
+  Net<float> net(FLAGS_model, TEST);
+  net.CopyTrainedLayersFrom(FLAGS_weights);
+  const vector<shared_ptr<Layer<float> > >& layers = net.layers();
+  vector<float> max_input(layers.size(), 0);
+  for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+    for (int i = 0; i < layers.size(); ++i) {
+      net.ForwardFromTo(i, i);
+      if (IsQuantizable(layers[i]->layer_param())) {
+        const Blob<float>* bottom = net.bottom_vecs()[i][0];
+        max_input[i] = max(max_input[i],
+            MaxAbs(bottom->count(), bottom->cpu_data()));
+      }
+    }
+  }
+
+  // Write the quantized net: the input scales into the model definition
+  // and the int8 weights of the quantized layers.
+  map<string, float> input_scales;
+  for (int i = 0; i < layers.size(); ++i) {
+    if (IsQuantizable(layers[i]->layer_param())) {
+      input_scales[net.layer_names()[i]] = int8_scale(max_input[i]);
+      LOG(INFO) << "Quantizing layer " << net.layer_names()[i]
+          << " with input scale " << input_scales[net.layer_names()[i]];
+    }
+  }
+  NetParameter model_param;
+  ReadNetParamsFromTextFileOrDie(FLAGS_model, &model_param);
+  for (int i = 0; i < model_param.layer_size(); ++i) {
+    LayerParameter* layer_param = model_param.mutable_layer(i);
+    if (input_scales.count(layer_param->name())) {
+      layer_param->mutable_quantization_param()->set_input_scale(
+          input_scales[layer_param->name()]);
+    }
+  }
+  WriteProtoToTextFile(model_param, argv[1]);
+  NetParameter weights_param;
+  net.ToProto(&weights_param);
+  for (int i = 0; i < weights_param.layer_size(); ++i) {
+    LayerParameter* layer_param = weights_param.mutable_layer(i);
+    if (input_scales.count(layer_param->name())) {
+      QuantizeBlobProto(*net.layer_by_name(layer_param->name())->blobs()[0],
+          layer_param->mutable_blobs(0));
+    }
+  }
+  WriteProtoToBinaryFile(weights_param, argv[2]);
+
+  // Compare the float and the int8 nets on the same batches.
+  Net<float> float_net(FLAGS_model, TEST);
+  float_net.CopyTrainedLayersFrom(FLAGS_weights);
+  model_param.mutable_state()->set_phase(TEST);
+  Net<float> int8_net(model_param);
+  int8_net.CopyTrainedLayersFrom(argv[2]);
+  const vector<Blob<float>*>& float_outputs = float_net.output_blobs();
+  const vector<Blob<float>*>& int8_outputs = int8_net.output_blobs();
+  vector<double> float_scores(float_outputs.size(), 0);
+  vector<double> int8_scores(int8_outputs.size(), 0);
+  vector<float> max_diff(float_outputs.size(), 0);
+  // Per output, the items (along the first axis) whose largest value is at
+  // the same index in both nets, of those with more than one value.
+  vector<int> top1_matches(float_outputs.size(), 0);
+  vector<int> top1_items(float_outputs.size(), 0);
+  Timer timer;
+  double float_ms = 0, int8_ms = 0;
+  for (int iter = 0; iter < FLAGS_iterations; ++iter) {
+    timer.Start();
+    float_net.ForwardPrefilled();
+    float_ms += timer.MilliSeconds();
+    timer.Start();
+    int8_net.ForwardPrefilled();
+    int8_ms += timer.MilliSeconds();
+    for (int j = 0; j < float_outputs.size(); ++j) {
+      const int count = float_outputs[j]->count();
+      const float* float_data = float_outputs[j]->cpu_data();
+      const float* int8_data = int8_outputs[j]->cpu_data();
+      for (int k = 0; k < count; ++k) {
+        float_scores[j] += float_data[k] / count;
+        int8_scores[j] += int8_data[k] / count;
+        max_diff[j] = max(max_diff[j], std::fabs(float_data[k] - int8_data[k]));
+      }
+      const int items = float_outputs[j]->num_axes() > 0 ?
+          float_outputs[j]->shape(0) : 1;
+      const int dim = items > 0 ? count / items : 0;
+      if (dim > 1) {
+        for (int n = 0; n < items; ++n) {
+          top1_matches[j] += ArgMax(dim, float_data + n * dim) ==
+              ArgMax(dim, int8_data + n * dim);
+        }
+        top1_items[j] += items;
+      }
+    }
+  }
+  for (int j = 0; j < float_outputs.size(); ++j) {
+    const string& name =
+        float_net.blob_names()[float_net.output_blob_indices()[j]];
+    LOG(INFO) << name << ": float " << float_scores[j] / FLAGS_iterations
+        << ", int8 " << int8_scores[j] / FLAGS_iterations
+        << ", max difference " << max_diff[j];
+    if (top1_items[j] > 0) {
+      LOG(INFO) << name << ": top-1 agreement "
+          << 100. * top1_matches[j] / top1_items[j] << "% ("
+          << top1_matches[j] << " of " << top1_items[j] << ")";
+    }
+  }
+  LOG(INFO) << "Forward: float " << float_ms / FLAGS_iterations
+      << " ms, int8 " << int8_ms / FLAGS_iterations << " ms";
+  return 0;
+}